@@ -8,7 +8,7 @@
 
 import * as sodium from 'libsodium-wrappers-sumo';
 import CryptoState from './CryptoState';
-import { OutputState, Output, Scene } from './Types';
+import { OutputState, Output, Scene, SceneThumbnail } from './Types';
 
 interface JSONRPCMessage {
   jsonrpc: "2.0",
@@ -188,4 +188,15 @@ export default class Client {
   public async getSceneThumbnail(id: string, content_type: string): Promise<string> {
     return (await this.sendRequest("scenes/getThumbnail", { id, content_type })).base64_data;
   }
+
+  public async getSceneThumbnailIfModified(
+    id: string,
+    content_type: string,
+    ifNoneMatch: string | null,
+  ): Promise<SceneThumbnail> {
+    const params = ifNoneMatch === null
+      ? { id, content_type }
+      : { id, content_type, ifNoneMatch };
+    return await this.sendRequest("scenes/getThumbnail", params);
+  }
 }
@@ -34,3 +34,11 @@ export interface Scene {
   name: string,
   active: boolean,
 }
+
+export interface SceneThumbnail {
+  id: string,
+  content_type: string,
+  hash: string,
+  base64_data?: string,
+  notModified?: boolean,
+}
@@ -10,7 +10,7 @@ import handshake from './handshake';
 import RPC from './RPC';
 import Config from './Config';
 import CryptoState from './CryptoState';
-import {Output, OutputState, OutputType, Scene} from './Types'
+import {Output, OutputState, OutputType, Scene, SceneThumbnail} from './Types'
 import {Version} from './Version';
 
 export {
@@ -22,5 +22,6 @@ export {
   OutputState,
   OutputType,
   Scene,
+  SceneThumbnail,
   Version,
 };
@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#include "AdaptiveQuality.h"
+
+#include <algorithm>
+
+using json = nlohmann::json;
+
+namespace {
+const uint32_t STANDARD_SIZES[] = {1920, 1280, 960, 640, 480, 320, 240, 160};
+const int JPEG_QUALITIES[] = {90, 75, 60, 45, 30, 15};
+// Leave room for other messages, and for the estimate being wrong
+const double LINK_SHARE = 0.5;
+// Only switch to a better tier if it fits comfortably, to avoid flapping
+const double UPGRADE_HEADROOM = 0.75;
+const double CORRECTION_SMOOTHING = 0.25;
+
+double bytes_per_pixel(const QualityTier& tier) {
+  // Rough figures for typical scene content; corrected by `encoded()`
+  if (tier.contentType == "image/png") {
+    return 1.5;
+  }
+  const auto q = (tier.quality < 0 ? 75 : tier.quality) / 100.0;
+  return 0.1 + (0.5 * q * q);
+}
+
+double scaled_pixels(
+  uint32_t maxDimension,
+  uint32_t sourceWidth,
+  uint32_t sourceHeight) {
+  const auto largest = std::max(sourceWidth, sourceHeight);
+  if (largest == 0) {
+    return 0;
+  }
+  const auto scale = (maxDimension == 0 || maxDimension >= largest)
+    ? 1.0
+    : double(maxDimension) / largest;
+  return sourceWidth * scale * sourceHeight * scale;
+}
+
+// Only used for ordering tiers, so the source size barely matters
+double nominal_bytes(const QualityTier& tier) {
+  return scaled_pixels(tier.maxDimension, 1920, 1080) * bytes_per_pixel(tier);
+}
+}// namespace
+
+QualityBounds QualityBounds::fromJson(
+  const json& adaptive,
+  uint32_t defaultMaxDimension) {
+  QualityBounds bounds;
+  bounds.minDimension = adaptive.value("minSize", 0);
+  bounds.maxDimension = adaptive.value("maxSize", defaultMaxDimension);
+  bounds.allowLossy = adaptive.value("allowLossy", true);
+  bounds.minQuality = std::clamp(adaptive.value("minQuality", 30), 0, 100);
+  return bounds;
+}
+
+json QualityTier::toJson() const {
+  json ret{
+    {"size", maxDimension},
+    {"content_type", contentType},
+  };
+  if (quality >= 0) {
+    ret["quality"] = quality;
+  }
+  return ret;
+}
+
+QualitySelector::QualitySelector(const QualityBounds& bounds)
+  : mBounds(bounds) {
+  std::vector<uint32_t> sizes {bounds.maxDimension};
+  for (const auto size : STANDARD_SIZES) {
+    if (bounds.maxDimension != 0 && size >= bounds.maxDimension) {
+      continue;
+    }
+    if (size < bounds.minDimension) {
+      continue;
+    }
+    sizes.push_back(size);
+  }
+
+  for (const auto size : sizes) {
+    mTiers.push_back({.maxDimension = size});
+    if (!bounds.allowLossy) {
+      continue;
+    }
+    for (const auto quality : JPEG_QUALITIES) {
+      if (quality >= bounds.minQuality) {
+        mTiers.push_back(
+          {.maxDimension = size,
+           .contentType = "image/jpeg",
+           .quality = quality});
+      }
+    }
+  }
+
+  // Ties go to the larger image, as it was added first
+  std::stable_sort(
+    mTiers.begin(), mTiers.end(),
+    [](const QualityTier& a, const QualityTier& b) {
+      return nominal_bytes(a) > nominal_bytes(b);
+    });
+}
+
+double QualitySelector::estimateBytes(
+  const QualityTier& tier,
+  uint32_t sourceWidth,
+  uint32_t sourceHeight) const {
+  auto it = mCorrections.find(tier.contentType);
+  const auto correction = it == mCorrections.end() ? 1.0 : it->second;
+  // Base64
+  return (4.0 / 3) * correction * bytes_per_pixel(tier)
+    * scaled_pixels(tier.maxDimension, sourceWidth, sourceHeight);
+}
+
+const QualityTier& QualitySelector::select(
+  uint32_t sourceWidth,
+  uint32_t sourceHeight,
+  double bytesPerSecond,
+  double framesPerSecond) {
+  if (bytesPerSecond <= 0 || framesPerSecond <= 0) {
+    mCurrent = 0;
+    return mTiers[mCurrent];
+  }
+
+  const auto budget = (bytesPerSecond * LINK_SHARE) / framesPerSecond;
+  size_t selected = mTiers.size() - 1;
+  for (size_t i = 0; i < mTiers.size(); ++i) {
+    const auto limit = i < mCurrent ? budget * UPGRADE_HEADROOM : budget;
+    if (estimateBytes(mTiers[i], sourceWidth, sourceHeight) <= limit) {
+      selected = i;
+      break;
+    }
+  }
+  mCurrent = selected;
+  return mTiers[mCurrent];
+}
+
+void QualitySelector::encoded(
+  const QualityTier& tier,
+  uint32_t width,
+  uint32_t height,
+  size_t bytes) {
+  const auto modelled
+    = (4.0 / 3) * bytes_per_pixel(tier) * double(width) * height;
+  if (modelled <= 0) {
+    return;
+  }
+  const auto correction = bytes / modelled;
+  auto it = mCorrections.find(tier.contentType);
+  if (it == mCorrections.end()) {
+    mCorrections.emplace(tier.contentType, correction);
+    return;
+  }
+  it->second = (CORRECTION_SMOOTHING * correction)
+    + ((1 - CORRECTION_SMOOTHING) * it->second);
+}
+
+const QualityTier& QualitySelector::getTier() const {
+  return mTiers[mCurrent];
+}
+
+const QualityBounds& QualitySelector::getBounds() const {
+  return mBounds;
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// Limits set by the client; the server picks anything within them
+struct QualityBounds {
+  // 0 for no limit
+  uint32_t minDimension = 0;
+  uint32_t maxDimension = 0;
+  bool allowLossy = true;
+  int minQuality = 30;
+
+  bool operator==(const QualityBounds&) const = default;
+  // `adaptive` parameter from `previews/subscribe` or `scenes/getThumbnails`
+  static QualityBounds fromJson(
+    const nlohmann::json& adaptive,
+    uint32_t defaultMaxDimension);
+};
+
+struct QualityTier {
+  // 0 for full size
+  uint32_t maxDimension = 0;
+  std::string contentType = "image/png";
+  // As for `StreamingSoftware::encodeImage()`
+  int quality = -1;
+
+  nlohmann::json toJson() const;
+};
+
+/** Picks the best quality tier that the connection can keep up with.
+ *
+ * Sizes are estimated from a simple per-format model, corrected by the sizes
+ * that are actually produced.
+ */
+class QualitySelector final {
+ public:
+  explicit QualitySelector(const QualityBounds& bounds);
+
+  // `bytesPerSecond` is 0 if unknown, in which case the best tier is used.
+  const QualityTier& select(
+    uint32_t sourceWidth,
+    uint32_t sourceHeight,
+    double bytesPerSecond,
+    double framesPerSecond);
+  void encoded(
+    const QualityTier& tier,
+    uint32_t width,
+    uint32_t height,
+    size_t bytes);
+
+  const QualityTier& getTier() const;
+  const QualityBounds& getBounds() const;
+
+ private:
+  double estimateBytes(
+    const QualityTier& tier,
+    uint32_t sourceWidth,
+    uint32_t sourceHeight) const;
+
+  QualityBounds mBounds;
+  // Best first
+  std::vector<QualityTier> mTiers;
+  size_t mCurrent = 0;
+  // Actual size divided by modelled size, by content type
+  std::map<std::string, double> mCorrections;
+};
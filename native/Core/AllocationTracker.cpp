@@ -0,0 +1,229 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#include "AllocationTracker.h"
+
+#include "Metrics.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+std::array<AllocationTracker::AtomicCounts, AllocationTracker::SCOPE_COUNT>
+  AllocationTracker::sCounts {};
+
+AllocationTracker::Snapshot AllocationTracker::getSnapshot() {
+  Snapshot snapshot;
+  for (size_t i = 0; i < SCOPE_COUNT; ++i) {
+    snapshot[i] = {
+      .allocations = sCounts[i].allocations.load(std::memory_order_relaxed),
+      .bytes = sCounts[i].bytes.load(std::memory_order_relaxed),
+    };
+  }
+  return snapshot;
+}
+
+AllocationTracker::Counts AllocationTracker::getTotal(
+  const Snapshot& snapshot) {
+  Counts total;
+  for (size_t i = 0; i < SCOPE_COUNT; ++i) {
+    if (static_cast<AllocationScope>(i) == AllocationScope::EXCLUDED) {
+      continue;
+    }
+    total.allocations += snapshot[i].allocations;
+    total.bytes += snapshot[i].bytes;
+  }
+  return total;
+}
+
+const char* AllocationTracker::scopeToString(AllocationScope scope) {
+  switch (scope) {
+    case AllocationScope::OTHER:
+      return "other";
+    case AllocationScope::CRYPTO:
+      return "crypto";
+    case AllocationScope::JSON:
+      return "json";
+    case AllocationScope::LOGGING:
+      return "logging";
+    case AllocationScope::NOTIFICATIONS:
+      return "notifications";
+    case AllocationScope::PREVIEWS:
+      return "previews";
+    case AllocationScope::RPC:
+      return "rpc";
+    case AllocationScope::SIGNALS:
+      return "signals";
+    case AllocationScope::TRANSPORT:
+      return "transport";
+    case AllocationScope::EXCLUDED:
+      return "excluded";
+  }
+  return "unknown";
+}
+
+void AllocationTracker::registerMetrics() {
+  if (!isEnabled()) {
+    return;
+  }
+  for (size_t i = 0; i < SCOPE_COUNT; ++i) {
+    const auto scope = static_cast<AllocationScope>(i);
+    if (scope == AllocationScope::EXCLUDED) {
+      continue;
+    }
+    const MetricLabels labels {{"scope", scopeToString(scope)}};
+    Metrics::counterFunction(
+      "streaming_remote_allocations_total",
+      "Heap allocations, by the subsystem that made them", labels, [i]() {
+        return sCounts[i].allocations.load(std::memory_order_relaxed);
+      });
+    Metrics::counterFunction(
+      "streaming_remote_allocated_bytes_total",
+      "Heap-allocated bytes, by the subsystem that allocated them", labels,
+      [i]() { return sCounts[i].bytes.load(std::memory_order_relaxed); });
+  }
+}
+
+#ifdef STREAMING_REMOTE_ALLOCATION_TRACKING
+// Replacing the global allocation functions here relies on this file being
+// linked; `Server` calls `registerMetrics()` to make sure that it is.
+namespace {
+void* tracked_alloc(size_t size) {
+  AllocationTracker::allocated(size);
+  return std::malloc(size ? size : 1);
+}
+
+void* tracked_aligned_alloc(size_t size, std::align_val_t alignment) {
+  AllocationTracker::allocated(size);
+  size = size ? size : 1;
+#ifdef _WIN32
+  return _aligned_malloc(size, static_cast<size_t>(alignment));
+#else
+  void* p = nullptr;
+  if (posix_memalign(
+        &p,
+        std::max(sizeof(void*), static_cast<size_t>(alignment)),
+        size)
+      != 0) {
+    return nullptr;
+  }
+  return p;
+#endif
+}
+
+void tracked_aligned_free(void* p) {
+#ifdef _WIN32
+  _aligned_free(p);
+#else
+  std::free(p);
+#endif
+}
+}// namespace
+
+void* operator new(size_t size) {
+  if (auto p = tracked_alloc(size)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  return tracked_alloc(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+  return tracked_alloc(size);
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+  if (auto p = tracked_aligned_alloc(size, alignment)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void* operator new[](size_t size, std::align_val_t alignment) {
+  return operator new(size, alignment);
+}
+
+void* operator new(
+  size_t size,
+  std::align_val_t alignment,
+  const std::nothrow_t&) noexcept {
+  return tracked_aligned_alloc(size, alignment);
+}
+
+void* operator new[](
+  size_t size,
+  std::align_val_t alignment,
+  const std::nothrow_t&) noexcept {
+  return tracked_aligned_alloc(size, alignment);
+}
+
+void operator delete(void* p) noexcept {
+  std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+  std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+  std::free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+  std::free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+  std::free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept {
+  std::free(p);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept {
+  tracked_aligned_free(p);
+}
+
+void operator delete[](void* p, std::align_val_t) noexcept {
+  tracked_aligned_free(p);
+}
+
+void operator delete(void* p, size_t, std::align_val_t) noexcept {
+  tracked_aligned_free(p);
+}
+
+void operator delete[](void* p, size_t, std::align_val_t) noexcept {
+  tracked_aligned_free(p);
+}
+
+void operator delete(
+  void* p,
+  std::align_val_t,
+  const std::nothrow_t&) noexcept {
+  tracked_aligned_free(p);
+}
+
+void operator delete[](
+  void* p,
+  std::align_val_t,
+  const std::nothrow_t&) noexcept {
+  tracked_aligned_free(p);
+}
+#endif
@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Subsystems that heap allocations are attributed to
+enum class AllocationScope : uint8_t {
+  // Anything outside of an `ALLOCATION_SCOPE()`, including coroutine bodies
+  // once they have resumed
+  OTHER,
+  CRYPTO,
+  JSON,
+  LOGGING,
+  NOTIFICATIONS,
+  PREVIEWS,
+  RPC,
+  SIGNALS,
+  TRANSPORT,
+  // Not reported; for example, in-process benchmark clients
+  EXCLUDED,
+};
+
+/** Counts heap allocations by subsystem, in builds with `ALLOCATION_TRACKING`.
+ *
+ * Tracking builds replace the global `operator new`, attributing each
+ * allocation to the innermost `ALLOCATION_SCOPE()` on the allocating thread.
+ * Scopes are per-thread, so must not span a `co_await`.
+ *
+ * In other builds, `ALLOCATION_SCOPE()` compiles to nothing, and the counts
+ * are always zero.
+ */
+class AllocationTracker final {
+ public:
+  static const size_t SCOPE_COUNT
+    = static_cast<size_t>(AllocationScope::EXCLUDED) + 1;
+
+  struct Counts {
+    uint64_t allocations = 0;
+    uint64_t bytes = 0;
+  };
+  typedef std::array<Counts, SCOPE_COUNT> Snapshot;
+
+  static constexpr bool isEnabled() {
+#ifdef STREAMING_REMOTE_ALLOCATION_TRACKING
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  static Snapshot getSnapshot();
+  // Everything except `EXCLUDED`
+  static Counts getTotal(const Snapshot& snapshot);
+  static const char* scopeToString(AllocationScope scope);
+
+  // Exports the counts as `streaming_remote_allocations_total{scope}` and
+  // `streaming_remote_allocated_bytes_total{scope}`, for `server/stats` and
+  // `/metrics`; does nothing unless enabled.
+  static void registerMetrics();
+
+  // Called by `operator new`
+  static void allocated(size_t bytes) {
+    auto& counts = sCounts[static_cast<size_t>(sCurrentScope)];
+    counts.allocations.fetch_add(1, std::memory_order_relaxed);
+    counts.bytes.fetch_add(bytes, std::memory_order_relaxed);
+  }
+
+  class Scope final {
+   public:
+    explicit Scope(AllocationScope scope) : mPrevious(sCurrentScope) {
+      sCurrentScope = scope;
+    }
+    Scope(const Scope&) = delete;
+    ~Scope() {
+      sCurrentScope = mPrevious;
+    }
+
+   private:
+    AllocationScope mPrevious;
+  };
+
+ private:
+  struct AtomicCounts {
+    std::atomic<uint64_t> allocations = 0;
+    std::atomic<uint64_t> bytes = 0;
+  };
+  // Constant-initialized, so usable by allocations during static
+  // initialization
+  static std::array<AtomicCounts, SCOPE_COUNT> sCounts;
+  inline static thread_local AllocationScope sCurrentScope
+    = AllocationScope::OTHER;
+};
+
+#ifdef STREAMING_REMOTE_ALLOCATION_TRACKING
+#define ALLOCATION_SCOPE(scope) \
+  AllocationTracker::Scope _allocation_scope(AllocationScope::scope)
+#else
+#define ALLOCATION_SCOPE(scope)
+#endif
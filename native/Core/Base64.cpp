@@ -0,0 +1,233 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#include "Base64.h"
+
+#include "Base64SIMD.h"
+
+#include <array>
+
+namespace {
+const char BASE64_ALPHABET[]
+  = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+const uint8_t INVALID = 0xff;
+
+constexpr std::array<uint8_t, 256> make_decode_table() {
+  std::array<uint8_t, 256> table {};
+  for (auto& value : table) {
+    value = INVALID;
+  }
+  for (uint8_t i = 0; i < 64; ++i) {
+    table[static_cast<uint8_t>(BASE64_ALPHABET[i])] = i;
+  }
+  return table;
+}
+constexpr auto DECODE_TABLE = make_decode_table();
+
+size_t encode_scalar(const uint8_t* in, size_t size, char* out) {
+  char* dest = out;
+  size_t i = 0;
+  for (; i + 3 <= size; i += 3) {
+    const uint32_t triple = (in[i] << 16) | (in[i + 1] << 8) | in[i + 2];
+    *dest++ = BASE64_ALPHABET[(triple >> 18) & 0x3f];
+    *dest++ = BASE64_ALPHABET[(triple >> 12) & 0x3f];
+    *dest++ = BASE64_ALPHABET[(triple >> 6) & 0x3f];
+    *dest++ = BASE64_ALPHABET[triple & 0x3f];
+  }
+
+  const auto remaining = size - i;
+  if (remaining == 1) {
+    const uint32_t triple = in[i] << 16;
+    *dest++ = BASE64_ALPHABET[(triple >> 18) & 0x3f];
+    *dest++ = BASE64_ALPHABET[(triple >> 12) & 0x3f];
+    *dest++ = '=';
+    *dest++ = '=';
+  } else if (remaining == 2) {
+    const uint32_t triple = (in[i] << 16) | (in[i + 1] << 8);
+    *dest++ = BASE64_ALPHABET[(triple >> 18) & 0x3f];
+    *dest++ = BASE64_ALPHABET[(triple >> 12) & 0x3f];
+    *dest++ = BASE64_ALPHABET[(triple >> 6) & 0x3f];
+    *dest++ = '=';
+  }
+  return dest - out;
+}
+
+std::optional<size_t> decode_scalar(const char* in, size_t size, uint8_t* out) {
+  if (size % 4 != 0) {
+    return {};
+  }
+  const auto src = reinterpret_cast<const uint8_t*>(in);
+  uint8_t* dest = out;
+  for (size_t i = 0; i < size; i += 4) {
+    const auto a = DECODE_TABLE[src[i]];
+    const auto b = DECODE_TABLE[src[i + 1]];
+    if ((a | b) == INVALID) {
+      return {};
+    }
+    const bool last = i + 4 == size;
+    // Padding is only valid at the very end
+    if (last && src[i + 2] == '=' && src[i + 3] == '=') {
+      *dest++ = (a << 2) | (b >> 4);
+      break;
+    }
+    const auto c = DECODE_TABLE[src[i + 2]];
+    if (c == INVALID) {
+      return {};
+    }
+    if (last && src[i + 3] == '=') {
+      *dest++ = (a << 2) | (b >> 4);
+      *dest++ = (b << 4) | (c >> 2);
+      break;
+    }
+    const auto d = DECODE_TABLE[src[i + 3]];
+    if (d == INVALID) {
+      return {};
+    }
+    *dest++ = (a << 2) | (b >> 4);
+    *dest++ = (b << 4) | (c >> 2);
+    *dest++ = (c << 6) | d;
+  }
+  return dest - out;
+}
+
+Base64Implementation best_implementation() {
+#ifdef BASE64_HAVE_X86_SIMD
+  if (base64_cpu_has_avx2()) {
+    return Base64Implementation::AVX2;
+  }
+  if (base64_cpu_has_ssse3()) {
+    return Base64Implementation::SSSE3;
+  }
+#endif
+  return Base64Implementation::SCALAR;
+}
+
+Base64Implementation get_implementation() {
+  static const auto impl = best_implementation();
+  return impl;
+}
+}// namespace
+
+size_t base64_encoded_size(size_t inputSize) {
+  return ((inputSize + 2) / 3) * 4;
+}
+
+size_t base64_decoded_max_size(size_t inputSize) {
+  return (inputSize / 4) * 3;
+}
+
+size_t base64_encode(
+  Base64Implementation impl,
+  std::string_view data,
+  char* out) {
+  const auto in = reinterpret_cast<const uint8_t*>(data.data());
+  size_t consumed = 0;
+  switch (impl) {
+    case Base64Implementation::SCALAR:
+      break;
+#ifdef BASE64_HAVE_X86_SIMD
+    case Base64Implementation::SSSE3:
+      consumed = base64_encode_ssse3(in, data.size(), out);
+      break;
+    case Base64Implementation::AVX2:
+      consumed = base64_encode_avx2(in, data.size(), out);
+      break;
+#else
+    default:
+      break;
+#endif
+  }
+  const auto written = (consumed / 3) * 4;
+  return written
+    + encode_scalar(in + consumed, data.size() - consumed, out + written);
+}
+
+std::optional<size_t> base64_decode(
+  Base64Implementation impl,
+  std::string_view data,
+  uint8_t* out) {
+  if (data.size() % 4 != 0) {
+    return {};
+  }
+  size_t consumed = 0;
+  switch (impl) {
+    case Base64Implementation::SCALAR:
+      break;
+#ifdef BASE64_HAVE_X86_SIMD
+    case Base64Implementation::SSSE3:
+      consumed = base64_decode_ssse3(data.data(), data.size(), out);
+      break;
+    case Base64Implementation::AVX2:
+      consumed = base64_decode_avx2(data.data(), data.size(), out);
+      break;
+#else
+    default:
+      break;
+#endif
+  }
+  const auto written = (consumed / 4) * 3;
+  const auto rest = decode_scalar(
+    data.data() + consumed, data.size() - consumed, out + written);
+  if (!rest) {
+    return {};
+  }
+  return written + *rest;
+}
+
+size_t base64_encode(std::string_view in, char* out) {
+  return base64_encode(get_implementation(), in, out);
+}
+
+std::optional<size_t> base64_decode(std::string_view in, uint8_t* out) {
+  return base64_decode(get_implementation(), in, out);
+}
+
+std::string base64_encode(std::string_view data) {
+  std::string out;
+  out.resize(base64_encoded_size(data.size()));
+  base64_encode(data, out.data());
+  return out;
+}
+
+std::optional<std::string> base64_decode(std::string_view data) {
+  std::string out;
+  out.resize(base64_decoded_max_size(data.size()));
+  const auto size
+    = base64_decode(data, reinterpret_cast<uint8_t*>(out.data()));
+  if (!size) {
+    return {};
+  }
+  out.resize(*size);
+  return out;
+}
+
+std::vector<Base64Implementation> base64_supported_implementations() {
+  std::vector<Base64Implementation> ret {Base64Implementation::SCALAR};
+#ifdef BASE64_HAVE_X86_SIMD
+  if (base64_cpu_has_ssse3()) {
+    ret.push_back(Base64Implementation::SSSE3);
+  }
+  if (base64_cpu_has_avx2()) {
+    ret.push_back(Base64Implementation::AVX2);
+  }
+#endif
+  return ret;
+}
+
+const char* base64_implementation_name(Base64Implementation impl) {
+  switch (impl) {
+    case Base64Implementation::SCALAR:
+      return "scalar";
+    case Base64Implementation::SSSE3:
+      return "ssse3";
+    case Base64Implementation::AVX2:
+      return "avx2";
+  }
+  return "unknown";
+}
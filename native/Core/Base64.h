@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/* Standard (RFC 4648) base64, with padding.
+ *
+ * Uses SSSE3 or AVX2 if the CPU supports them; the buffer-based functions
+ * let callers reuse allocations, or encode directly into a larger message.
+ */
+
+enum class Base64Implementation {
+  SCALAR,
+  SSSE3,
+  AVX2,
+};
+
+// Exact size of the encoded output
+size_t base64_encoded_size(size_t inputSize);
+// Upper bound; the actual size is smaller if the input is padded
+size_t base64_decoded_max_size(size_t inputSize);
+
+// `out` must have room for `base64_encoded_size(in.size())` bytes; returns the
+// number of bytes written.
+size_t base64_encode(std::string_view in, char* out);
+// `out` must have room for `base64_decoded_max_size(in.size())` bytes; returns
+// the number of bytes written, or nothing if `in` is not valid base64.
+std::optional<size_t> base64_decode(std::string_view in, uint8_t* out);
+
+std::string base64_encode(std::string_view data);
+std::optional<std::string> base64_decode(std::string_view data);
+
+// For benchmarks and validation; the functions above use the best supported
+// implementation.
+std::vector<Base64Implementation> base64_supported_implementations();
+const char* base64_implementation_name(Base64Implementation);
+size_t base64_encode(
+  Base64Implementation impl,
+  std::string_view in,
+  char* out);
+std::optional<size_t> base64_decode(
+  Base64Implementation impl,
+  std::string_view in,
+  uint8_t* out);
@@ -0,0 +1,255 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+// Based on the algorithms described by Wojciech Muła and Daniel Lemire in
+// "Faster Base64 Encoding and Decoding Using AVX2 Instructions", with
+// simpler range-based validation for decoding.
+
+#include "Base64SIMD.h"
+
+#ifdef BASE64_HAVE_X86_SIMD
+
+#include <immintrin.h>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+// MSVC allows any intrinsic in any function
+#define BASE64_TARGET(x)
+#else
+#define BASE64_TARGET(x) __attribute__((target(x)))
+#endif
+
+namespace {
+
+// Spreads 12 bytes in each 16-byte lane into four 6-bit values per 32 bits,
+// then maps them to ASCII.
+BASE64_TARGET("ssse3") __m128i encode_lane(__m128i in) {
+  in = _mm_shuffle_epi8(
+    in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+  const auto t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+  const auto t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+  const auto t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+  const auto t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+  const auto indices = _mm_or_si128(t1, t3);
+
+  // 0..25 -> 13, 26..51 -> 0, 52..61 -> 1..10, 62 -> 11, 63 -> 12
+  auto reduced = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+  const auto upper = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+  reduced = _mm_or_si128(reduced, _mm_and_si128(upper, _mm_set1_epi8(13)));
+  const auto offsets = _mm_setr_epi8(
+    'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+    '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+  return _mm_add_epi8(_mm_shuffle_epi8(offsets, reduced), indices);
+}
+
+BASE64_TARGET("avx2") __m256i encode_lanes(__m256i in) {
+  in = _mm256_shuffle_epi8(
+    in,
+    _mm256_set_epi8(
+      10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1, 10, 11, 9, 10, 7, 8, 6,
+      7, 4, 5, 3, 4, 1, 2, 0, 1));
+  const auto t0 = _mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00));
+  const auto t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+  const auto t2 = _mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0));
+  const auto t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+  const auto indices = _mm256_or_si256(t1, t3);
+
+  auto reduced = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+  const auto upper = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+  reduced
+    = _mm256_or_si256(reduced, _mm256_and_si256(upper, _mm256_set1_epi8(13)));
+  const auto offsets = _mm256_setr_epi8(
+    'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+    '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+    'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+    '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+  return _mm256_add_epi8(_mm256_shuffle_epi8(offsets, reduced), indices);
+}
+
+// Returns a mask of bytes in [low, high]; bytes >= 0x80 are never in range,
+// as the comparisons are signed.
+BASE64_TARGET("ssse3") __m128i in_range(__m128i in, char low, char high) {
+  return _mm_and_si128(
+    _mm_cmpgt_epi8(in, _mm_set1_epi8(low - 1)),
+    _mm_cmpgt_epi8(_mm_set1_epi8(high + 1), in));
+}
+
+BASE64_TARGET("avx2") __m256i in_range(__m256i in, char low, char high) {
+  return _mm256_and_si256(
+    _mm256_cmpgt_epi8(in, _mm256_set1_epi8(low - 1)),
+    _mm256_cmpgt_epi8(_mm256_set1_epi8(high + 1), in));
+}
+
+// Maps ASCII to 6-bit values; returns false if there are any characters
+// outside of the alphabet.
+BASE64_TARGET("ssse3") bool decode_values(__m128i in, __m128i* values) {
+  const auto upper = in_range(in, 'A', 'Z');
+  const auto lower = in_range(in, 'a', 'z');
+  const auto digit = in_range(in, '0', '9');
+  const auto plus = _mm_cmpeq_epi8(in, _mm_set1_epi8('+'));
+  const auto slash = _mm_cmpeq_epi8(in, _mm_set1_epi8('/'));
+
+  const auto valid = _mm_or_si128(
+    _mm_or_si128(upper, lower), _mm_or_si128(_mm_or_si128(digit, plus), slash));
+  if (_mm_movemask_epi8(valid) != 0xffff) {
+    return false;
+  }
+
+  auto shift = _mm_and_si128(upper, _mm_set1_epi8(-'A'));
+  shift = _mm_or_si128(shift, _mm_and_si128(lower, _mm_set1_epi8(26 - 'a')));
+  shift = _mm_or_si128(shift, _mm_and_si128(digit, _mm_set1_epi8(52 - '0')));
+  shift = _mm_or_si128(shift, _mm_and_si128(plus, _mm_set1_epi8(62 - '+')));
+  shift = _mm_or_si128(shift, _mm_and_si128(slash, _mm_set1_epi8(63 - '/')));
+  *values = _mm_add_epi8(in, shift);
+  return true;
+}
+
+BASE64_TARGET("avx2") bool decode_values(__m256i in, __m256i* values) {
+  const auto upper = in_range(in, 'A', 'Z');
+  const auto lower = in_range(in, 'a', 'z');
+  const auto digit = in_range(in, '0', '9');
+  const auto plus = _mm256_cmpeq_epi8(in, _mm256_set1_epi8('+'));
+  const auto slash = _mm256_cmpeq_epi8(in, _mm256_set1_epi8('/'));
+
+  const auto valid = _mm256_or_si256(
+    _mm256_or_si256(upper, lower),
+    _mm256_or_si256(_mm256_or_si256(digit, plus), slash));
+  if (_mm256_movemask_epi8(valid) != -1) {
+    return false;
+  }
+
+  auto shift = _mm256_and_si256(upper, _mm256_set1_epi8(-'A'));
+  shift = _mm256_or_si256(
+    shift, _mm256_and_si256(lower, _mm256_set1_epi8(26 - 'a')));
+  shift = _mm256_or_si256(
+    shift, _mm256_and_si256(digit, _mm256_set1_epi8(52 - '0')));
+  shift = _mm256_or_si256(
+    shift, _mm256_and_si256(plus, _mm256_set1_epi8(62 - '+')));
+  shift = _mm256_or_si256(
+    shift, _mm256_and_si256(slash, _mm256_set1_epi8(63 - '/')));
+  *values = _mm256_add_epi8(in, shift);
+  return true;
+}
+
+// Packs four 6-bit values per 32 bits into 12 bytes at the start of each lane
+BASE64_TARGET("ssse3") __m128i pack_lane(__m128i values) {
+  const auto pairs = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+  const auto merged = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00011000));
+  return _mm_shuffle_epi8(
+    merged,
+    _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+}
+
+BASE64_TARGET("avx2") __m256i pack_lanes(__m256i values) {
+  const auto pairs
+    = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+  const auto merged = _mm256_madd_epi16(pairs, _mm256_set1_epi32(0x00011000));
+  const auto packed = _mm256_shuffle_epi8(
+    merged,
+    _mm256_setr_epi8(
+      2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1, 2, 1, 0, 6, 5, 4,
+      10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+  // Move the 12 bytes from the upper lane down next to the lower lane's
+  return _mm256_permutevar8x32_epi32(
+    packed, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7));
+}
+
+}// namespace
+
+bool base64_cpu_has_ssse3() {
+#if defined(_MSC_VER) && !defined(__clang__)
+  int info[4];
+  __cpuid(info, 1);
+  return (info[2] & (1 << 9)) != 0;
+#else
+  return __builtin_cpu_supports("ssse3");
+#endif
+}
+
+bool base64_cpu_has_avx2() {
+#if defined(_MSC_VER) && !defined(__clang__)
+  int info[4];
+  __cpuid(info, 0);
+  if (info[0] < 7) {
+    return false;
+  }
+  __cpuid(info, 1);
+  // The OS must also save the AVX registers
+  const bool osxsave = (info[2] & (1 << 27)) != 0;
+  if (!(osxsave && (_xgetbv(0) & 0x6) == 0x6)) {
+    return false;
+  }
+  __cpuidex(info, 7, 0);
+  return (info[1] & (1 << 5)) != 0;
+#else
+  return __builtin_cpu_supports("avx2");
+#endif
+}
+
+// Each block reads 16 bytes but only uses 12
+BASE64_TARGET("ssse3")
+size_t base64_encode_ssse3(const uint8_t* in, size_t size, char* out) {
+  size_t i = 0;
+  for (; i + 16 <= size; i += 12, out += 16) {
+    const auto block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), encode_lane(block));
+  }
+  return i;
+}
+
+// Each block reads 28 bytes - 16 at `in`, and 16 at `in + 12` - but only uses
+// 24
+BASE64_TARGET("avx2")
+size_t base64_encode_avx2(const uint8_t* in, size_t size, char* out) {
+  size_t i = 0;
+  for (; i + 28 <= size; i += 24, out += 32) {
+    const auto lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+    const auto hi
+      = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i + 12));
+    const auto block
+      = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), encode_lanes(block));
+  }
+  return i + base64_encode_ssse3(in + i, size - i, out);
+}
+
+// Each block writes 16 bytes but only 12 are valid; stopping while at least
+// 8 more characters remain guarantees that the caller's buffer has room for
+// the extra 4.
+BASE64_TARGET("ssse3")
+size_t base64_decode_ssse3(const char* in, size_t size, uint8_t* out) {
+  size_t i = 0;
+  for (; i + 24 <= size; i += 16, out += 12) {
+    const auto block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+    __m128i values;
+    if (!decode_values(block, &values)) {
+      break;
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), pack_lane(values));
+  }
+  return i;
+}
+
+// As above, but each block writes 32 bytes, of which 24 are valid
+BASE64_TARGET("avx2")
+size_t base64_decode_avx2(const char* in, size_t size, uint8_t* out) {
+  size_t i = 0;
+  for (; i + 48 <= size; i += 32, out += 24) {
+    const auto block
+      = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+    __m256i values;
+    if (!decode_values(block, &values)) {
+      // Let the smaller decoder or the scalar one find the problem
+      break;
+    }
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), pack_lanes(values));
+  }
+  return i + base64_decode_ssse3(in + i, size - i, out);
+}
+
+#endif
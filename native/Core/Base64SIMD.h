@@ -0,0 +1,33 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#pragma once
+
+// Internal to Base64.cpp
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) \
+  || defined(_M_IX86)
+#define BASE64_HAVE_X86_SIMD 1
+
+bool base64_cpu_has_ssse3();
+bool base64_cpu_has_avx2();
+
+// These handle as much of the input as they can in whole SIMD blocks, and
+// return how many input bytes they consumed; the caller handles the rest.
+//
+// Decoders stop early at the first block containing anything other than the
+// 64 alphabet characters - including padding - so that the scalar decoder
+// can deal with the tail, and with errors.
+size_t base64_encode_ssse3(const uint8_t* in, size_t size, char* out);
+size_t base64_encode_avx2(const uint8_t* in, size_t size, char* out);
+size_t base64_decode_ssse3(const char* in, size_t size, uint8_t* out);
+size_t base64_decode_avx2(const char* in, size_t size, uint8_t* out);
+#endif
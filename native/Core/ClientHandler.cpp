@@ -11,17 +11,232 @@
 #include <asio.hpp>
 #include <sodium.h>
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <memory>
+#include <set>
 
+#include "AdaptiveQuality.h"
+#include "AllocationTracker.h"
+#include "Base64.h"
+#include "ContentHash.h"
+#include "FlightRecorder.h"
+#include "HandshakeMessages.h"
+#include "ImageTiles.h"
 #include "Logger.h"
 #include "MessageInterface.h"
+#include "Metrics.h"
+#include "PreviewDeltaTracker.h"
+#include "PreviewFrame.h"
+#include "PreviewManager.h"
 #include "StreamingSoftware.h"
 
 using json = nlohmann::json;
 
+namespace {
+std::atomic<uint64_t> sLastConnectionId = 0;
+
+// Other methods are labelled "unknown" in metrics, so that clients can't
+// create an unbounded number of them
+const std::set<std::string, std::less<>> RPC_METHODS {
+  "connection/getStats",
+  "outputs/get",
+  "outputs/setDelay",
+  "outputs/start",
+  "outputs/stop",
+  "ping",
+  "previews/ack",
+  "previews/subscribe",
+  "previews/unsubscribe",
+  "scenes/activate",
+  "scenes/get",
+  "scenes/getThumbnail",
+  "scenes/getThumbnails",
+  "server/connections",
+  "server/disconnect",
+  "server/stats",
+  "trace/get",
+  "trace/start",
+  "trace/stop",
+};
+
+Histogram& get_request_latency(std::string_view method) {
+  return Metrics::histogram(
+    "streaming_remote_request_duration_seconds",
+    "Time taken to handle JSON-RPC requests, including backend calls",
+    {{"method",
+      std::string(RPC_METHODS.contains(method) ? method : "unknown")}},
+    1e-9);
+}
+
+// Time constant for `MethodStats::perSecond`
+const double REQUEST_RATE_SECONDS = 10;
+
+double decay_request_rate(
+  double perSecond,
+  Clock::time_point from,
+  Clock::time_point to) {
+  const std::chrono::duration<double> elapsed = to - from;
+  return perSecond * std::exp(-elapsed.count() / REQUEST_RATE_SECONDS);
+}
+
+Counter& get_handshakes(const char* transport, const char* result) {
+  return Metrics::counter(
+    "streaming_remote_handshakes_total",
+    "Completed or abandoned handshakes",
+    {{"transport", transport}, {"result", result}});
+}
+
+// Removes a map entry when destroyed, unless it has since been replaced
+template <typename TMap>
+class ScopedMapEntry final {
+ public:
+  ScopedMapEntry(
+    TMap& map,
+    const typename TMap::key_type& key,
+    const typename TMap::mapped_type& value)
+    : mMap(map), mKey(key), mValue(value) {
+    mMap.insert_or_assign(key, value);
+  }
+  ScopedMapEntry(const ScopedMapEntry&) = delete;
+
+  ~ScopedMapEntry() {
+    auto it = mMap.find(mKey);
+    if (it != mMap.end() && it->second == mValue) {
+      mMap.erase(it);
+    }
+  }
+
+ private:
+  TMap& mMap;
+  typename TMap::key_type mKey;
+  typename TMap::mapped_type mValue;
+};
+
+double to_microseconds(uint64_t nanoseconds) {
+  return nanoseconds / 1000.0;
+}
+
+// `since` must come from `Clock`, which may be simulated
+uint64_t nanoseconds_since(Clock::time_point since) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+           Clock::now() - since)
+    .count();
+}
+
+// Records the request in the flight recorder once it has been handled
+class RecordedRpc final {
+ public:
+  RecordedRpc(
+    uint64_t connectionId,
+    const std::string& method,
+    uint64_t received)
+    : mConnectionId(connectionId), mMethod(method), mReceived(received) {
+  }
+  RecordedRpc(const RecordedRpc&) = delete;
+
+  ~RecordedRpc() {
+    if (FlightRecorder::isEnabled()) {
+      FlightRecorder::record(
+        FlightRecorder::EventType::RPC, mConnectionId,
+        Trace::now() - mReceived, mMethod);
+    }
+  }
+
+ private:
+  uint64_t mConnectionId;
+  const std::string& mMethod;
+  uint64_t mReceived;
+};
+}// namespace
+
+// Traces and times a call to the streaming software
+class ClientHandler::BackendCall final {
+ public:
+  BackendCall(const char* call, Request& request)
+    : mRequest(request),
+      mSpan("backend", request.trace),
+      mTimer(Metrics::histogram(
+        "streaming_remote_backend_duration_seconds",
+        "Time taken by the streaming software to handle requests",
+        {{"call", call}}, 1e-9)),
+      mStart(Trace::now()) {
+    mSpan.setDetail(call);
+  }
+  BackendCall(const BackendCall&) = delete;
+
+  ~BackendCall() {
+    end();
+  }
+
+  void end() {
+    if (!mStart) {
+      return;
+    }
+    mRequest.backend += Trace::now() - mStart;
+    mStart = 0;
+    mTimer.stop();
+    mSpan.end();
+  }
+
+ private:
+  Request& mRequest;
+  TraceSpan mSpan;
+  HistogramTimer mTimer;
+  uint64_t mStart;
+};
+
+struct ClientHandler::TransportMetrics {
+  explicit TransportMetrics(const char* transport)
+    : bytesIn(get_transferred("bytes", transport, "in")),
+      bytesOut(get_transferred("bytes", transport, "out")),
+      framesIn(get_transferred("frames", transport, "in")),
+      framesOut(get_transferred("frames", transport, "out")),
+      sendQueueBytes(Metrics::histogram(
+        "streaming_remote_send_queue_bytes",
+        "Bytes queued for a connection when another message is sent",
+        {{"transport", transport}})),
+      handshaking(get_connections(transport, "handshake")),
+      authenticated(get_connections(transport, "authenticated")),
+      handshakeSucceeded(get_handshakes(transport, "success")),
+      handshakeFailed(get_handshakes(transport, "failure")) {
+    Metrics::counter(
+      "streaming_remote_connections_total", "Accepted connections",
+      {{"transport", transport}})
+      .increment();
+  }
+
+  Counter& bytesIn;
+  Counter& bytesOut;
+  Counter& framesIn;
+  Counter& framesOut;
+  Histogram& sendQueueBytes;
+  Gauge& handshaking;
+  Gauge& authenticated;
+  Counter& handshakeSucceeded;
+  Counter& handshakeFailed;
+
+ private:
+  static Counter& get_transferred(
+    const char* unit,
+    const char* transport,
+    const char* direction) {
+    return Metrics::counter(
+      fmt::format("streaming_remote_{}_total", unit),
+      fmt::format("Encrypted {} sent or received", unit),
+      {{"transport", transport}, {"direction", direction}});
+  }
+
+  static Gauge& get_connections(const char* transport, const char* state) {
+    return Metrics::gauge(
+      "streaming_remote_connections", "Open connections",
+      {{"transport", transport}, {"state", state}});
+  }
+};
+
 #define clean_later() \
-  asio::post(*mIoContext, [this]() { mConnection->disconnect(); });
+  asio::post(mConnection->getStrand(), [this]() { mConnection->disconnect(); });
 
 #define clean_and_return() \
   clean_later(); \
@@ -42,37 +257,97 @@ using json = nlohmann::json;
   }
 
 ClientHandler::ClientHandler(
-  std::shared_ptr<asio::io_context> context,
   std::shared_ptr<StreamingSoftware> software,
+  std::shared_ptr<PreviewManager> previews,
+  std::shared_ptr<ConnectionRegistry> connections,
   std::unique_ptr<MessageInterface> connection)
   :
-    mIoContext(context),
+    mConnectionId(++sLastConnectionId),
     mSoftware(software),
+    mPreviews(previews),
+    mConnections(connections),
     mConnection(std::move(connection)),
+    mMetrics(
+      std::make_unique<TransportMetrics>(mConnection->getTransportName())),
+    mConnectedAt(Clock::now()),
+    mLastActivity(mConnectedAt),
     mState(ClientState::UNINITIALIZED) {
-  connect(mSoftware->outputStateChanged, this, &ClientHandler::outputStateChanged);
-  connect(mSoftware->currentSceneChanged, this, &ClientHandler::currentSceneChanged);
+  mMetrics->handshaking.add();
+  if (FlightRecorder::isEnabled()) {
+    FlightRecorder::record(
+      FlightRecorder::EventType::CONNECTION_OPENED, mConnectionId, 0,
+      fmt::format(
+        "{} {}", mConnection->getTransportName(),
+        mConnection->getPeerAddress()));
+  }
+  mConnections->add(
+    mConnectionId, {mConnection->getStrand(), mAlive, this});
+  // Emitted from the software's own threads
+  connect(
+    mSoftware->outputStateChanged, mConnection->getStrand(), this,
+    &ClientHandler::outputStateChanged);
+  connect(
+    mSoftware->currentSceneChanged, mConnection->getStrand(), this,
+    &ClientHandler::currentSceneChanged);
   mConnection->messageReceived.connect(
     [this](const std::string& message) {
+      ALLOCATION_SCOPE(RPC);
+      mMetrics->framesIn.increment();
+      mMetrics->bytesIn.increment(message.size());
+      mLastActivity = Clock::now();
+      const auto received = Trace::now();
       asio::co_spawn(
-        *this->mIoContext,
-        this->messageReceived(message),
+        this->mConnection->getStrand(),
+        this->messageReceived(message, received),
         asio::detached
       );
     }
    );
   mConnection->disconnected.connect([this]() {
     Logger::debug("Client disconnected");
-    asio::post(*mIoContext, [this]() { delete this; });
+    asio::post(mConnection->getStrand(), [this]() { delete this; });
   });
 }
 
 ClientHandler::~ClientHandler() {
   LOG_FUNCTION();
+  mConnections->remove(mConnectionId);
+  const auto age = nanoseconds_since(mConnectedAt);
+  if (mState == ClientState::AUTHENTICATED) {
+    mMetrics->authenticated.sub();
+  } else {
+    mMetrics->handshaking.sub();
+    mMetrics->handshakeFailed.increment();
+    FlightRecorder::record(
+      FlightRecorder::EventType::HANDSHAKE_FAILED, mConnectionId, age);
+  }
+  FlightRecorder::record(
+    FlightRecorder::EventType::CONNECTION_CLOSED, mConnectionId, age,
+    mState == ClientState::AUTHENTICATED ? "authenticated" : "handshake");
   cleanCrypto();
 }
 
-asio::awaitable<void> ClientHandler::messageReceived(const std::string message) {
+asio::awaitable<void> ClientHandler::messageReceived(
+  const std::string message,
+  uint64_t received) {
+  Request request {
+    .trace = {
+      .connectionId = mConnectionId,
+      .requestId = mState == ClientState::AUTHENTICATED ? ++mLastRequestId : 0,
+    },
+    .received = received,
+    .started = Trace::now(),
+  };
+  const auto& trace = request.trace;
+  const bool tracing = Trace::isEnabled();
+  TraceSpan span(
+    mState == ClientState::AUTHENTICATED ? "rpc" : "handshake", trace,
+    tracing ? received : 0);
+  if (tracing) {
+    // Time spent waiting for the strand
+    Trace::record("receive", trace, received, request.started);
+  }
+
   switch (mState) {
     case ClientState::UNINITIALIZED:
       handshakeClientHelloMessageReceived(message);
@@ -81,66 +356,110 @@ asio::awaitable<void> ClientHandler::messageReceived(const std::string message)
       handshakeClientReadyMessageReceived(message);
       co_return;
     case ClientState::AUTHENTICATED:
-      co_await encryptedRpcMessageReceived(message);
+      co_await encryptedRpcMessageReceived(message, request);
       co_return;
   }
 }
 
-asio::awaitable<void> ClientHandler::encryptedRpcMessageReceived(const std::string& c) {
-  // No variable length arrays on MSVC :'(
-  const size_t psize = c.size() - crypto_secretstream_xchacha20poly1305_ABYTES;
-  auto p = std::unique_ptr<unsigned char>(new unsigned char[psize]);
-  unsigned long long plen;
-  unsigned char tag;
-  const auto result = crypto_secretstream_xchacha20poly1305_pull(
-    &this->mCryptoPullState, p.get(), &plen, &tag,
-    reinterpret_cast<const unsigned char*>(c.data()), c.size(), nullptr, 0);
+asio::awaitable<void> ClientHandler::encryptedRpcMessageReceived(
+  const std::string& c,
+  Request& request) {
+  TraceSpan decrypt("decrypt", request.trace);
+  const auto decryptStarted = Trace::now();
+  clean_and_coreturn_unless(
+    c.size() >= crypto_secretstream_xchacha20poly1305_ABYTES);
+  // Decrypt straight into the string that is passed on, rather than into a
+  // temporary buffer
+  std::string p;
+  int result;
+  {
+    ALLOCATION_SCOPE(CRYPTO);
+    p.resize(c.size() - crypto_secretstream_xchacha20poly1305_ABYTES);
+    unsigned long long plen;
+    unsigned char tag;
+    result = crypto_secretstream_xchacha20poly1305_pull(
+      &this->mCryptoPullState, reinterpret_cast<unsigned char*>(p.data()),
+      &plen, &tag, reinterpret_cast<const unsigned char*>(c.data()), c.size(),
+      nullptr, 0);
+    assert(result != 0 || plen == p.size());
+  }
   clean_and_coreturn_unless(result == 0);
-  assert(plen <= psize);
-  co_await plaintextRpcMessageReceived(
-    std::string(reinterpret_cast<const char*>(p.get()), plen));
+  decrypt.end();
+  request.decrypt = Trace::now() - decryptStarted;
+  co_await plaintextRpcMessageReceived(p, request);
 }
 
-asio::awaitable<void> ClientHandler::plaintextRpcMessageReceived(const std::string& message) {
+asio::awaitable<void> ClientHandler::plaintextRpcMessageReceived(
+  const std::string& message,
+  Request& request) {
   LOG_FUNCTION();
-  auto jsonrpc = json::parse(message);
+  if (mSession) {
+    mSession->record(SessionRecorder::RecordType::REQUEST, message);
+  }
+  const auto& trace = request.trace;
+  request.dispatchStarted = Trace::now();
+  TraceSpan parse("parse", trace);
+  json jsonrpc;
+  {
+    ALLOCATION_SCOPE(JSON);
+    jsonrpc = json::parse(message);
+  }
+  parse.end();
   if (jsonrpc["jsonrpc"] != "2.0") {
     clean_and_coreturn();
   }
 
   std::string method = jsonrpc["method"];
-  Logger::debug("Received JsonRPC call {}", method);
+  Logger::trace("Received JsonRPC call {}", method);
+  TraceSpan dispatch("dispatch", trace);
+  HistogramTimer latency(get_request_latency(method));
+  RecordedRpc recorded(mConnectionId, method, request.received);
+  requestReceived(method);
+  std::optional<ScopedMapEntry<decltype(mTimedRequests)>> timed;
+  if (jsonrpc.value("serverTiming", false) && jsonrpc.contains("id")) {
+    timed.emplace(mTimedRequests, jsonrpc["id"].dump(), &request);
+  }
+  if (dispatch.isRecording()) {
+    dispatch.setDetail(fmt::format("{} {}", method, jsonrpc["id"].dump()));
+  }
 
   if (method == "outputs/get") {
+    BackendCall backend("getOutputs", request);
     const auto outputs = co_await mSoftware->getOutputs();
+    backend.end();
     json outputsJson;
     for (const auto& output : outputs) {
       outputsJson[output.id] = output.toJson();
     }
 
     encryptThenSendMessage(
-      (json{{"jsonrpc", "2.0"}, {"id", jsonrpc["id"]}, {"result", outputsJson}})
-        .dump());
+      {{"jsonrpc", "2.0"}, {"id", jsonrpc["id"]}, {"result", outputsJson}});
     co_return;
   }
 
   if (method == "outputs/start") {
+    BackendCall backend("startOutput", request);
     co_await mSoftware->startOutput(jsonrpc["params"]["id"]);
+    backend.end();
     encryptThenSendMessage(
       {{"jsonrpc", "2.0"}, {"id", jsonrpc["id"]}, {"result", json::object()}});
     co_return;
   }
 
   if (method == "outputs/stop") {
+    BackendCall backend("stopOutput", request);
     co_await mSoftware->stopOutput(jsonrpc["params"]["id"]);
+    backend.end();
     encryptThenSendMessage(
       {{"jsonrpc", "2.0"}, {"id", jsonrpc["id"]}, {"result", json::object()}});
     co_return;
   }
 
   if (method == "outputs/setDelay") {
+    BackendCall backend("setOutputDelay", request);
     const bool success = co_await mSoftware->setOutputDelay(
       jsonrpc["params"]["id"], jsonrpc["params"]["seconds"]);
+    backend.end();
     json response{
       {"jsonrpc", "2.0"},
       {"id", jsonrpc["id"]},
@@ -156,20 +475,23 @@ asio::awaitable<void> ClientHandler::plaintextRpcMessageReceived(const std::stri
   }
 
   if (method == "scenes/get") {
+    BackendCall backend("getScenes", request);
     const auto scenes = co_await mSoftware->getScenes();
+    backend.end();
     json scenesJson;
     for (const auto& scene : scenes) {
       scenesJson[scene.id] = scene.toJson();
     }
 
     encryptThenSendMessage(
-      (json{{"jsonrpc", "2.0"}, {"id", jsonrpc["id"]}, {"result", scenesJson}})
-        .dump());
+      {{"jsonrpc", "2.0"}, {"id", jsonrpc["id"]}, {"result", scenesJson}});
     co_return;
   }
 
   if (method == "scenes/activate") {
+    BackendCall backend("activateScene", request);
     const auto success = co_await mSoftware->activateScene(jsonrpc["params"]["id"]);
+    backend.end();
     encryptThenSendMessage(
       {{"jsonrpc", "2.0"}, {"id", jsonrpc["id"]}, {"result", success}});
     co_return;
@@ -177,9 +499,36 @@ asio::awaitable<void> ClientHandler::plaintextRpcMessageReceived(const std::stri
 
   if (method == "scenes/getThumbnail") {
     if (jsonrpc["params"]["content_type"] == "image/png") {
+      if (
+        jsonrpc["params"].value("acceptDelta", false)
+        && co_await sendThumbnailDelta(jsonrpc, request)
+      ) {
+        co_return;
+      }
+      BackendCall backend("getSceneThumbnailAsBase64Png", request);
       const auto image = co_await mSoftware->getSceneThumbnailAsBase64Png(jsonrpc["params"]["id"]);
+      backend.end();
       Logger::debug("Got thumbnail");
       if (!image.empty()) {
+        const auto hash = content_hash(image);
+        const auto& params = jsonrpc["params"];
+        if (
+          params.contains("ifNoneMatch")
+          && params["ifNoneMatch"] == hash
+        ) {
+          Logger::debug("Thumbnail not modified");
+          encryptThenSendMessage({
+            {"jsonrpc", "2.0"},
+            {"id", jsonrpc["id"]},
+            {"result", {
+              {"id", params["id"]},
+              {"content_type", "image/png"},
+              {"hash", hash},
+              {"notModified", true}
+            }}
+          });
+          co_return;
+        }
         Logger::debug("Sending success");
         encryptThenSendMessage({
           {"jsonrpc", "2.0"},
@@ -187,6 +536,7 @@ asio::awaitable<void> ClientHandler::plaintextRpcMessageReceived(const std::stri
           {"result", {
             {"id", jsonrpc["params"]["id"]},
             {"content_type", "image/png"},
+            {"hash", hash},
             {"base64_data", image}
           }}
         });
@@ -201,30 +551,303 @@ asio::awaitable<void> ClientHandler::plaintextRpcMessageReceived(const std::stri
       co_return;
     }
   }
+
+  if (method == "scenes/getThumbnails") {
+    const auto& params = jsonrpc["params"];
+    const std::vector<std::string> ids = params["ids"];
+    const uint32_t size = params.value("size", 0);
+    const auto ifNoneMatch = params.value("ifNoneMatch", json::object());
+    const auto requestId = jsonrpc["id"];
+
+    std::vector<std::string> unsupported;
+    json failed = json::array();
+    // Owned by this request too: another `getThumbnails` with different
+    // bounds may replace `mThumbnailQuality` while we wait for the captures
+    std::shared_ptr<QualitySelector> quality;
+    if (params.contains("adaptive")) {
+      const auto bounds = QualityBounds::fromJson(params["adaptive"], size);
+      if (!(mThumbnailQuality && mThumbnailQuality->getBounds() == bounds)) {
+        mThumbnailQuality = std::make_shared<QualitySelector>(bounds);
+      }
+      quality = mThumbnailQuality;
+    }
+
+    auto sendThumbnail = [&](const std::string& id, const Image& image,
+                             const std::string& contentType,
+                             const std::string& base64Data) {
+      if (base64Data.empty()) {
+        failed.push_back(id);
+        return;
+      }
+      json thumbnail{
+        {"requestId", requestId},
+        {"id", id},
+        {"content_type", contentType},
+        {"hash", content_hash(base64Data)},
+      };
+      if (!image.empty()) {
+        thumbnail["width"] = image.width;
+        thumbnail["height"] = image.height;
+      }
+      if (ifNoneMatch.value(id, "") == thumbnail["hash"]) {
+        thumbnail["notModified"] = true;
+      } else {
+        thumbnail["base64_data"] = base64Data;
+      }
+      encryptThenSendMessage(
+        {{"jsonrpc", "2.0"},
+         {"method", "scenes/thumbnail"},
+         {"params", thumbnail}});
+    };
+
+    // Each thumbnail is sent as soon as it's ready, not when the batch is
+    BackendCall backend("captureScenes", request);
+    co_await mSoftware->captureScenes(
+      ids, size, [&](const std::string& id, Image image) {
+        if (image.empty()) {
+          unsupported.push_back(id);
+          return;
+        }
+        if (!quality) {
+          sendThumbnail(
+            id, image, "image/png",
+            base64_encode(mSoftware->encodeImage(image, "image/png", -1)));
+          return;
+        }
+        // Aim to send the whole batch within about a second
+        mThroughput.sample(mConnection->getPendingSendBytes());
+        const auto tier = quality->select(
+          image.width, image.height, mThroughput.getBytesPerSecond(),
+          ids.size());
+        image = image.scaledToFit(tier.maxDimension);
+        auto contentType = tier.contentType;
+        auto encoded = mSoftware->encodeImage(image, contentType, tier.quality);
+        if (encoded.empty()) {
+          contentType = "image/png";
+          encoded = mSoftware->encodeImage(image, contentType, -1);
+        }
+        const auto base64Data = base64_encode(encoded);
+        quality->encoded(tier, image.width, image.height, base64Data.size());
+        sendThumbnail(id, image, contentType, base64Data);
+      });
+    backend.end();
+    for (const auto& id : unsupported) {
+      BackendCall fallback("getSceneThumbnailAsBase64Png", request);
+      sendThumbnail(
+        id, Image(), "image/png",
+        co_await mSoftware->getSceneThumbnailAsBase64Png(id));
+    }
+
+    encryptThenSendMessage(
+      {{"jsonrpc", "2.0"},
+       {"id", requestId},
+       {"result", {{"failed", failed}}}});
+    co_return;
+  }
+
+  if (method == "previews/subscribe") {
+    const auto& params = jsonrpc["params"];
+    const std::string sceneId = params["sceneId"];
+    const uint16_t maxFps = params.value("maxFps", 1);
+    const uint32_t size = params.value("size", 0);
+    // Replaces any existing subscription for this scene
+    mPreviewSubscriptions.erase(sceneId);
+    auto subscription = std::make_unique<PreviewSubscription>();
+    subscription->maxDimension = size;
+    subscription->maxFps = maxFps;
+    if (params.value("delta", false)) {
+      subscription->delta = std::make_unique<PreviewDeltaTracker>();
+    }
+    if (params.contains("adaptive")) {
+      subscription->quality = std::make_unique<QualitySelector>(
+        QualityBounds::fromJson(params["adaptive"], size));
+    }
+    // Frames are delivered on the preview manager's strand; the subscription
+    // may have been replaced or removed by the time we're back on ours.
+    std::weak_ptr<bool> alive(mAlive);
+    subscription->connection.emplace(mPreviews->subscribe(
+      sceneId, maxFps, size,
+      [this, alive, sceneId, strand = mConnection->getStrand(),
+       subscription = subscription.get()](
+        const std::shared_ptr<PreviewFrame>& frame) {
+        asio::post(strand, [=, this]() {
+          if (alive.expired()) {
+            return;
+          }
+          auto it = mPreviewSubscriptions.find(sceneId);
+          if (
+            it != mPreviewSubscriptions.end()
+            && it->second.get() == subscription) {
+            previewFrameAvailable(frame, *subscription);
+          }
+        });
+      }));
+    mPreviewSubscriptions.emplace(sceneId, std::move(subscription));
+    encryptThenSendMessage(
+      {{"jsonrpc", "2.0"}, {"id", jsonrpc["id"]}, {"result", json::object()}});
+    co_return;
+  }
+
+  if (method == "previews/unsubscribe") {
+    mPreviewSubscriptions.erase(
+      jsonrpc["params"]["sceneId"].get<std::string>());
+    encryptThenSendMessage(
+      {{"jsonrpc", "2.0"}, {"id", jsonrpc["id"]}, {"result", json::object()}});
+    co_return;
+  }
+
+  if (method == "ping") {
+    json result {
+      {"serverTimestamp",
+       std::chrono::duration_cast<std::chrono::milliseconds>(
+         std::chrono::system_clock::now().time_since_epoch())
+         .count()},
+    };
+    const auto params = jsonrpc.value("params", json::object());
+    if (params.contains("clientTimestamp")) {
+      result["clientTimestamp"] = params["clientTimestamp"];
+    }
+    encryptThenSendMessage(
+      {{"jsonrpc", "2.0"}, {"id", jsonrpc["id"]}, {"result", result}});
+    co_return;
+  }
+
+  if (method == "server/connections") {
+    json connections = json::array();
+    for (const auto& [id, connection] : mConnections->getAll()) {
+      // Other connections' state may only be accessed on their strands
+      auto info = co_await asio::co_spawn(
+        connection.strand, getConnectionInfo(connection), asio::use_awaitable);
+      if (info.is_null()) {
+        continue;
+      }
+      info["current"] = (id == mConnectionId);
+      connections.push_back(info);
+    }
+    encryptThenSendMessage(
+      {{"jsonrpc", "2.0"},
+       {"id", jsonrpc["id"]},
+       {"result", {{"connections", connections}}}});
+    co_return;
+  }
+
+  if (method == "server/disconnect") {
+    const auto connection
+      = mConnections->get(jsonrpc["params"]["id"].get<uint64_t>());
+    encryptThenSendMessage(
+      {{"jsonrpc", "2.0"},
+       {"id", jsonrpc["id"]},
+       {"result", {{"disconnected", connection.has_value()}}}});
+    if (connection) {
+      asio::post(connection->strand, [connection = *connection]() {
+        if (!connection.alive.expired()) {
+          connection.handler->mConnection->disconnect();
+        }
+      });
+    }
+    co_return;
+  }
+
+  if (method == "server/stats") {
+    encryptThenSendMessage(
+      {{"jsonrpc", "2.0"},
+       {"id", jsonrpc["id"]},
+       {"result", Metrics::toJson()}});
+    co_return;
+  }
+
+  if (method == "trace/start") {
+    Trace::setEnabled(true);
+    encryptThenSendMessage(
+      {{"jsonrpc", "2.0"}, {"id", jsonrpc["id"]}, {"result", json::object()}});
+    co_return;
+  }
+
+  if (method == "trace/stop") {
+    Trace::setEnabled(false);
+    encryptThenSendMessage(
+      {{"jsonrpc", "2.0"}, {"id", jsonrpc["id"]}, {"result", json::object()}});
+    co_return;
+  }
+
+  if (method == "trace/get") {
+    const bool clear
+      = jsonrpc.value("params", json::object()).value("clear", false);
+    auto result = Trace::toJson();
+    if (clear) {
+      Trace::clear();
+    }
+    encryptThenSendMessage(
+      {{"jsonrpc", "2.0"}, {"id", jsonrpc["id"]}, {"result", result}});
+    co_return;
+  }
+
+  if (method == "connection/getStats") {
+    encryptThenSendMessage(
+      {{"jsonrpc", "2.0"}, {"id", jsonrpc["id"]}, {"result", getStats()}});
+    co_return;
+  }
+
+  // Notification: no response
+  if (method == "previews/ack") {
+    const auto& params = jsonrpc["params"];
+    auto it = mPreviewSubscriptions.find(params["sceneId"].get<std::string>());
+    if (it != mPreviewSubscriptions.end() && it->second->delta) {
+      it->second->delta->acknowledge(params["sequence"].get<uint64_t>());
+    }
+    co_return;
+  }
 }
 
-namespace {
-#pragma pack(push, 1)
-struct ClientHelloBox {
-  uint8_t serverToClientKey[crypto_secretstream_xchacha20poly1305_KEYBYTES];
-};
-struct ClientHelloMessage {
-  uint8_t pwhashSalt[crypto_pwhash_SALTBYTES];
-  uint8_t secretBoxNonce[crypto_secretbox_NONCEBYTES];
-  uint8_t secretBox[sizeof(ClientHelloBox) + crypto_secretbox_MACBYTES];
-};
-struct ServerHelloBox {
-  uint8_t clientToServerKey[crypto_secretstream_xchacha20poly1305_KEYBYTES];
-  uint8_t authenticationKey[crypto_auth_KEYBYTES];
-};
-struct ServerHelloMessage {
-  uint8_t secretBoxNonce[crypto_secretbox_NONCEBYTES];
-  uint8_t secretBox[sizeof(ServerHelloBox) + crypto_secretbox_MACBYTES];
-  uint8_t
-    serverToClientHeader[crypto_secretstream_xchacha20poly1305_HEADERBYTES];
-};
-#pragma pack(pop)
-}// namespace
+asio::awaitable<bool> ClientHandler::sendThumbnailDelta(
+  const json& jsonrpc,
+  Request& request) {
+  const auto& params = jsonrpc["params"];
+  const std::string id = params["id"];
+  BackendCall backend("captureScene", request);
+  auto image = co_await mSoftware->captureScene(id, 0);
+  backend.end();
+  if (image.empty()) {
+    // Fall back to a full base64 PNG from the software
+    co_return false;
+  }
+
+  PreviewFrame frame(mSoftware, id, 0, std::move(image));
+  const auto tiles = frame.getTiles(0);
+  const auto hash = tiles->getContentHash();
+  const std::string ifNoneMatch = params.value("ifNoneMatch", "");
+  json result{
+    {"id", id},
+    {"content_type", "image/png"},
+    {"hash", hash},
+    {"width", tiles->getWidth()},
+    {"height", tiles->getHeight()},
+  };
+
+  auto& base = mThumbnailTiles[id];
+  if (ifNoneMatch == hash) {
+    Logger::debug("Thumbnail not modified");
+    result["notModified"] = true;
+  } else if (
+    base && ifNoneMatch == base->getContentHash()
+    && tiles->isCompatibleWith(*base)) {
+    Logger::debug("Sending thumbnail delta");
+    result["baseHash"] = ifNoneMatch;
+    result["tileSize"] = ImageTiles::TILE_SIZE;
+    result["tiles"] = frame.getTilesJson(0, tiles->getChangedTiles(*base));
+  } else {
+    const auto& png = frame.getBase64Png(0);
+    if (png.empty()) {
+      co_return false;
+    }
+    result["base64_data"] = png;
+  }
+  base = tiles;
+
+  encryptThenSendMessage(
+    {{"jsonrpc", "2.0"}, {"id", jsonrpc["id"]}, {"result", result}});
+  co_return true;
+}
 
 void ClientHandler::handshakeClientHelloMessageReceived(
   const std::string& blob) {
@@ -251,7 +874,7 @@ void ClientHandler::handshakeClientHelloMessageReceived(
       reinterpret_cast<uint8_t*>(&requestBox), request->secretBox,
       sizeof(request->secretBox), request->secretBoxNonce, psk);
     if (result != 0) {
-      Logger::debug("Invalid password, closing");
+      Logger::info("Invalid password, closing");
     }
     clean_and_return_unless(result == 0);
     if (result != 0) {
@@ -290,6 +913,9 @@ void ClientHandler::handshakeClientHelloMessageReceived(
     clean_and_return_unless(result == 0);
   }
   this->mState = ClientState::WAITING_FOR_CLIENT_READY;
+  mMetrics->framesOut.increment();
+  mMetrics->bytesOut.increment(sizeof(response));
+  mLastActivity = Clock::now();
   this->mConnection->sendMessage(
     std::string(reinterpret_cast<const char*>(&response), sizeof(response)));
 }
@@ -297,28 +923,162 @@ void ClientHandler::handshakeClientHelloMessageReceived(
 void ClientHandler::outputStateChanged(
   const std::string& id,
   OutputState state) {
-  encryptThenSendMessage(
-    {{"jsonrpc", "2.0"},
-     {"method", "outputs/stateChanged"},
-     {"params", json{{"id", id}, {"state", Output::stateToString(state)}}}});
+  ALLOCATION_SCOPE(NOTIFICATIONS);
+  // Assigning members allocates less than nested initializer lists, which
+  // copy every value
+  json message = json::object();
+  message["jsonrpc"] = "2.0";
+  message["method"] = "outputs/stateChanged";
+  auto& params = message["params"];
+  params["id"] = id;
+  params["state"] = Output::stateToString(state);
+  encryptThenSendMessage(message);
 }
 
 void ClientHandler::currentSceneChanged(const std::string& id) {
-  encryptThenSendMessage(
-    {{"jsonrpc", "2.0"},
-     {"method", "scenes/currentSceneChanged"},
-     {"params", json{{"id", id}}}});
+  ALLOCATION_SCOPE(NOTIFICATIONS);
+  json message = json::object();
+  message["jsonrpc"] = "2.0";
+  message["method"] = "scenes/currentSceneChanged";
+  message["params"]["id"] = id;
+  encryptThenSendMessage(message);
 }
 
-namespace {
-#pragma pack(push, 1)
-struct ClientReadyMessage {
-  uint8_t
-    clientToServerHeader[crypto_secretstream_xchacha20poly1305_HEADERBYTES];
-  uint8_t authenticationMac[crypto_auth_BYTES];
-};
-#pragma pack(pop)
-}// namespace
+void ClientHandler::previewFrameAvailable(
+  const std::shared_ptr<PreviewFrame>& frame,
+  PreviewSubscription& subscription) {
+  ALLOCATION_SCOPE(PREVIEWS);
+  // Previews are a stream of snapshots, not a log: if the client hasn't
+  // received the last frame yet, skip this one instead of queueing it.
+  const auto pending = mConnection->getPendingSendBytes();
+  mThroughput.sample(pending);
+  if (pending > 0) {
+    if (subscription.skippedFrames++ == 0) {
+      FlightRecorder::record(
+        FlightRecorder::EventType::PREVIEWS_SKIPPING_STARTED, mConnectionId,
+        pending, frame->getSceneId());
+    }
+    return;
+  }
+  if (subscription.skippedFrames > 0) {
+    FlightRecorder::record(
+      FlightRecorder::EventType::PREVIEWS_SKIPPING_ENDED, mConnectionId,
+      subscription.skippedFrames, frame->getSceneId());
+    subscription.skippedFrames = 0;
+  }
+
+  auto maxDimension = subscription.maxDimension;
+  std::string contentType = "image/png";
+  int quality = -1;
+  const QualityTier* tier = nullptr;
+  if (subscription.quality && frame->getWidth() > 0) {
+    // Every adaptive subscription gets an equal share of the connection
+    const auto adaptive = std::count_if(
+      mPreviewSubscriptions.begin(), mPreviewSubscriptions.end(),
+      [](const auto& it) { return static_cast<bool>(it.second->quality); });
+    const auto previous = &subscription.quality->getTier();
+    tier = &subscription.quality->select(
+      frame->getWidth(), frame->getHeight(),
+      mThroughput.getBytesPerSecond() / std::max<size_t>(adaptive, 1),
+      subscription.maxFps);
+    if (tier != previous) {
+      FlightRecorder::record(
+        FlightRecorder::EventType::PREVIEW_QUALITY_CHANGED, mConnectionId,
+        tier->maxDimension, frame->getSceneId());
+    }
+    maxDimension = tier->maxDimension;
+    contentType = tier->contentType;
+    quality = tier->quality;
+  }
+
+  const auto& notification = subscription.delta
+    ? subscription.delta->getNotification(
+      *frame, maxDimension, contentType, quality)
+    : frame->getNotification(maxDimension, contentType, quality);
+  if (notification.empty()) {
+    return;
+  }
+  if (tier) {
+    // Includes savings from delta frames, if enabled
+    const auto& image = frame->getImage(maxDimension);
+    subscription.quality->encoded(
+      *tier, image.width, image.height, notification.size());
+  }
+  encryptThenSendMessage(notification);
+}
+
+json ClientHandler::getStats() const {
+  json previews = json::object();
+  for (const auto& [sceneId, subscription] : mPreviewSubscriptions) {
+    json preview{
+      {"maxFps", subscription->maxFps},
+      {"delta", static_cast<bool>(subscription->delta)},
+    };
+    if (subscription->quality) {
+      preview["tier"] = subscription->quality->getTier().toJson();
+    } else {
+      preview["tier"] = QualityTier {
+        .maxDimension = subscription->maxDimension}.toJson();
+    }
+    previews[sceneId] = preview;
+  }
+
+  json stats{
+    {"throughputBytesPerSecond", mThroughput.getBytesPerSecond()},
+    {"pendingSendBytes", mConnection->getPendingSendBytes()},
+    {"previews", previews},
+  };
+  if (mThumbnailQuality) {
+    stats["thumbnailTier"] = mThumbnailQuality->getTier().toJson();
+  }
+  return stats;
+}
+
+json ClientHandler::getConnectionInfo() const {
+  const auto now = Clock::now();
+  json requests = json::object();
+  for (const auto& [method, stats] : mRequestsByMethod) {
+    requests[method] = {
+      {"count", stats.count},
+      {"perSecond",
+       decay_request_rate(stats.perSecond, stats.updatedAt, now)},
+    };
+  }
+  const std::chrono::duration<double> age = now - mConnectedAt;
+  const std::chrono::duration<double> idle = now - mLastActivity;
+  return {
+    {"id", mConnectionId},
+    {"transport", mConnection->getTransportName()},
+    {"peerAddress", mConnection->getPeerAddress()},
+    {"state",
+     mState == ClientState::AUTHENTICATED ? "authenticated" : "handshake"},
+    {"ageSeconds", age.count()},
+    {"idleSeconds", idle.count()},
+    {"bytesSent", mConnection->getBytesSent()},
+    {"bytesReceived", mConnection->getBytesReceived()},
+    {"pendingSendBytes", mConnection->getPendingSendBytes()},
+    {"previewSubscriptions", mPreviewSubscriptions.size()},
+    {"requests", requests},
+  };
+}
+
+asio::awaitable<json> ClientHandler::getConnectionInfo(
+  ConnectionRegistry::Connection connection) {
+  if (connection.alive.expired()) {
+    co_return json();
+  }
+  co_return connection.handler->getConnectionInfo();
+}
+
+void ClientHandler::requestReceived(const std::string& method) {
+  const auto now = Clock::now();
+  auto& stats
+    = mRequestsByMethod[RPC_METHODS.contains(method) ? method : "unknown"];
+  ++stats.count;
+  stats.perSecond = decay_request_rate(stats.perSecond, stats.updatedAt, now)
+    + (1 / REQUEST_RATE_SECONDS);
+  stats.updatedAt = now;
+}
 
 void ClientHandler::handshakeClientReadyMessageReceived(
   const std::string& blob) {
@@ -338,6 +1098,15 @@ void ClientHandler::handshakeClientReadyMessageReceived(
   }
 
   this->mState = ClientState::AUTHENTICATED;
+  mMetrics->handshaking.sub();
+  mMetrics->authenticated.add();
+  mMetrics->handshakeSucceeded.increment();
+  FlightRecorder::record(
+    FlightRecorder::EventType::HANDSHAKE_SUCCEEDED, mConnectionId,
+    nanoseconds_since(mConnectedAt));
+  if (SessionRecorder::isEnabled()) {
+    mSession = SessionRecorder::startSession(mConnectionId);
+  }
 
   this->encryptThenSendMessage({{"jsonrpc", "2.0"}, {"method", "hello"}});
 }
@@ -348,7 +1117,39 @@ void ClientHandler::cleanCrypto() {
 }
 
 void ClientHandler::encryptThenSendMessage(const json& message) {
-  encryptThenSendMessage(message.dump());
+  ALLOCATION_SCOPE(JSON);
+  if (mSession && message.contains("id") && !message.contains("method")) {
+    mSession->record(
+      SessionRecorder::RecordType::RESPONSE, message["id"].dump());
+  }
+  TraceSpan serialize("serialize", {.connectionId = mConnectionId});
+  std::string p;
+  auto timed = mTimedRequests.end();
+  if (!mTimedRequests.empty() && message.contains("id")) {
+    timed = mTimedRequests.find(message["id"].dump());
+  }
+  if (timed != mTimedRequests.end()) {
+    auto withTiming = message;
+    withTiming["serverTiming"] = getServerTiming(*timed->second);
+    p = withTiming.dump();
+  } else {
+    p = message.dump();
+  }
+  serialize.end();
+  encryptThenSendMessage(p);
+}
+
+json ClientHandler::getServerTiming(const Request& request) const {
+  const auto now = Trace::now();
+  const auto dispatch = now - request.dispatchStarted - request.backend;
+  return {
+    {"queue", to_microseconds(request.started - request.received)},
+    {"decrypt", to_microseconds(request.decrypt)},
+    {"dispatch", to_microseconds(dispatch)},
+    {"backend", to_microseconds(request.backend)},
+    {"encrypt", to_microseconds(mLastEncryptDuration)},
+    {"total", to_microseconds(now - request.received)},
+  };
 }
 
 void ClientHandler::encryptThenSendMessage(const std::string& p) {
@@ -356,14 +1157,29 @@ void ClientHandler::encryptThenSendMessage(const std::string& p) {
     return;
   }
 
-  auto csize = p.size() + crypto_secretstream_xchacha20poly1305_ABYTES;
-  auto c = std::unique_ptr<unsigned char>(new unsigned char[csize]);
+  ALLOCATION_SCOPE(CRYPTO);
+  const Trace::Context trace {.connectionId = mConnectionId};
+  TraceSpan encrypt("encrypt", trace);
+  const auto encryptStarted = Trace::now();
+  // Encrypt straight into the string that is sent, rather than into a
+  // temporary buffer
+  std::string c;
+  c.resize(p.size() + crypto_secretstream_xchacha20poly1305_ABYTES);
   unsigned long long clen;
   const auto result = crypto_secretstream_xchacha20poly1305_push(
-    &this->mCryptoPushState, c.get(), &clen,
+    &this->mCryptoPushState, reinterpret_cast<unsigned char*>(c.data()), &clen,
     reinterpret_cast<const unsigned char*>(p.data()), p.size(), nullptr, 0, 0);
-  assert(clen <= csize);
   clean_and_return_unless(result == 0);
-  mConnection->sendMessage(
-    std::string(reinterpret_cast<const char*>(c.get()), clen));
+  assert(clen == c.size());
+  encrypt.end();
+  mLastEncryptDuration = Trace::now() - encryptStarted;
+  TraceSpan send("send", trace);
+  const auto pending = mConnection->getPendingSendBytes();
+  mMetrics->sendQueueBytes.record(pending);
+  mMetrics->framesOut.increment();
+  mMetrics->bytesOut.increment(clen);
+  mLastActivity = Clock::now();
+  mThroughput.sample(pending);
+  mThroughput.messageQueued(clen, pending);
+  mConnection->sendMessage(c);
 }
@@ -9,47 +9,139 @@
 #pragma once
 
 #include "ClientState.h"
+#include "Clock.h"
+#include "ConnectionRegistry.h"
+#include "SessionRecorder.h"
 #include "StreamingSoftware.h"
+#include "ThroughputEstimator.h"
+#include "Trace.h"
 
 #include <asio/awaitable.hpp>
 #include <sodium.h>
 #include <nlohmann/json.hpp>
 
-class MessageInterface;
+#include <chrono>
+#include <map>
+#include <optional>
 
-namespace asio {
-class io_context;
-}
+class ImageTiles;
+class MessageInterface;
+class PreviewDeltaTracker;
+class PreviewFrame;
+class PreviewManager;
+class QualitySelector;
 
+// Everything other than construction runs on the connection's strand.
 class ClientHandler : private ConnectionOwner {
  public:
   explicit ClientHandler(
-    std::shared_ptr<asio::io_context> context,
     std::shared_ptr<StreamingSoftware> software,
+    std::shared_ptr<PreviewManager> previews,
+    std::shared_ptr<ConnectionRegistry> connections,
     std::unique_ptr<MessageInterface> connection);
   ~ClientHandler();
 
  private:
-  asio::awaitable<void> messageReceived(const std::string message);
+  struct TransportMetrics;
+  class BackendCall;
+
+  // Per-request state, passed down from `messageReceived()`; times are
+  // `Trace::now()` timestamps or durations, for tracing and `serverTiming`
+  struct Request {
+    Trace::Context trace;
+    uint64_t received = 0;
+    uint64_t started = 0;
+    uint64_t decrypt = 0;
+    // Includes parsing
+    uint64_t dispatchStarted = 0;
+    uint64_t backend = 0;
+  };
+
+  // `received` is a `Trace::now()` timestamp
+  asio::awaitable<void> messageReceived(
+    const std::string message,
+    uint64_t received);
 
   void outputStateChanged(const std::string& id, OutputState state);
   void currentSceneChanged(const std::string& id);
+  struct PreviewSubscription {
+    uint32_t maxDimension = 0;
+    uint16_t maxFps = 1;
+    // Null unless the client asked for tile deltas
+    std::unique_ptr<PreviewDeltaTracker> delta;
+    // Null unless the client asked for adaptive quality
+    std::unique_ptr<QualitySelector> quality;
+    // Since the last frame that was sent
+    uint32_t skippedFrames = 0;
+    // Last, so that it is disconnected first
+    std::optional<ScopedConnection> connection;
+  };
+
+  void previewFrameAvailable(
+    const std::shared_ptr<PreviewFrame>& frame,
+    PreviewSubscription& subscription);
+  nlohmann::json getStats() const;
+  // For `server/connections`
+  nlohmann::json getConnectionInfo() const;
+  static asio::awaitable<nlohmann::json> getConnectionInfo(
+    ConnectionRegistry::Connection connection);
+  void requestReceived(const std::string& method);
+  asio::awaitable<bool> sendThumbnailDelta(
+    const nlohmann::json& jsonrpc,
+    Request& request);
+  nlohmann::json getServerTiming(const Request& request) const;
 
   void handshakeClientHelloMessageReceived(const std::string& message);
   void handshakeClientReadyMessageReceived(const std::string& message);
-  asio::awaitable<void> encryptedRpcMessageReceived(const std::string& message);
-  asio::awaitable<void> plaintextRpcMessageReceived(const std::string& message);
+  asio::awaitable<void> encryptedRpcMessageReceived(
+    const std::string& message,
+    Request& request);
+  asio::awaitable<void> plaintextRpcMessageReceived(
+    const std::string& message,
+    Request& request);
   void encryptThenSendMessage(const std::string& message);
   void encryptThenSendMessage(const nlohmann::json& message);
   void cleanCrypto();
   void cleanCryptoKeysButLeaveCryptoState();
 
+  // Unique for the lifetime of the process; used to tag trace spans
+  const uint64_t mConnectionId;
+  uint64_t mLastRequestId = 0;
   ClientState mState;
-  std::shared_ptr<asio::io_context> mIoContext;
   std::shared_ptr<StreamingSoftware> mSoftware;
+  std::shared_ptr<PreviewManager> mPreviews;
+  std::shared_ptr<ConnectionRegistry> mConnections;
   std::unique_ptr<MessageInterface> mConnection;
+  const std::unique_ptr<const TransportMetrics> mMetrics;
+  ThroughputEstimator mThroughput;
+  const Clock::time_point mConnectedAt;
+  // Last message sent or received
+  Clock::time_point mLastActivity;
+  struct MethodStats {
+    uint64_t count = 0;
+    // Exponentially-weighted, so mostly reflects the last few seconds
+    double perSecond = 0;
+    Clock::time_point updatedAt;
+  };
+  std::map<std::string, MethodStats> mRequestsByMethod;
+  // In-progress requests that asked for `serverTiming`, by JSON-RPC ID
+  std::map<std::string, const Request*> mTimedRequests;
+  // A response can't include the time taken to encrypt itself, so
+  // `serverTiming` reports the most recent encryption instead
+  uint64_t mLastEncryptDuration = 0;
+  // Only if a `SessionRecorder` existed when the handshake completed
+  std::unique_ptr<SessionRecorder::Session> mSession;
+  // Heap-allocated so that callbacks can keep a stable pointer
+  std::map<std::string, std::unique_ptr<PreviewSubscription>>
+    mPreviewSubscriptions;
+  // Most recent bounds; reported by `connection/getStats`
+  std::shared_ptr<QualitySelector> mThumbnailQuality;
+  // Last thumbnail sent for each scene with `acceptDelta`
+  std::map<std::string, std::shared_ptr<const ImageTiles>> mThumbnailTiles;
   unsigned char mAuthenticationKey[crypto_auth_KEYBYTES];
   unsigned char mPullKey[crypto_secretstream_xchacha20poly1305_KEYBYTES];
   crypto_secretstream_xchacha20poly1305_state mCryptoPullState;
   crypto_secretstream_xchacha20poly1305_state mCryptoPushState;
+  // Expires when we're destroyed; checked by handlers posted to our strand
+  std::shared_ptr<bool> mAlive = std::make_shared<bool>(true);
 };
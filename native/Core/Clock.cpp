@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#include "Clock.h"
+
+std::atomic<SimulatedTime*> SimulatedTime::sActive {nullptr};
+
+Clock::time_point Clock::now() {
+  const auto simulation
+    = SimulatedTime::sActive.load(std::memory_order_acquire);
+  if (simulation) {
+    return simulation->now();
+  }
+  return std::chrono::steady_clock::now();
+}
+
+SimulatedTime::Waiter::~Waiter() {
+}
+
+SimulatedTime::SimulatedTime()
+  : mNow(std::chrono::steady_clock::now().time_since_epoch().count()) {
+  sActive.store(this, std::memory_order_release);
+}
+
+SimulatedTime::~SimulatedTime() {
+  auto self = this;
+  sActive.compare_exchange_strong(self, nullptr);
+  // Destroying a handler can destroy a `Timer`, which takes the lock
+  decltype(mWaiters) waiters;
+  {
+    std::scoped_lock lock(mMutex);
+    waiters.swap(mWaiters);
+  }
+}
+
+Clock::time_point SimulatedTime::now() const {
+  return Clock::time_point(
+    Clock::duration(mNow.load(std::memory_order_acquire)));
+}
+
+void SimulatedTime::wait(std::shared_ptr<Waiter> waiter) {
+  std::scoped_lock lock(mMutex);
+  const auto expiry = waiter->expiry;
+  mWaiters.emplace(std::make_pair(expiry, mNextSequence++), std::move(waiter));
+}
+
+void SimulatedTime::cancel(std::vector<std::weak_ptr<Waiter>>& waiters) {
+  std::scoped_lock lock(mMutex);
+  for (const auto& weak : waiters) {
+    const auto waiter = weak.lock();
+    if (waiter && !waiter->done) {
+      waiter->done = true;
+      waiter->complete(asio::error::operation_aborted);
+    }
+  }
+  waiters.clear();
+}
+
+size_t SimulatedTime::poll(asio::io_context& context) {
+  size_t count = 0;
+  while (true) {
+    context.restart();
+    const auto ran = context.poll();
+    if (ran == 0) {
+      return count;
+    }
+    count += ran;
+  }
+}
+
+size_t SimulatedTime::runUntil(
+  asio::io_context& context,
+  Clock::time_point until) {
+  size_t count = poll(context);
+  while (true) {
+    // Completed waiters are destroyed outside of the lock, as destroying them
+    // can destroy a `Timer`
+    std::vector<std::shared_ptr<Waiter>> expired;
+    {
+      std::scoped_lock lock(mMutex);
+      while (!mWaiters.empty() && mWaiters.begin()->second->done) {
+        mWaiters.erase(mWaiters.begin());
+      }
+      if (mWaiters.empty() || mWaiters.begin()->first.first > until) {
+        break;
+      }
+      const auto next = mWaiters.begin()->first.first;
+      if (next > now()) {
+        mNow.store(next.time_since_epoch().count(), std::memory_order_release);
+      }
+      while (!mWaiters.empty() && mWaiters.begin()->first.first <= next) {
+        auto waiter = std::move(mWaiters.begin()->second);
+        mWaiters.erase(mWaiters.begin());
+        if (!waiter->done) {
+          waiter->done = true;
+          waiter->complete({});
+        }
+        expired.push_back(std::move(waiter));
+      }
+    }
+    expired.clear();
+    count += poll(context);
+  }
+  if (until > now()) {
+    mNow.store(until.time_since_epoch().count(), std::memory_order_release);
+  }
+  return count + poll(context);
+}
+
+size_t SimulatedTime::runFor(
+  asio::io_context& context,
+  Clock::duration duration) {
+  return runUntil(context, now() + duration);
+}
+
+Timer::~Timer() {
+  cancel();
+}
+
+Timer::time_point Timer::expiry() const {
+  return mTimer.expiry();
+}
+
+void Timer::expires_at(time_point expiry) {
+  cancel();
+  mTimer.expires_at(expiry);
+}
+
+void Timer::expires_after(duration expiry) {
+  expires_at(Clock::now() + expiry);
+}
+
+void Timer::cancel() {
+  mTimer.cancel();
+  // Waiters are owned by the simulation, so have all expired if it has been
+  // destroyed; only dereference it if some are still outstanding
+  std::erase_if(mWaiters, [](const auto& it) { return it.expired(); });
+  if (!mWaiters.empty()) {
+    mSimulation->cancel(mWaiters);
+  }
+}
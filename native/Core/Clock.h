@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <asio.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/** The clock for Core's timers, and for timestamps that change behaviour,
+ * such as frame pacing.
+ *
+ * This is `std::chrono::steady_clock`, unless a `SimulatedTime` exists; time
+ * points are shared with `steady_clock` either way.
+ */
+struct Clock {
+  typedef std::chrono::steady_clock::rep rep;
+  typedef std::chrono::steady_clock::period period;
+  typedef std::chrono::steady_clock::duration duration;
+  typedef std::chrono::steady_clock::time_point time_point;
+  static constexpr bool is_steady = true;
+
+  static time_point now();
+};
+
+/** Virtual time, for testing and benchmarking timer-driven code - such as
+ * preview pacing, or simulated latencies - faster than real time, and
+ * deterministically.
+ *
+ * While one exists, `Clock::now()` returns its time, which only moves when
+ * `runUntil()` or `runFor()` advances it; `Timer`s created while it exists
+ * wait for it instead of for real time. The io_context must only be run by
+ * those functions. `Timer`s may outlive it, but waits that are still
+ * outstanding when it is destroyed are abandoned without being completed.
+ */
+class SimulatedTime final {
+ public:
+  // Starts at the current real time
+  SimulatedTime();
+  SimulatedTime(const SimulatedTime&) = delete;
+  ~SimulatedTime();
+
+  Clock::time_point now() const;
+
+  // Runs every ready handler, then repeatedly jumps to the next timer expiry
+  // and runs the handlers that wakes up, until the next expiry is after
+  // `until`; finally, advances to `until`. Returns the number of handlers
+  // that were run.
+  size_t runUntil(asio::io_context& context, Clock::time_point until);
+  size_t runFor(asio::io_context& context, Clock::duration duration);
+
+ private:
+  friend struct Clock;
+  friend class Timer;
+
+  class Waiter {
+   public:
+    virtual ~Waiter();
+    // Posts the completion handler; called at most once, with the lock held
+    virtual void complete(const asio::error_code& ec) = 0;
+    Clock::time_point expiry;
+    bool done = false;
+  };
+  template <typename Handler, typename Executor>
+  class WaiterImpl;
+
+  void wait(std::shared_ptr<Waiter> waiter);
+  void cancel(std::vector<std::weak_ptr<Waiter>>& waiters);
+  static size_t poll(asio::io_context& context);
+
+  std::atomic<Clock::rep> mNow;
+  std::mutex mMutex;
+  // By expiry then insertion order, so that runs are deterministic
+  std::map<std::pair<Clock::time_point, uint64_t>, std::shared_ptr<Waiter>>
+    mWaiters;
+  uint64_t mNextSequence = 0;
+
+  static std::atomic<SimulatedTime*> sActive;
+};
+
+/** A drop-in replacement for `asio::steady_timer` that follows `Clock`.
+ *
+ * Without a `SimulatedTime`, this is an `asio::steady_timer`. Like that, it
+ * must only be used from one strand, and changing the expiry or destroying
+ * the timer cancels outstanding waits with `asio::error::operation_aborted`.
+ */
+class Timer final {
+ public:
+  typedef Clock clock_type;
+  typedef Clock::duration duration;
+  typedef Clock::time_point time_point;
+
+  template <typename ExecutorOrContext>
+  explicit Timer(ExecutorOrContext&& executorOrContext)
+    : mSimulation(SimulatedTime::sActive.load(std::memory_order_acquire)),
+      mTimer(std::forward<ExecutorOrContext>(executorOrContext)) {
+  }
+  template <typename ExecutorOrContext>
+  Timer(ExecutorOrContext&& executorOrContext, time_point expiry)
+    : Timer(std::forward<ExecutorOrContext>(executorOrContext)) {
+    mTimer.expires_at(expiry);
+  }
+  template <typename ExecutorOrContext>
+  Timer(ExecutorOrContext&& executorOrContext, duration expiry)
+    : Timer(std::forward<ExecutorOrContext>(executorOrContext)) {
+    mTimer.expires_at(Clock::now() + expiry);
+  }
+  Timer(const Timer&) = delete;
+  ~Timer();
+
+  time_point expiry() const;
+  void expires_at(time_point expiry);
+  void expires_after(duration expiry);
+  void cancel();
+
+  template <typename CompletionToken>
+  auto async_wait(CompletionToken&& token) {
+    return asio::async_initiate<CompletionToken, void(asio::error_code)>(
+      [this](auto&& handler) {
+        if (!mSimulation) {
+          mTimer.async_wait(std::move(handler));
+          return;
+        }
+        typedef std::decay_t<decltype(handler)> Handler;
+        auto executor = mTimer.get_executor();
+        auto waiter = std::make_shared<
+          SimulatedTime::WaiterImpl<Handler, decltype(executor)>>(
+          std::move(handler), executor);
+        waiter->expiry = mTimer.expiry();
+        std::erase_if(mWaiters, [](const auto& it) { return it.expired(); });
+        mWaiters.push_back(waiter);
+        mSimulation->wait(std::move(waiter));
+      },
+      token);
+  }
+
+ private:
+  SimulatedTime* mSimulation;
+  // Also holds the executor and expiry when simulated
+  asio::steady_timer mTimer;
+  // Only when simulated; owned by the `SimulatedTime`
+  std::vector<std::weak_ptr<SimulatedTime::Waiter>> mWaiters;
+};
+
+template <typename Handler, typename Executor>
+class SimulatedTime::WaiterImpl final : public SimulatedTime::Waiter {
+ public:
+  WaiterImpl(Handler&& handler, const Executor& executor)
+    : mHandler(std::move(handler)), mExecutor(executor) {
+  }
+
+  void complete(const asio::error_code& ec) override {
+    const auto executor = asio::get_associated_executor(mHandler, mExecutor);
+    asio::post(
+      executor, [handler = std::move(mHandler), ec]() mutable { handler(ec); });
+  }
+
+ private:
+  Handler mHandler;
+  Executor mExecutor;
+};
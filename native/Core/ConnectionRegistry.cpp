@@ -0,0 +1,35 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#include "ConnectionRegistry.h"
+
+void ConnectionRegistry::add(uint64_t id, const Connection& connection) {
+  std::scoped_lock lock(mMutex);
+  mConnections.emplace(id, connection);
+}
+
+void ConnectionRegistry::remove(uint64_t id) {
+  std::scoped_lock lock(mMutex);
+  mConnections.erase(id);
+}
+
+std::optional<ConnectionRegistry::Connection> ConnectionRegistry::get(
+  uint64_t id) const {
+  std::scoped_lock lock(mMutex);
+  auto it = mConnections.find(id);
+  if (it == mConnections.end()) {
+    return {};
+  }
+  return it->second;
+}
+
+std::map<uint64_t, ConnectionRegistry::Connection> ConnectionRegistry::getAll()
+  const {
+  std::scoped_lock lock(mMutex);
+  return mConnections;
+}
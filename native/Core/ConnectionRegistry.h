@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include "MessageInterface.h"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+
+class ClientHandler;
+
+/** The server's open connections, for admin RPCs.
+ *
+ * Thread-safe. Each handler must only be used on its strand, after checking
+ * that `alive` has not expired; as handlers are destroyed on their strand,
+ * it remains valid until the strand runs something else.
+ */
+class ConnectionRegistry final {
+ public:
+  struct Connection {
+    MessageInterface::Strand strand;
+    std::weak_ptr<bool> alive;
+    ClientHandler* handler;
+  };
+
+  void add(uint64_t id, const Connection& connection);
+  void remove(uint64_t id);
+
+  std::optional<Connection> get(uint64_t id) const;
+  std::map<uint64_t, Connection> getAll() const;
+
+ private:
+  mutable std::mutex mMutex;
+  std::map<uint64_t, Connection> mConnections;
+};
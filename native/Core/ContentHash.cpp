@@ -0,0 +1,27 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#include "ContentHash.h"
+
+#include <sodium.h>
+
+namespace {
+// 128 bits is plenty to detect changes; this is not used for security.
+constexpr size_t HASH_BYTES = 16;
+}// namespace
+
+std::string content_hash(std::string_view data) {
+  unsigned char hash[HASH_BYTES];
+  crypto_generichash(
+    hash, sizeof(hash), reinterpret_cast<const unsigned char*>(data.data()),
+    data.size(), nullptr, 0);
+
+  char hex[(HASH_BYTES * 2) + 1];
+  sodium_bin2hex(hex, sizeof(hex), hash, sizeof(hash));
+  return std::string(hex, HASH_BYTES * 2);
+}
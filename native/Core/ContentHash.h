@@ -0,0 +1,18 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <string>
+#include <string_view>
+
+/** Short, stable hex digest of a blob; suitable as an ETag-like value.
+ *
+ * Uses BLAKE2b via libsodium; `sodium_init()` must have been called.
+ */
+std::string content_hash(std::string_view data);
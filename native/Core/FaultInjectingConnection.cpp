@@ -0,0 +1,343 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#include "FaultInjectingConnection.h"
+
+#include "Logger.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <charconv>
+#include <string_view>
+
+namespace {
+std::optional<uint64_t> parse_uint(std::string_view value) {
+  uint64_t ret = 0;
+  const auto [end, ec]
+    = std::from_chars(value.data(), value.data() + value.size(), ret);
+  if (value.empty() || ec != std::errc() || end != value.data() + value.size()) {
+    return {};
+  }
+  return ret;
+}
+
+std::optional<std::chrono::milliseconds> parse_milliseconds(
+  std::string_view value) {
+  const auto ms = parse_uint(value);
+  if (!ms) {
+    return {};
+  }
+  return std::chrono::milliseconds(*ms);
+}
+}// namespace
+
+bool FaultInjection::isEnabled() const {
+  return latency.count() > 0 || jitter.count() > 0 || sendBandwidth > 0
+    || receiveBandwidth > 0 || stallDuration.count() > 0
+    || disconnectAfter.count() > 0;
+}
+
+std::optional<FaultInjection> FaultInjection::fromString(
+  const std::string& spec) {
+  FaultInjection ret;
+  std::string_view remaining(spec);
+  while (!remaining.empty()) {
+    const auto comma = remaining.find(',');
+    const auto item = remaining.substr(0, comma);
+    remaining = comma == std::string_view::npos
+      ? std::string_view()
+      : remaining.substr(comma + 1);
+
+    const auto equals = item.find('=');
+    if (equals == std::string_view::npos) {
+      return {};
+    }
+    const auto key = item.substr(0, equals);
+    const auto value = item.substr(equals + 1);
+    if (key == "stall") {
+      const auto slash = value.find('/');
+      if (slash == std::string_view::npos) {
+        return {};
+      }
+      const auto interval = parse_milliseconds(value.substr(0, slash));
+      const auto duration = parse_milliseconds(value.substr(slash + 1));
+      // A stall as long as the interval would never end
+      if (!(interval && duration && *duration < *interval)) {
+        return {};
+      }
+      ret.stallInterval = *interval;
+      ret.stallDuration = *duration;
+      continue;
+    }
+
+    const auto number = parse_uint(value);
+    if (!number) {
+      return {};
+    }
+    if (key == "latency") {
+      ret.latency = std::chrono::milliseconds(*number);
+    } else if (key == "jitter") {
+      ret.jitter = std::chrono::milliseconds(*number);
+    } else if (key == "bandwidth") {
+      ret.sendBandwidth = *number;
+      ret.receiveBandwidth = *number;
+    } else if (key == "send-bandwidth") {
+      ret.sendBandwidth = *number;
+    } else if (key == "receive-bandwidth") {
+      ret.receiveBandwidth = *number;
+    } else if (key == "disconnect") {
+      ret.disconnectAfter = std::chrono::milliseconds(*number);
+    } else if (key == "seed") {
+      ret.seed = *number;
+    } else {
+      return {};
+    }
+  }
+  return ret;
+}
+
+std::string FaultInjection::toString() const {
+  std::string ret;
+  const auto append = [&ret](const std::string& item) {
+    ret += ret.empty() ? item : "," + item;
+  };
+  if (latency.count() > 0) {
+    append(fmt::format("latency={}", latency.count()));
+  }
+  if (jitter.count() > 0) {
+    append(fmt::format("jitter={}", jitter.count()));
+  }
+  if (sendBandwidth > 0) {
+    append(fmt::format("send-bandwidth={}", sendBandwidth));
+  }
+  if (receiveBandwidth > 0) {
+    append(fmt::format("receive-bandwidth={}", receiveBandwidth));
+  }
+  if (stallDuration.count() > 0) {
+    append(fmt::format(
+      "stall={}/{}", stallInterval.count(), stallDuration.count()));
+  }
+  if (disconnectAfter.count() > 0) {
+    append(fmt::format("disconnect={}", disconnectAfter.count()));
+  }
+  append(fmt::format("seed={}", seed));
+  return ret;
+}
+
+FaultInjectingConnection::Link::Link(const Strand& strand, uint64_t bandwidth)
+  : timer(strand), bandwidth(bandwidth) {
+}
+
+FaultInjectingConnection::FaultInjectingConnection(
+  std::unique_ptr<MessageInterface> inner,
+  const FaultInjection& faults)
+  : MessageInterface(inner->getStrand()),
+    mInner(std::move(inner)),
+    mFaults(faults),
+    mRandom(faults.seed),
+    mStart(Clock::now()),
+    mOutgoing(getStrand(), faults.sendBandwidth),
+    mIncoming(getStrand(), faults.receiveBandwidth),
+    mDisconnectTimer(getStrand()) {
+  mInner->messageReceived.connect(
+    this, &FaultInjectingConnection::innerMessageReceived);
+  mInner->disconnected.connect([this]() { innerDisconnected(); });
+
+  if (mFaults.disconnectAfter.count() > 0) {
+    std::uniform_real_distribution<double> scale(0.5, 1.5);
+    mDisconnectTimer.expires_after(
+      std::chrono::duration_cast<Clock::duration>(
+        mFaults.disconnectAfter * scale(mRandom)));
+    std::weak_ptr<bool> alive(mAlive);
+    mDisconnectTimer.async_wait([this, alive](const asio::error_code& ec) {
+      if (ec || alive.expired()) {
+        return;
+      }
+      disconnectAbruptly();
+    });
+  }
+}
+
+void FaultInjectingConnection::sendMessage(const std::string& message) {
+  if (mDisconnected || mClosing) {
+    return;
+  }
+  enqueue(mOutgoing, message);
+}
+
+void FaultInjectingConnection::innerMessageReceived(
+  const std::string& message) {
+  syncByteCounters();
+  enqueue(mIncoming, message);
+}
+
+void FaultInjectingConnection::enqueue(
+  Link& link,
+  const std::string& message) {
+  const auto now = Clock::now();
+  auto sent = std::max(now, link.busyUntil);
+  if (link.bandwidth > 0) {
+    sent += std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double>(
+        static_cast<double>(message.size()) / link.bandwidth));
+  }
+  link.busyUntil = sent;
+
+  auto due = sent + mFaults.latency;
+  if (mFaults.jitter.count() > 0) {
+    std::uniform_int_distribution<Clock::rep> jitter(
+      0, std::chrono::duration_cast<Clock::duration>(mFaults.jitter).count());
+    due += Clock::duration(jitter(mRandom));
+  }
+  // Jitter delays messages, but never reorders them
+  if (!link.queue.empty()) {
+    due = std::max(due, link.queue.back().due);
+  }
+
+  link.queuedBytes += message.size();
+  link.queue.push_back({due, message});
+  if (link.queue.size() == 1) {
+    scheduleDelivery(link);
+  }
+}
+
+void FaultInjectingConnection::scheduleDelivery(Link& link) {
+  if (link.queue.empty()) {
+    return;
+  }
+  link.timer.expires_at(afterStalls(link.queue.front().due));
+  std::weak_ptr<bool> alive(mAlive);
+  link.timer.async_wait([this, &link, alive](const asio::error_code& ec) {
+    if (ec || alive.expired()) {
+      return;
+    }
+    deliver(link);
+  });
+}
+
+void FaultInjectingConnection::deliver(Link& link) {
+  const auto now = Clock::now();
+  while (!link.queue.empty() && afterStalls(link.queue.front().due) <= now) {
+    const auto message = std::move(link.queue.front());
+    link.queue.pop_front();
+    link.queuedBytes -= message.data.size();
+    if (&link == &mOutgoing) {
+      mInner->sendMessage(message.data);
+    } else {
+      emit messageReceived(message.data);
+    }
+  }
+  syncByteCounters();
+  if (mClosing && mOutgoing.queue.empty()) {
+    mClosing = false;
+    mInner->disconnect();
+    return;
+  }
+  scheduleDelivery(link);
+}
+
+void FaultInjectingConnection::syncByteCounters() {
+  const auto sent = mInner->getBytesSent();
+  const auto received = mInner->getBytesReceived();
+  addBytesSent(sent - mInnerBytesSent);
+  addBytesReceived(received - mInnerBytesReceived);
+  mInnerBytesSent = sent;
+  mInnerBytesReceived = received;
+}
+
+Clock::time_point
+FaultInjectingConnection::afterStalls(Clock::time_point when) const {
+  if (mFaults.stallDuration.count() <= 0) {
+    return when;
+  }
+  const auto offset = (when - mStart) % mFaults.stallInterval;
+  if (offset < mFaults.stallInterval - mFaults.stallDuration) {
+    return when;
+  }
+  return when + (mFaults.stallInterval - offset);
+}
+
+void FaultInjectingConnection::disconnect() {
+  if (mDisconnected) {
+    return;
+  }
+  // Like a socket, a graceful close still sends what's already been queued
+  if (!mOutgoing.queue.empty()) {
+    mClosing = true;
+    return;
+  }
+  mInner->disconnect();
+}
+
+void FaultInjectingConnection::disconnectAbruptly() {
+  if (mDisconnected) {
+    return;
+  }
+  Logger::debug("Injecting a disconnect for {}", getPeerAddress());
+  for (auto link: {&mOutgoing, &mIncoming}) {
+    link->timer.cancel();
+    link->queue.clear();
+    link->queuedBytes = 0;
+  }
+  mClosing = false;
+  mInner->disconnect();
+}
+
+void FaultInjectingConnection::innerDisconnected() {
+  if (mDisconnected) {
+    return;
+  }
+  mDisconnected = true;
+  // Anything still in flight is lost with the connection
+  for (auto link: {&mOutgoing, &mIncoming}) {
+    link->timer.cancel();
+    link->queue.clear();
+    link->queuedBytes = 0;
+  }
+  mDisconnectTimer.cancel();
+  syncByteCounters();
+  emit disconnected();
+}
+
+size_t FaultInjectingConnection::getPendingSendBytes() const {
+  return mOutgoing.queuedBytes + mInner->getPendingSendBytes();
+}
+
+const char* FaultInjectingConnection::getTransportName() const {
+  return mInner->getTransportName();
+}
+
+std::string FaultInjectingConnection::getPeerAddress() const {
+  return mInner->getPeerAddress();
+}
+
+std::atomic<FaultInjector*> FaultInjector::sActive {nullptr};
+
+FaultInjector::FaultInjector(const FaultInjection& faults)
+  : mFaults(faults), mNextSeed(faults.seed) {
+  sActive.store(this, std::memory_order_release);
+  Logger::info("Injecting network faults: {}", faults.toString());
+}
+
+FaultInjector::~FaultInjector() {
+  auto self = this;
+  sActive.compare_exchange_strong(self, nullptr);
+}
+
+std::unique_ptr<MessageInterface> FaultInjector::wrap(
+  std::unique_ptr<MessageInterface> connection) {
+  auto injector = sActive.load(std::memory_order_acquire);
+  if (!(injector && injector->mFaults.isEnabled())) {
+    return connection;
+  }
+  auto faults = injector->mFaults;
+  faults.seed = injector->mNextSeed.fetch_add(1, std::memory_order_relaxed);
+  return std::make_unique<FaultInjectingConnection>(
+    std::move(connection), faults);
+}
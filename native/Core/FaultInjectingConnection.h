@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include "Clock.h"
+#include "MessageInterface.h"
+
+#include <asio.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <random>
+#include <string>
+
+/** Network conditions to simulate; everything is off by default.
+ *
+ * Written as comma-separated `key=value` pairs, for example
+ * `latency=100,jitter=20,bandwidth=65536,stall=5000/500,disconnect=30000`;
+ * times are in milliseconds, and bandwidths in bytes per second.
+ */
+struct FaultInjection {
+  // One-way, added in each direction
+  std::chrono::milliseconds latency {0};
+  // An extra uniformly-distributed delay of up to this much; messages are
+  // never reordered
+  std::chrono::milliseconds jitter {0};
+  // 0 for unlimited
+  uint64_t sendBandwidth = 0;
+  uint64_t receiveBandwidth = 0;
+  // Nothing is delivered in either direction for the last `stallDuration`
+  // of every `stallInterval`
+  std::chrono::milliseconds stallInterval {0};
+  std::chrono::milliseconds stallDuration {0};
+  // Drop the connection without flushing after a random time between half
+  // and one and a half times this; 0 for never
+  std::chrono::milliseconds disconnectAfter {0};
+  uint64_t seed = 0;
+
+  bool isEnabled() const;
+  // Returns nothing if the specification is invalid
+  static std::optional<FaultInjection> fromString(const std::string&);
+  std::string toString() const;
+};
+
+/** Wraps another connection, simulating a slow or unreliable network.
+ *
+ * Messages are queued in each direction, and delivered in order once the
+ * simulated link would have transmitted them. Like the wrapped connection,
+ * this must only be used from its strand.
+ */
+class FaultInjectingConnection final : public MessageInterface {
+ public:
+  FaultInjectingConnection(
+    std::unique_ptr<MessageInterface> inner,
+    const FaultInjection& faults);
+
+  void sendMessage(const std::string& message) override;
+  void disconnect() override;
+  // Including messages that the simulated link has not delivered yet
+  size_t getPendingSendBytes() const override;
+  const char* getTransportName() const override;
+  std::string getPeerAddress() const override;
+
+ private:
+  struct Message {
+    Clock::time_point due;
+    std::string data;
+  };
+  // One direction of the simulated link
+  struct Link {
+    explicit Link(const Strand& strand, uint64_t bandwidth);
+
+    Timer timer;
+    uint64_t bandwidth;
+    std::deque<Message> queue;
+    size_t queuedBytes = 0;
+    // When the link will have finished transmitting the queued messages
+    Clock::time_point busyUntil;
+  };
+
+  void enqueue(Link& link, const std::string& message);
+  void scheduleDelivery(Link& link);
+  void deliver(Link& link);
+  // The wrapped connection's counters are updated asynchronously, so are
+  // copied whenever this connection is used
+  void syncByteCounters();
+  void innerMessageReceived(const std::string& message);
+  void innerDisconnected();
+  void disconnectAbruptly();
+  // If `when` is during a stall, when that stall ends
+  Clock::time_point afterStalls(Clock::time_point when) const;
+
+  std::unique_ptr<MessageInterface> mInner;
+  FaultInjection mFaults;
+  std::mt19937_64 mRandom;
+  Clock::time_point mStart;
+  Link mOutgoing;
+  Link mIncoming;
+  Timer mDisconnectTimer;
+  uint64_t mInnerBytesSent = 0;
+  uint64_t mInnerBytesReceived = 0;
+  // `disconnect()` was called while messages were queued
+  bool mClosing = false;
+  bool mDisconnected = false;
+  // Expires when we're destroyed; checked by outstanding handlers
+  std::shared_ptr<bool> mAlive = std::make_shared<bool>(true);
+};
+
+/** Makes the `Server` wrap new connections in a `FaultInjectingConnection`.
+ *
+ * Like `FlightRecorder`, injectors are owned by the host - such as the dummy
+ * server, or a benchmark - and must be destroyed after the `Plugin`.
+ */
+class FaultInjector final {
+ public:
+  explicit FaultInjector(const FaultInjection& faults);
+  FaultInjector(const FaultInjector&) = delete;
+  ~FaultInjector();
+
+  // Returns `connection` unchanged if no injector exists
+  static std::unique_ptr<MessageInterface> wrap(
+    std::unique_ptr<MessageInterface> connection);
+
+ private:
+  FaultInjection mFaults;
+  // Each connection gets its own seed, so that they don't fail in lockstep
+  std::atomic<uint64_t> mNextSeed;
+
+  static std::atomic<FaultInjector*> sActive;
+};
@@ -0,0 +1,266 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#include "FlightRecorder.h"
+
+#include "Logger.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <system_error>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace {
+const char MAGIC[8] = {'S', 'R', 'F', 'L', 'I', 'G', 'H', 'T'};
+
+uint64_t get_process_id() {
+#ifdef _WIN32
+  return GetCurrentProcessId();
+#else
+  return static_cast<uint64_t>(getpid());
+#endif
+}
+}// namespace
+
+struct FlightRecorder::Mapping {
+#ifdef _WIN32
+  HANDLE file = INVALID_HANDLE_VALUE;
+  HANDLE mapping = nullptr;
+#else
+  int fd = -1;
+#endif
+  void* data = nullptr;
+  size_t size = 0;
+
+  // Creates or truncates `path`
+  void map(const std::filesystem::path& path, size_t size);
+  ~Mapping();
+};
+
+#ifdef _WIN32
+void FlightRecorder::Mapping::map(
+  const std::filesystem::path& path,
+  size_t size) {
+  file = CreateFileW(
+    path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+    CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    throw std::system_error(
+      GetLastError(), std::system_category(), "CreateFileW");
+  }
+  // Extends the file, with zeroes
+  mapping = CreateFileMappingW(
+    file, nullptr, PAGE_READWRITE, static_cast<DWORD>(uint64_t {size} >> 32),
+    static_cast<DWORD>(size), nullptr);
+  if (!mapping) {
+    throw std::system_error(
+      GetLastError(), std::system_category(), "CreateFileMappingW");
+  }
+  data = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, size);
+  if (!data) {
+    throw std::system_error(
+      GetLastError(), std::system_category(), "MapViewOfFile");
+  }
+  this->size = size;
+}
+
+FlightRecorder::Mapping::~Mapping() {
+  if (data) {
+    FlushViewOfFile(data, size);
+    UnmapViewOfFile(data);
+  }
+  if (mapping) {
+    CloseHandle(mapping);
+  }
+  if (file != INVALID_HANDLE_VALUE) {
+    CloseHandle(file);
+  }
+}
+#else
+void FlightRecorder::Mapping::map(
+  const std::filesystem::path& path,
+  size_t size) {
+  fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    throw std::system_error(errno, std::generic_category(), "open");
+  }
+  // Extends the file, with zeroes
+  if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+    throw std::system_error(errno, std::generic_category(), "ftruncate");
+  }
+  data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (data == MAP_FAILED) {
+    data = nullptr;
+    throw std::system_error(errno, std::generic_category(), "mmap");
+  }
+  this->size = size;
+}
+
+FlightRecorder::Mapping::~Mapping() {
+  if (data) {
+    msync(data, size, MS_SYNC);
+    munmap(data, size);
+  }
+  if (fd >= 0) {
+    close(fd);
+  }
+}
+#endif
+
+std::atomic<FlightRecorder*> FlightRecorder::sActive = nullptr;
+
+FlightRecorder::FlightRecorder(
+  const std::filesystem::path& path,
+  size_t capacity)
+  : mMapping(std::make_unique<Mapping>()),
+    mCapacity(std::max<size_t>(capacity, 1)) {
+  std::error_code ec;
+  if (std::filesystem::exists(path, ec)) {
+    auto previous = path;
+    previous += ".previous";
+    std::filesystem::rename(path, previous, ec);
+    if (ec) {
+      Logger::warning(
+        "Failed to keep previous flight recorder file: {}", ec.message());
+    }
+  }
+
+  mMapping->map(path, sizeof(FileHeader) + mCapacity * sizeof(Record));
+  auto data = static_cast<char*>(mMapping->data);
+  mHeader = reinterpret_cast<FileHeader*>(data);
+  mRecords = reinterpret_cast<Record*>(data + sizeof(FileHeader));
+
+  FileHeader header {};
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = VERSION;
+  header.recordSize = sizeof(Record);
+  header.capacity = mCapacity;
+  header.steadyEpoch = Trace::now();
+  header.systemEpoch = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                         std::chrono::system_clock::now().time_since_epoch())
+                         .count();
+  header.processId = get_process_id();
+  *mHeader = header;
+
+  sActive.store(this, std::memory_order_release);
+  Logger::info(
+    "Flight recorder writing {} events to {}", mCapacity, path.string());
+}
+
+FlightRecorder::~FlightRecorder() {
+  auto self = this;
+  sActive.compare_exchange_strong(self, nullptr);
+}
+
+void FlightRecorder::write(
+  EventType type,
+  uint64_t connectionId,
+  uint64_t value,
+  std::string_view detail) {
+  const auto sequence
+    = std::atomic_ref(mHeader->lastSequence)
+        .fetch_add(1, std::memory_order_relaxed)
+    + 1;
+  auto& record = mRecords[(sequence - 1) % mCapacity];
+  std::atomic_ref recordSequence(record.sequence);
+  // Mark the record as incomplete before touching anything else, so that a
+  // crash part-way through leaves it ignored rather than torn
+  recordSequence.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  record.time = Trace::now();
+  record.value = value;
+  record.connectionId = static_cast<uint32_t>(connectionId);
+  record.type = type;
+  record.reserved = 0;
+  const auto length = std::min(detail.size(), DETAIL_SIZE);
+  std::memcpy(record.detail, detail.data(), length);
+  std::memset(record.detail + length, 0, DETAIL_SIZE - length);
+
+  recordSequence.store(sequence, std::memory_order_release);
+}
+
+FlightRecorder::Contents FlightRecorder::read(
+  const std::filesystem::path& path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    throw std::runtime_error("Failed to open " + path.string());
+  }
+  Contents contents {};
+  auto& header = contents.header;
+  if (
+    !file.read(reinterpret_cast<char*>(&header), sizeof(header))
+    || std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+    throw std::runtime_error(path.string() + " is not a flight recorder file");
+  }
+  if (
+    header.version != VERSION || header.recordSize != sizeof(Record)
+    || header.capacity == 0) {
+    throw std::runtime_error(
+      path.string() + " is from an incompatible version of the plugin");
+  }
+
+  Record record;
+  for (uint64_t i = 0;
+       i < header.capacity
+       && file.read(reinterpret_cast<char*>(&record), sizeof(record));
+       ++i) {
+    // Skip empty or incomplete records, and corrupt records whose sequence
+    // doesn't match their slot
+    if (record.sequence == 0 || (record.sequence - 1) % header.capacity != i) {
+      continue;
+    }
+    contents.records.push_back(record);
+  }
+  std::sort(
+    contents.records.begin(), contents.records.end(),
+    [](const Record& a, const Record& b) { return a.sequence < b.sequence; });
+  return contents;
+}
+
+const char* FlightRecorder::typeToString(EventType type) {
+  switch (type) {
+    case EventType::CONNECTION_OPENED:
+      return "connectionOpened";
+    case EventType::CONNECTION_CLOSED:
+      return "connectionClosed";
+    case EventType::HANDSHAKE_SUCCEEDED:
+      return "handshakeSucceeded";
+    case EventType::HANDSHAKE_FAILED:
+      return "handshakeFailed";
+    case EventType::RPC:
+      return "rpc";
+    case EventType::OUTPUT_STATE_CHANGED:
+      return "outputStateChanged";
+    case EventType::CURRENT_SCENE_CHANGED:
+      return "currentSceneChanged";
+    case EventType::CONFIGURATION_CHANGED:
+      return "configurationChanged";
+    case EventType::PREVIEWS_SKIPPING_STARTED:
+      return "previewsSkippingStarted";
+    case EventType::PREVIEWS_SKIPPING_ENDED:
+      return "previewsSkippingEnded";
+    case EventType::PREVIEW_QUALITY_CHANGED:
+      return "previewQualityChanged";
+  }
+  return "unknown";
+}
@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/** Always-on, fixed-size ring of compact binary events in a memory-mapped
+ * file, for post-mortem analysis.
+ *
+ * The file is a `FileHeader` followed by `capacity` 64-byte `Record`s. Writers
+ * claim a sequence number with a single atomic increment and fill in the
+ * record it maps to, without locks or system calls; as the mapping is shared
+ * with the OS page cache, the file contains every completed record even if
+ * the host application crashes.
+ *
+ * While no recorder exists, `record()` costs an atomic load.
+ *
+ * Recorders are owned by the host, and must be destroyed after the `Plugin`,
+ * as `record()` must not race with destruction. Creating a recorder renames
+ * any existing file to `<path>.previous`, so that restarting after a crash
+ * does not overwrite the evidence.
+ *
+ * Use `flight-recorder-decode` to convert a file into a timeline.
+ */
+class FlightRecorder final {
+ public:
+  enum class EventType : uint16_t {
+    // `detail` is the transport and peer address
+    CONNECTION_OPENED = 1,
+    // `value` is the connection's age in nanoseconds; `detail` is its state
+    CONNECTION_CLOSED = 2,
+    // `value` is nanoseconds since the connection was opened
+    HANDSHAKE_SUCCEEDED = 3,
+    HANDSHAKE_FAILED = 4,
+    // `value` is nanoseconds from receiving the request to sending the
+    // response; `detail` is the method
+    RPC = 5,
+    // `value` is the `OutputState`; `detail` is the output ID
+    OUTPUT_STATE_CHANGED = 6,
+    // `detail` is the scene ID
+    CURRENT_SCENE_CHANGED = 7,
+    CONFIGURATION_CHANGED = 8,
+    // Preview frames are skipped while the client has unsent data; `value`
+    // is the bytes pending when skipping started, or the number of frames
+    // skipped when it ended. `detail` is the scene ID.
+    PREVIEWS_SKIPPING_STARTED = 9,
+    PREVIEWS_SKIPPING_ENDED = 10,
+    // `value` is the new maximum dimension; `detail` is the scene ID
+    PREVIEW_QUALITY_CHANGED = 11,
+  };
+
+  static const size_t DETAIL_SIZE = 32;
+
+  struct Record {
+    // Zero if empty or being written; otherwise, 1-based position in the
+    // stream of events
+    uint64_t sequence;
+    // `Trace::now()` - see `FileHeader::steadyEpoch`
+    uint64_t time;
+    uint64_t value;
+    // Zero for events that aren't tied to a connection
+    uint32_t connectionId;
+    EventType type;
+    uint16_t reserved;
+    // Truncated; not null-terminated if full
+    char detail[DETAIL_SIZE];
+  };
+  static_assert(sizeof(Record) == 64);
+
+  static const uint32_t VERSION = 1;
+
+  struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t recordSize;
+    uint64_t capacity;
+    // The same instant, as `Trace::now()` and as nanoseconds since the Unix
+    // epoch, to convert record times to wall-clock times
+    uint64_t steadyEpoch;
+    uint64_t systemEpoch;
+    uint64_t processId;
+    // Sequence number of the last claimed record
+    uint64_t lastSequence;
+    uint64_t reserved;
+  };
+  static_assert(sizeof(FileHeader) == 64);
+
+  // 4MiB
+  static const size_t DEFAULT_CAPACITY = 64 * 1024;
+
+  // Throws `std::system_error` if the file can not be created or mapped
+  explicit FlightRecorder(
+    const std::filesystem::path& path,
+    size_t capacity = DEFAULT_CAPACITY);
+  FlightRecorder(const FlightRecorder&) = delete;
+  ~FlightRecorder();
+
+  // Writes to the most recently created recorder, if any
+  static void record(
+    EventType type,
+    uint64_t connectionId,
+    uint64_t value = 0,
+    std::string_view detail = {}) {
+    if (auto recorder = sActive.load(std::memory_order_acquire)) {
+      recorder->write(type, connectionId, value, detail);
+    }
+  }
+  static bool isEnabled() {
+    return sActive.load(std::memory_order_relaxed) != nullptr;
+  }
+
+  struct Contents {
+    FileHeader header;
+    // Completed records, oldest first
+    std::vector<Record> records;
+  };
+  // For decoding; throws `std::runtime_error` if the file is not a flight
+  // recorder file
+  static Contents read(const std::filesystem::path& path);
+
+  static const char* typeToString(EventType type);
+
+ private:
+  void write(
+    EventType type,
+    uint64_t connectionId,
+    uint64_t value,
+    std::string_view detail);
+
+  struct Mapping;
+  std::unique_ptr<Mapping> mMapping;
+  FileHeader* mHeader = nullptr;
+  Record* mRecords = nullptr;
+  uint64_t mCapacity = 0;
+
+  static std::atomic<FlightRecorder*> sActive;
+};
@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <sodium.h>
+
+#include <cstdint>
+
+// The binary messages of `handshake_protocol.md`, shared by the server and
+// the native client
+#pragma pack(push, 1)
+struct ClientHelloBox {
+  uint8_t serverToClientKey[crypto_secretstream_xchacha20poly1305_KEYBYTES];
+};
+struct ClientHelloMessage {
+  uint8_t pwhashSalt[crypto_pwhash_SALTBYTES];
+  uint8_t secretBoxNonce[crypto_secretbox_NONCEBYTES];
+  uint8_t secretBox[sizeof(ClientHelloBox) + crypto_secretbox_MACBYTES];
+};
+struct ServerHelloBox {
+  uint8_t clientToServerKey[crypto_secretstream_xchacha20poly1305_KEYBYTES];
+  uint8_t authenticationKey[crypto_auth_KEYBYTES];
+};
+struct ServerHelloMessage {
+  uint8_t secretBoxNonce[crypto_secretbox_NONCEBYTES];
+  uint8_t secretBox[sizeof(ServerHelloBox) + crypto_secretbox_MACBYTES];
+  uint8_t
+    serverToClientHeader[crypto_secretstream_xchacha20poly1305_HEADERBYTES];
+};
+struct ClientReadyMessage {
+  uint8_t
+    clientToServerHeader[crypto_secretstream_xchacha20poly1305_HEADERBYTES];
+  uint8_t authenticationMac[crypto_auth_BYTES];
+};
+#pragma pack(pop)
@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#include "Image.h"
+
+#include <algorithm>
+
+bool Image::empty() const {
+  return width == 0 || height == 0 || rgba.empty();
+}
+
+Image Image::scaledToFit(uint32_t maxDimension) const {
+  if (
+    empty() || maxDimension == 0
+    || (width <= maxDimension && height <= maxDimension)
+  ) {
+    return *this;
+  }
+
+  Image out;
+  if (width >= height) {
+    out.width = maxDimension;
+    out.height = std::max<uint32_t>(
+      1, static_cast<uint32_t>((uint64_t)height * maxDimension / width));
+  } else {
+    out.height = maxDimension;
+    out.width = std::max<uint32_t>(
+      1, static_cast<uint32_t>((uint64_t)width * maxDimension / height));
+  }
+  out.rgba.resize(static_cast<size_t>(out.width) * out.height * 4);
+
+  for (uint32_t dy = 0; dy < out.height; ++dy) {
+    const uint32_t sy0 = (uint64_t)dy * height / out.height;
+    const uint32_t sy1 = std::max<uint32_t>(
+      sy0 + 1, (uint64_t)(dy + 1) * height / out.height);
+    for (uint32_t dx = 0; dx < out.width; ++dx) {
+      const uint32_t sx0 = (uint64_t)dx * width / out.width;
+      const uint32_t sx1 = std::max<uint32_t>(
+        sx0 + 1, (uint64_t)(dx + 1) * width / out.width);
+      uint32_t sum[4] = {0, 0, 0, 0};
+      for (uint32_t sy = sy0; sy < sy1; ++sy) {
+        const uint8_t* row = rgba.data() + (static_cast<size_t>(sy) * width * 4);
+        for (uint32_t sx = sx0; sx < sx1; ++sx) {
+          for (int c = 0; c < 4; ++c) {
+            sum[c] += row[(sx * 4) + c];
+          }
+        }
+      }
+      const uint32_t count = (sy1 - sy0) * (sx1 - sx0);
+      uint8_t* dest
+        = out.rgba.data() + ((static_cast<size_t>(dy) * out.width + dx) * 4);
+      for (int c = 0; c < 4; ++c) {
+        dest[c] = static_cast<uint8_t>(sum[c] / count);
+      }
+    }
+  }
+  return out;
+}
+
+Image Image::cropped(
+  uint32_t x,
+  uint32_t y,
+  uint32_t cropWidth,
+  uint32_t cropHeight) const {
+  if (x >= width || y >= height) {
+    return Image();
+  }
+  Image out;
+  out.width = std::min(cropWidth, width - x);
+  out.height = std::min(cropHeight, height - y);
+  const size_t outStride = static_cast<size_t>(out.width) * 4;
+  out.rgba.resize(outStride * out.height);
+  for (uint32_t row = 0; row < out.height; ++row) {
+    const auto src
+      = rgba.data() + ((static_cast<size_t>(y + row) * width + x) * 4);
+    std::copy(src, src + outStride, out.rgba.data() + (row * outStride));
+  }
+  return out;
+}
@@ -0,0 +1,28 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+struct Image {
+  uint32_t width = 0;
+  uint32_t height = 0;
+  // 8-bit RGBA, tightly packed: the stride is always `width * 4`
+  std::vector<uint8_t> rgba;
+
+  bool empty() const;
+
+  // Box-filtered downscale so that neither dimension exceeds `maxDimension`;
+  // returns a copy if the image already fits, or if `maxDimension` is 0.
+  Image scaledToFit(uint32_t maxDimension) const;
+
+  // The rectangle is clamped to the bounds of the image.
+  Image cropped(uint32_t x, uint32_t y, uint32_t width, uint32_t height) const;
+};
@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#include "ImageTiles.h"
+
+#include "ContentHash.h"
+#include "Image.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// Word-at-a-time multiply/xorshift mixing; much faster than a byte-wise hash
+// like FNV, which matters when hashing every pixel of every frame.
+constexpr uint64_t HASH_MULTIPLIER = 0x9e3779b97f4a7c15ull;
+
+inline uint64_t mix(uint64_t hash, uint64_t word) {
+  hash ^= word;
+  hash *= HASH_MULTIPLIER;
+  return hash ^ (hash >> 29);
+}
+
+uint64_t hash_row(uint64_t hash, const uint8_t* data, size_t size) {
+  size_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    uint64_t word;
+    memcpy(&word, data + i, sizeof(word));
+    hash = mix(hash, word);
+  }
+  // Rows are whole RGBA pixels, so there are at most 4 bytes left
+  if (i < size) {
+    uint64_t word = 0;
+    memcpy(&word, data + i, size - i);
+    hash = mix(hash, word);
+  }
+  return hash;
+}
+
+}// namespace
+
+ImageTiles::ImageTiles() {
+}
+
+ImageTiles::ImageTiles(const Image& image)
+  : mWidth(image.width), mHeight(image.height) {
+  if (image.empty()) {
+    mWidth = 0;
+    mHeight = 0;
+    return;
+  }
+  mColumns = (mWidth + TILE_SIZE - 1) / TILE_SIZE;
+  mRows = (mHeight + TILE_SIZE - 1) / TILE_SIZE;
+  mHashes.assign(static_cast<size_t>(mColumns) * mRows, HASH_MULTIPLIER);
+
+  // Walk the image row by row for cache-friendliness, feeding each tile's
+  // slice of the row into that tile's running hash.
+  const size_t stride = static_cast<size_t>(mWidth) * 4;
+  for (uint32_t y = 0; y < mHeight; ++y) {
+    const auto row = image.rgba.data() + (y * stride);
+    auto hash = mHashes.data() + (static_cast<size_t>(y / TILE_SIZE) * mColumns);
+    for (uint32_t column = 0; column < mColumns; ++column) {
+      const uint32_t x = column * TILE_SIZE;
+      const uint32_t width = std::min(TILE_SIZE, mWidth - x);
+      hash[column] = hash_row(hash[column], row + (x * 4), width * 4);
+    }
+  }
+}
+
+uint32_t ImageTiles::getWidth() const {
+  return mWidth;
+}
+
+uint32_t ImageTiles::getHeight() const {
+  return mHeight;
+}
+
+uint32_t ImageTiles::getTileCount() const {
+  return static_cast<uint32_t>(mHashes.size());
+}
+
+ImageTiles::Rect ImageTiles::getTileRect(uint32_t index) const {
+  const uint32_t x = (index % mColumns) * TILE_SIZE;
+  const uint32_t y = (index / mColumns) * TILE_SIZE;
+  return {
+    .x = x,
+    .y = y,
+    .width = std::min(TILE_SIZE, mWidth - x),
+    .height = std::min(TILE_SIZE, mHeight - y),
+  };
+}
+
+bool ImageTiles::isCompatibleWith(const ImageTiles& base) const {
+  return mWidth == base.mWidth && mHeight == base.mHeight && mWidth != 0;
+}
+
+std::vector<uint32_t> ImageTiles::getChangedTiles(const ImageTiles& base) const {
+  std::vector<uint32_t> changed;
+  const bool compatible = isCompatibleWith(base);
+  for (uint32_t i = 0; i < mHashes.size(); ++i) {
+    if (!compatible || mHashes[i] != base.mHashes[i]) {
+      changed.push_back(i);
+    }
+  }
+  return changed;
+}
+
+std::string ImageTiles::getContentHash() const {
+  std::string buf;
+  buf.resize((sizeof(uint32_t) * 2) + (mHashes.size() * sizeof(uint64_t)));
+  memcpy(buf.data(), &mWidth, sizeof(mWidth));
+  memcpy(buf.data() + sizeof(mWidth), &mHeight, sizeof(mHeight));
+  memcpy(
+    buf.data() + (sizeof(uint32_t) * 2), mHashes.data(),
+    mHashes.size() * sizeof(uint64_t));
+  return content_hash(buf);
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct Image;
+
+/** Per-tile content hashes of an image, for sending only what changed.
+ *
+ * Tiles are TILE_SIZE pixels square, except at the right and bottom edges.
+ * The hashes are only for change detection, and are not collision-resistant.
+ */
+class ImageTiles final {
+ public:
+  static const uint32_t TILE_SIZE = 64;
+
+  struct Rect {
+    uint32_t x;
+    uint32_t y;
+    uint32_t width;
+    uint32_t height;
+  };
+
+  ImageTiles();
+  explicit ImageTiles(const Image& image);
+
+  uint32_t getWidth() const;
+  uint32_t getHeight() const;
+  uint32_t getTileCount() const;
+  Rect getTileRect(uint32_t index) const;
+
+  // Whether `getChangedTiles()` can be meaningfully compared
+  bool isCompatibleWith(const ImageTiles& base) const;
+  // Indices of tiles that differ from `base`; every tile if incompatible
+  std::vector<uint32_t> getChangedTiles(const ImageTiles& base) const;
+
+  // An opaque digest of the whole image, derived from the tile hashes
+  std::string getContentHash() const;
+
+ private:
+  uint32_t mWidth = 0;
+  uint32_t mHeight = 0;
+  uint32_t mColumns = 0;
+  uint32_t mRows = 0;
+  std::vector<uint64_t> mHashes;
+};
@@ -8,14 +8,22 @@
 
 #include "Logger.h"
 
+#include <algorithm>
+#include <cassert>
+#include <condition_variable>
 #include <exception>
 #include <map>
+#include <memory>
 #include <mutex>
+#include <thread>
+#include <vector>
 
 #ifdef _MSC_VER
 #include "Windows.h"
 #endif
 
+using namespace std::chrono;
+
 namespace {
 
 #if __cplusplus > 201703L
@@ -26,7 +34,7 @@ inline bool uncaught_exception() noexcept {
 using std::uncaught_exception;
 #endif
 
-void native_logger(const std::string& message) {
+void native_logger(LogLevel, const std::string& message) {
 #ifndef NDEBUG
 #ifdef _MSC_VER
   HMODULE this_dll = nullptr;
@@ -45,18 +53,331 @@ void native_logger(const std::string& message) {
 #endif
 }
 
-std::recursive_mutex sMutex;
-std::map<size_t, Logger::Impl> sLoggers{{0, &native_logger}};
-size_t sNextLogger = 1;
+// Recursive, as sinks may log
+std::recursive_mutex sSinksMutex;
+std::map<size_t, Logger::Impl> sSinks{{0, &native_logger}};
+std::atomic<size_t> sNextSink = 1;
+
+void dispatch(LogLevel level, const std::string& message) {
+  std::scoped_lock lock(sSinksMutex);
+  for (const auto& [_, sink] : sSinks) {
+    sink(level, message);
+  }
+}
+
+/** Single-producer, single-consumer ring of variable-sized records.
+ *
+ * The owning thread writes records; the background thread formats and
+ * destroys them. Records never wrap: if there isn't enough space before the
+ * end of the buffer, the remainder is skipped with a padding entry.
+ */
+class LogRing final {
+ public:
+  static const size_t CAPACITY = 64 * 1024;
+
+  void* allocate(size_t recordSize) {
+    const size_t size = HEADER_SIZE + align(recordSize);
+    size_t write = mWrite.load(std::memory_order_relaxed);
+    const size_t read = mRead.load(std::memory_order_acquire);
+    const size_t toEnd = CAPACITY - (write % CAPACITY);
+    const size_t padding = (toEnd < size) ? toEnd : 0;
+    if (CAPACITY - (write - read) < padding + size) {
+      return nullptr;
+    }
+    if (padding) {
+      *header(write) = Header {.size = padding, .padding = true};
+      write += padding;
+    }
+    *header(write) = Header {.size = size, .padding = false};
+    mPendingWrite = write + size;
+    return mBuffer + (write % CAPACITY) + HEADER_SIZE;
+  }
+
+  void commit() {
+    mWrite.store(mPendingWrite, std::memory_order_release);
+  }
+
+  template <typename TCallback>
+  void consume(TCallback&& callback) {
+    size_t read = mRead.load(std::memory_order_relaxed);
+    const size_t write = mWrite.load(std::memory_order_acquire);
+    while (read != write) {
+      const auto entry = header(read);
+      if (!entry->padding) {
+        callback(reinterpret_cast<Logger::RecordBase*>(
+          mBuffer + (read % CAPACITY) + HEADER_SIZE));
+      }
+      read += entry->size;
+      mRead.store(read, std::memory_order_release);
+    }
+  }
+
+  // Set when the owning thread exits; the ring is dropped once drained
+  std::atomic<bool> orphaned = false;
+
+ private:
+  struct Header {
+    size_t size;
+    bool padding;
+  };
+  static const size_t ALIGNMENT = alignof(std::max_align_t);
+  static const size_t HEADER_SIZE
+    = (sizeof(Header) + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+
+  static size_t align(size_t size) {
+    return (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+  }
+
+  Header* header(size_t position) {
+    return reinterpret_cast<Header*>(mBuffer + (position % CAPACITY));
+  }
+
+  alignas(std::max_align_t) std::byte mBuffer[CAPACITY];
+  std::atomic<size_t> mWrite = 0;
+  std::atomic<size_t> mRead = 0;
+  // Only accessed by the producer
+  size_t mPendingWrite = 0;
+};
+
+struct BackgroundState {
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::condition_variable flushed;
+  std::thread thread;
+  std::vector<std::shared_ptr<LogRing>> rings;
+  // Reused by `drain_rings()`, so that draining while idle doesn't allocate;
+  // not a function-local static, as that would be destroyed before a static
+  // `BackgroundThread` stops the thread
+  std::vector<std::shared_ptr<LogRing>> drainingRings;
+  bool stopping = false;
+  // Incremented when a flush is requested, and when one has been completed
+  uint64_t flushRequested = 0;
+  uint64_t flushCompleted = 0;
+  // Number of BackgroundThread instances
+  size_t users = 0;
+  // Number of times a producer waited for its ring to be drained
+  std::atomic<size_t> stalls = 0;
+  std::atomic<bool> running = false;
+};
+BackgroundState sBackground;
+
+// Formats and dispatches everything currently in the rings; only called by
+// one thread at a time.
+void drain_rings() {
+  ALLOCATION_SCOPE(LOGGING);
+  auto& rings = sBackground.drainingRings;
+  {
+    std::scoped_lock lock(sBackground.mutex);
+    rings = sBackground.rings;
+  }
+
+  struct Formatted {
+    steady_clock::time_point time;
+    LogLevel level;
+    std::string message;
+  };
+  std::vector<Formatted> messages;
+  for (const auto& ring : rings) {
+    const bool orphaned = ring->orphaned;
+    ring->consume([&messages](Logger::RecordBase* record) {
+      const auto time = record->time;
+      const auto level = record->level;
+      messages.push_back({time, level, record->formatAndDestroy(record)});
+    });
+    if (orphaned) {
+      std::scoped_lock lock(sBackground.mutex);
+      std::erase(sBackground.rings, ring);
+    }
+  }
+  rings.clear();
+
+  // Each ring is in order, but interleave them
+  std::stable_sort(
+    messages.begin(), messages.end(),
+    [](const auto& a, const auto& b) { return a.time < b.time; });
+  for (const auto& message : messages) {
+    dispatch(message.level, message.message);
+  }
+
+  const auto stalls = sBackground.stalls.exchange(0);
+  if (stalls) {
+    dispatch(
+      LogLevel::WARNING,
+      fmt::format("Logger: waited for a full buffer {} times", stalls));
+  }
+}
+
+void background_thread_main() {
+  std::unique_lock lock(sBackground.mutex);
+  while (true) {
+    sBackground.wake.wait_for(lock, milliseconds(50), [] {
+      return sBackground.stopping
+        || sBackground.flushRequested != sBackground.flushCompleted;
+    });
+    const auto stopping = sBackground.stopping;
+    const auto flushRequested = sBackground.flushRequested;
+    lock.unlock();
+    drain_rings();
+    lock.lock();
+    // Nothing drains after the final pass, so it also completes flushes that
+    // were requested while it was running
+    sBackground.flushCompleted
+      = stopping ? sBackground.flushRequested : flushRequested;
+    sBackground.flushed.notify_all();
+    if (stopping) {
+      return;
+    }
+  }
+}
+
+// Registers a ring for the calling thread on first use
+struct ThreadRing {
+  ThreadRing() : ring(std::make_shared<LogRing>()) {
+    std::scoped_lock lock(sBackground.mutex);
+    sBackground.rings.push_back(ring);
+  }
+  ~ThreadRing() {
+    ring->orphaned = true;
+  }
+  std::shared_ptr<LogRing> ring;
+};
+
+LogRing& get_thread_ring() {
+  thread_local ThreadRing ring;
+  return *ring.ring;
+}
+
+// Ring used for the record currently being written on this thread
+thread_local LogRing* tPendingRing = nullptr;
+
 }// namespace
 
-Logger::ImplRegistration::ImplRegistration(const Logger::Impl& impl)
-  : mId(sNextLogger++) {
+#ifdef NDEBUG
+std::atomic<LogLevel> Logger::sLevel = LogLevel::INFO;
+#else
+std::atomic<LogLevel> Logger::sLevel = LogLevel::DEBUG;
+#endif
+
+LogLevel Logger::getLevel() {
+  return sLevel;
+}
+
+void Logger::setLevel(LogLevel level) {
+  sLevel = level;
+}
+
+std::optional<LogLevel> Logger::levelFromString(std::string_view name) {
+  for (const auto level :
+       {LogLevel::TRACE, LogLevel::DEBUG, LogLevel::INFO, LogLevel::WARNING,
+        LogLevel::CRITICAL, LogLevel::NONE}) {
+    if (name == levelToString(level)) {
+      return level;
+    }
+  }
+  return {};
+}
+
+const char* Logger::levelToString(LogLevel level) {
+  switch (level) {
+    case LogLevel::TRACE:
+      return "trace";
+    case LogLevel::DEBUG:
+      return "debug";
+    case LogLevel::INFO:
+      return "info";
+    case LogLevel::WARNING:
+      return "warning";
+    case LogLevel::CRITICAL:
+      return "critical";
+    case LogLevel::NONE:
+      return "none";
+  }
+  return "unknown";
+}
+
+void* Logger::allocateRecord(size_t size) {
+  if (!sBackground.running.load(std::memory_order_relaxed)) {
+    return nullptr;
+  }
+  auto& ring = get_thread_ring();
+  void* storage = ring.allocate(size);
+  if (!storage) {
+    // Wait rather than formatting here, so that this thread's messages stay
+    // in order
+    ++sBackground.stalls;
+    flush();
+    storage = ring.allocate(size);
+    if (!storage) {
+      // Oversized record, or logged by a sink
+      return nullptr;
+    }
+  }
+  tPendingRing = &ring;
+  return storage;
+}
+
+void Logger::commitRecord() {
+  tPendingRing->commit();
+  tPendingRing = nullptr;
+}
+
+void Logger::logNow(LogLevel level, const std::string& message) {
+  dispatch(level, message);
+}
+
+void Logger::flush() {
+  if (!sBackground.running) {
+    return;
+  }
+  std::unique_lock lock(sBackground.mutex);
+  if (std::this_thread::get_id() == sBackground.thread.get_id()) {
+    // Called by a sink
+    return;
+  }
+  if (sBackground.stopping) {
+    // The background thread may already have finished its final drain; the
+    // `BackgroundThread` destructor drains anything left over
+    return;
+  }
+  const auto target = ++sBackground.flushRequested;
+  sBackground.wake.notify_one();
+  sBackground.flushed.wait(lock, [target] {
+    return sBackground.flushCompleted >= target;
+  });
+}
+
+Logger::BackgroundThread::BackgroundThread() {
+  std::scoped_lock lock(sBackground.mutex);
+  if (sBackground.users++ > 0) {
+    return;
+  }
+  assert(!sBackground.thread.joinable());
+  sBackground.stopping = false;
+  sBackground.thread = std::thread(&background_thread_main);
+  sBackground.running = true;
+}
+
+Logger::BackgroundThread::~BackgroundThread() {
   {
-    std::scoped_lock lock(sMutex);
-    sLoggers[mId] = impl;
+    std::scoped_lock lock(sBackground.mutex);
+    if (--sBackground.users > 0) {
+      return;
+    }
+    sBackground.running = false;
+    sBackground.stopping = true;
+    sBackground.wake.notify_one();
   }
+  sBackground.thread.join();
+  // Anything that raced with `running` being cleared
+  drain_rings();
 }
+
+Logger::ImplRegistration::ImplRegistration(const Logger::Impl& impl)
+  : mId(sNextSink++) {
+  std::scoped_lock lock(sSinksMutex);
+  sSinks[mId] = impl;
+}
+
 Logger::ImplRegistration::ImplRegistration(ImplRegistration&& other)
   : mId(other.mId) {
   other.mId = 0;
@@ -69,24 +390,21 @@ Logger::ImplRegistration::~ImplRegistration() {
 void Logger::ImplRegistration::release() {
   if (mId == 0) {
     return;
-
   }
-  std::scoped_lock lock(sMutex);
-  sLoggers.erase(mId);
+  // Don't drop messages that were logged while we were registered
+  flush();
+  std::scoped_lock lock(sSinksMutex);
+  sSinks.erase(mId);
   mId = 0;
 }
 
-void Logger::logImpl(const std::string& message) {
-  std::scoped_lock lock(sMutex);
-  for (const auto& [_, impl] : sLoggers) {
-    impl(message);
-  }
-}
-
 ScopeLogger::~ScopeLogger() {
+  if (!mFunction) {
+    return;
+  }
   if (uncaught_exception()) {
-    Logger::debug("{} - EXCEPTION", mMessage);
+    Logger::trace("{}() - EXCEPTION", mFunction);
   } else {
-    Logger::debug("{} - EXIT", mMessage);
+    Logger::trace("{}() - EXIT", mFunction);
   }
 }
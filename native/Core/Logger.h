@@ -8,22 +8,107 @@
 
 #pragma once
 
+#include "AllocationTracker.h"
+
 #include <fmt/format.h>
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <new>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+
+// Not `ERROR`, as that is a macro on Windows
+enum class LogLevel : uint8_t {
+  TRACE,
+  DEBUG,
+  INFO,
+  WARNING,
+  CRITICAL,
+  NONE,
+};
 
+/** Level-filtered logging with deferred formatting.
+ *
+ * Messages below the current level cost a single relaxed atomic load. While
+ * a `BackgroundThread` exists, enabled messages are not formatted by the
+ * caller: the format string and a copy of the arguments are written to a
+ * lock-free ring buffer owned by the calling thread, and formatted and passed
+ * to the sinks on the background thread; if the buffer is full, the caller
+ * waits for it to be drained. Otherwise, messages are formatted and passed to
+ * the sinks immediately.
+ *
+ * Format strings must be string literals or `std::string`s; C strings and
+ * string views in the arguments are copied.
+ *
+ * If `STREAMING_REMOTE_STRIP_TRACE_LOGGING` is defined, `Logger::trace()`
+ * and `LOG_FUNCTION()` compile to nothing.
+ */
 class Logger {
  public:
-  static void debug(const std::string& in) {
-    logImpl(in);
+  static bool isEnabled(LogLevel level) {
+    return level >= sLevel.load(std::memory_order_relaxed);
+  }
+  static LogLevel getLevel();
+  static void setLevel(LogLevel level);
+  static std::optional<LogLevel> levelFromString(std::string_view name);
+  static const char* levelToString(LogLevel level);
+
+  template <typename T, typename... Args>
+  static void trace(const T& format, Args&&... args) {
+#ifndef STREAMING_REMOTE_STRIP_TRACE_LOGGING
+    log(LogLevel::TRACE, format, std::forward<Args>(args)...);
+#endif
+  }
+
+  template <typename T, typename... Args>
+  static void debug(const T& format, Args&&... args) {
+    log(LogLevel::DEBUG, format, std::forward<Args>(args)...);
+  }
+
+  template <typename T, typename... Args>
+  static void info(const T& format, Args&&... args) {
+    log(LogLevel::INFO, format, std::forward<Args>(args)...);
+  }
+
+  template <typename T, typename... Args>
+  static void warning(const T& format, Args&&... args) {
+    log(LogLevel::WARNING, format, std::forward<Args>(args)...);
+  }
+
+  template <typename T, typename... Args>
+  static void critical(const T& format, Args&&... args) {
+    log(LogLevel::CRITICAL, format, std::forward<Args>(args)...);
   }
 
+  // With no arguments, `format` is logged verbatim.
   template <typename T, typename... Args>
-  static void debug(const T& fmt, Args&&... args) {
-    logImpl(fmt::format(fmt, args...));
+  static void log(LogLevel level, const T& format, Args&&... args) {
+    if (!isEnabled(level)) {
+      return;
+    }
+    ALLOCATION_SCOPE(LOGGING);
+    typedef Record<FormatString<T>, Captured<Args>...> R;
+    static_assert(alignof(R) <= alignof(std::max_align_t));
+    void* storage = allocateRecord(sizeof(R));
+    if (!storage) {
+      // No background thread, or the record can't be queued
+      logNow(level, R::format(format, args...));
+      return;
+    }
+    new (storage) R(level, format, std::forward<Args>(args)...);
+    commitRecord();
   }
 
-  typedef std::function<void(const std::string&)> Impl;
+  // Blocks until every message logged so far has been passed to the sinks.
+  static void flush();
+
+  typedef std::function<void(LogLevel, const std::string&)> Impl;
   class ImplRegistration {
    public:
     ImplRegistration() = delete;
@@ -37,20 +122,84 @@ class Logger {
     size_t mId;
   };
 
+  // Deferred formatting is enabled while at least one of these exists; it is
+  // owned by `Plugin` so that the thread is stopped during plugin shutdown
+  // rather than during static destruction. Destroying the last one flushes.
+  class BackgroundThread {
+   public:
+    BackgroundThread();
+    BackgroundThread(const BackgroundThread&) = delete;
+    ~BackgroundThread();
+  };
+
+  struct RecordBase {
+    LogLevel level;
+    std::chrono::steady_clock::time_point time;
+    std::string (*formatAndDestroy)(RecordBase*);
+  };
+
  private:
-  static void logImpl(const std::string& message);
+  static std::atomic<LogLevel> sLevel;
+
+  template <typename T>
+  using FormatString = std::conditional_t<
+    std::is_array_v<T>,
+    const std::remove_extent_t<T>*,
+    std::string>;
+
+  // Pointers and views may not outlive the call, so own a copy
+  template <typename T>
+  using Captured = std::conditional_t<
+    std::is_same_v<std::decay_t<T>, const char*>
+      || std::is_same_v<std::decay_t<T>, char*>
+      || std::is_same_v<std::decay_t<T>, std::string_view>,
+    std::string,
+    std::decay_t<T>>;
+
+  template <typename TFormat, typename... Targs>
+  struct Record final : RecordBase {
+    template <typename T, typename... Args>
+    Record(LogLevel level, const T& format, Args&&... args)
+      : RecordBase {level, std::chrono::steady_clock::now(), &formatAndDestroy},
+        mFormat(format),
+        mArgs(std::forward<Args>(args)...) {
+    }
+
+    template <typename T, typename... Args>
+    static std::string format(const T& format, const Args&... args) {
+      if constexpr (sizeof...(Args) == 0) {
+        return std::string(format);
+      } else {
+        return fmt::format(format, args...);
+      }
+    }
+
+    static std::string formatAndDestroy(RecordBase* base) {
+      auto self = static_cast<Record*>(base);
+      auto message = std::apply(
+        [self](const auto&... args) { return format(self->mFormat, args...); },
+        self->mArgs);
+      self->~Record();
+      return message;
+    }
+
+    TFormat mFormat;
+    std::tuple<Targs...> mArgs;
+  };
+
+  static void* allocateRecord(size_t size);
+  static void commitRecord();
+  static void logNow(LogLevel level, const std::string& message);
 };
 
 class ScopeLogger {
  public:
   ScopeLogger() = delete;
-  ScopeLogger(const std::string& message) {
-    init(message);
-  }
-
-  template <typename T, typename... Args>
-  ScopeLogger(const T& fmt, Args&&... args) {
-    init(fmt::format(fmt, args...));
+  explicit ScopeLogger(const char* function) {
+    if (Logger::isEnabled(LogLevel::TRACE)) {
+      mFunction = function;
+      Logger::trace("{}() - ENTER", function);
+    }
   }
 
   ScopeLogger(const ScopeLogger& other) = delete;
@@ -58,12 +207,14 @@ class ScopeLogger {
   ~ScopeLogger();
 
  private:
-  void init(const std::string& message) {
-    Logger::debug("{} - ENTER", message);
-    mMessage = message;
-  }
-  std::string mMessage;
+  const char* mFunction = nullptr;
 };
 
 // TODO: support logging function arguments
-#define LOG_FUNCTION(...) ScopeLogger _function_scope_log("{}()", __FUNCTION__)
+#ifdef STREAMING_REMOTE_STRIP_TRACE_LOGGING
+#define LOG_FUNCTION(...) \
+  do { \
+  } while (false)
+#else
+#define LOG_FUNCTION(...) ScopeLogger _function_scope_log(__FUNCTION__)
+#endif
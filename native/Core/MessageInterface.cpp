@@ -8,8 +8,28 @@
 
 #include "MessageInterface.h"
 
-MessageInterface::MessageInterface() {
+MessageInterface::MessageInterface(const Strand& strand) : mStrand(strand) {
+}
+
+const MessageInterface::Strand& MessageInterface::getStrand() const {
+  return mStrand;
 }
 
 MessageInterface::~MessageInterface() {
 }
+
+uint64_t MessageInterface::getBytesSent() const {
+  return mBytesSent;
+}
+
+uint64_t MessageInterface::getBytesReceived() const {
+  return mBytesReceived;
+}
+
+void MessageInterface::addBytesSent(size_t bytes) {
+  mBytesSent += bytes;
+}
+
+void MessageInterface::addBytesReceived(size_t bytes) {
+  mBytesReceived += bytes;
+}
@@ -10,16 +10,40 @@
 
 #include "Signal.h"
 
+#include <asio.hpp>
 #include <string>
 
+// All methods must be called from, and all signals are emitted on, the
+// connection's strand; this lets each connection be handled as if it were
+// single-threaded while the io_context is run by several threads.
 class MessageInterface {
  public:
+  typedef asio::strand<asio::io_context::executor_type> Strand;
+
   virtual ~MessageInterface();
+  const Strand& getStrand() const;
   virtual void sendMessage(const std::string& message) = 0;
   virtual void disconnect() = 0;
+  // Bytes passed to `sendMessage()` that have not yet been written to the
+  // socket; used to skip optional messages for slow consumers.
+  virtual size_t getPendingSendBytes() const = 0;
+  // For example, "tcp"; used to label metrics
+  virtual const char* getTransportName() const = 0;
+  // For example, "127.0.0.1:1234"; empty if unknown
+  virtual std::string getPeerAddress() const = 0;
+  // Including any transport framing
+  uint64_t getBytesSent() const;
+  uint64_t getBytesReceived() const;
   Signal<const std::string&> messageReceived;
   Signal<> disconnected;
 
  protected:
-  MessageInterface();
+  explicit MessageInterface(const Strand& strand);
+  void addBytesSent(size_t bytes);
+  void addBytesReceived(size_t bytes);
+
+ private:
+  Strand mStrand;
+  uint64_t mBytesSent = 0;
+  uint64_t mBytesReceived = 0;
 };
@@ -0,0 +1,309 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#include "Metrics.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <memory>
+#include <mutex>
+
+using json = nlohmann::json;
+
+namespace {
+
+enum class MetricType {
+  COUNTER,
+  GAUGE,
+  HISTOGRAM,
+};
+
+const char* to_string(MetricType type) {
+  switch (type) {
+    case MetricType::COUNTER:
+      return "counter";
+    case MetricType::GAUGE:
+      return "gauge";
+    case MetricType::HISTOGRAM:
+      return "summary";
+  }
+  return "untyped";
+}
+
+struct Quantile {
+  double value;
+  const char* label;
+  const char* jsonKey;
+};
+const Quantile QUANTILES[] = {
+  {0.5, "0.5", "p50"},
+  {0.9, "0.9", "p90"},
+  {0.99, "0.99", "p99"},
+  {0.999, "0.999", "p999"},
+};
+
+struct Family {
+  MetricType type;
+  std::string help;
+  double scale = 1.0;
+  // Only the map for `type` is used
+  std::map<MetricLabels, std::unique_ptr<Counter>> counters;
+  std::map<MetricLabels, std::function<uint64_t()>> counterFunctions;
+  std::map<MetricLabels, std::unique_ptr<Gauge>> gauges;
+  std::map<MetricLabels, std::unique_ptr<Histogram>> histograms;
+};
+
+std::mutex sMutex;
+std::map<std::string, Family, std::less<>> sFamilies;
+
+Family& get_family(
+  std::string_view name,
+  std::string_view help,
+  MetricType type,
+  double scale = 1.0) {
+  auto it = sFamilies.find(name);
+  if (it == sFamilies.end()) {
+    it = sFamilies
+           .emplace(
+             std::string(name),
+             Family {.type = type, .help = std::string(help), .scale = scale})
+           .first;
+  }
+  if (it->second.type != type) {
+    throw std::logic_error(
+      fmt::format("Metric '{}' registered with two types", name));
+  }
+  return it->second;
+}
+
+template <typename T>
+T& get_metric(
+  std::map<MetricLabels, std::unique_ptr<T>>& metrics,
+  const MetricLabels& labels) {
+  auto& metric = metrics[labels];
+  if (!metric) {
+    metric = std::make_unique<T>();
+  }
+  return *metric;
+}
+
+std::string escape_label_value(const std::string& value) {
+  std::string out;
+  out.reserve(value.size());
+  for (const auto c : value) {
+    switch (c) {
+      case '\\':
+        out += "\\\\";
+        break;
+      case '"':
+        out += "\\\"";
+        break;
+      case '\n':
+        out += "\\n";
+        break;
+      default:
+        out += c;
+    }
+  }
+  return out;
+}
+
+std::string format_labels(
+  const MetricLabels& labels,
+  const char* extraKey = nullptr,
+  const std::string& extraValue = {}) {
+  if (labels.empty() && !extraKey) {
+    return {};
+  }
+  std::string out("{");
+  for (const auto& [key, value] : labels) {
+    if (out.size() > 1) {
+      out += ',';
+    }
+    out += fmt::format("{}=\"{}\"", key, escape_label_value(value));
+  }
+  if (extraKey) {
+    if (out.size() > 1) {
+      out += ',';
+    }
+    out += fmt::format("{}=\"{}\"", extraKey, extraValue);
+  }
+  out += '}';
+  return out;
+}
+
+}// namespace
+
+size_t Histogram::getBucketIndex(uint64_t value) {
+  if (value < SUB_BUCKETS) {
+    return value;
+  }
+  value = std::min(value, (uint64_t {1} << MAX_VALUE_BITS) - 1);
+  const unsigned msb = std::bit_width(value) - 1;
+  const unsigned shift = msb - SUB_BUCKET_BITS;
+  return SUB_BUCKETS * (shift + 1) + ((value >> shift) - SUB_BUCKETS);
+}
+
+uint64_t Histogram::getBucketValue(size_t index) {
+  if (index < SUB_BUCKETS) {
+    return index;
+  }
+  const unsigned shift = static_cast<unsigned>(index / SUB_BUCKETS) - 1;
+  const uint64_t lower = (SUB_BUCKETS + (index % SUB_BUCKETS)) << shift;
+  return lower + ((uint64_t {1} << shift) >> 1);
+}
+
+void Histogram::record(uint64_t value) {
+  mBuckets[getBucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+  mSum.fetch_add(value, std::memory_order_relaxed);
+  auto max = mMax.load(std::memory_order_relaxed);
+  while (value > max
+         && !mMax.compare_exchange_weak(
+           max, value, std::memory_order_relaxed)) {
+  }
+}
+
+Histogram::Snapshot Histogram::getSnapshot() const {
+  Snapshot snapshot;
+  // Buckets may be updated while we're copying them, so derive the count
+  // from the buckets we saw
+  for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+    snapshot.buckets[i] = mBuckets[i].load(std::memory_order_relaxed);
+    snapshot.count += snapshot.buckets[i];
+  }
+  snapshot.sum = mSum.load(std::memory_order_relaxed);
+  snapshot.max = mMax.load(std::memory_order_relaxed);
+  return snapshot;
+}
+
+uint64_t Histogram::Snapshot::getPercentile(double quantile) const {
+  if (count == 0) {
+    return 0;
+  }
+  const auto rank = std::max<uint64_t>(
+    1, static_cast<uint64_t>(std::ceil(quantile * count)));
+  uint64_t seen = 0;
+  for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+    seen += buckets[i];
+    if (seen >= rank) {
+      return std::min(getBucketValue(i), max);
+    }
+  }
+  return max;
+}
+
+Counter& Metrics::counter(
+  std::string_view name,
+  std::string_view help,
+  const MetricLabels& labels) {
+  std::scoped_lock lock(sMutex);
+  return get_metric(
+    get_family(name, help, MetricType::COUNTER).counters, labels);
+}
+
+void Metrics::counterFunction(
+  std::string_view name,
+  std::string_view help,
+  const MetricLabels& labels,
+  std::function<uint64_t()> value) {
+  std::scoped_lock lock(sMutex);
+  get_family(name, help, MetricType::COUNTER).counterFunctions[labels]
+    = std::move(value);
+}
+
+Gauge& Metrics::gauge(
+  std::string_view name,
+  std::string_view help,
+  const MetricLabels& labels) {
+  std::scoped_lock lock(sMutex);
+  return get_metric(get_family(name, help, MetricType::GAUGE).gauges, labels);
+}
+
+Histogram& Metrics::histogram(
+  std::string_view name,
+  std::string_view help,
+  const MetricLabels& labels,
+  double scale) {
+  std::scoped_lock lock(sMutex);
+  return get_metric(
+    get_family(name, help, MetricType::HISTOGRAM, scale).histograms, labels);
+}
+
+json Metrics::toJson() {
+  std::scoped_lock lock(sMutex);
+  json out = json::object();
+  for (const auto& [name, family] : sFamilies) {
+    json values = json::array();
+    for (const auto& [labels, counter] : family.counters) {
+      values.push_back({{"labels", labels}, {"value", counter->get()}});
+    }
+    for (const auto& [labels, value] : family.counterFunctions) {
+      values.push_back({{"labels", labels}, {"value", value()}});
+    }
+    for (const auto& [labels, gauge] : family.gauges) {
+      values.push_back({{"labels", labels}, {"value", gauge->get()}});
+    }
+    for (const auto& [labels, histogram] : family.histograms) {
+      const auto snapshot = histogram->getSnapshot();
+      json value {
+        {"labels", labels},
+        {"count", snapshot.count},
+        {"sum", snapshot.sum * family.scale},
+        {"max", snapshot.max * family.scale},
+      };
+      for (const auto& quantile : QUANTILES) {
+        value[quantile.jsonKey]
+          = snapshot.getPercentile(quantile.value) * family.scale;
+      }
+      values.push_back(value);
+    }
+    out[name] = {
+      {"type", to_string(family.type)},
+      {"help", family.help},
+      {"values", values},
+    };
+  }
+  return out;
+}
+
+std::string Metrics::toPrometheusText() {
+  std::scoped_lock lock(sMutex);
+  std::string out;
+  for (const auto& [name, family] : sFamilies) {
+    out += fmt::format("# HELP {} {}\n", name, family.help);
+    out += fmt::format("# TYPE {} {}\n", name, to_string(family.type));
+    for (const auto& [labels, counter] : family.counters) {
+      out += fmt::format(
+        "{}{} {}\n", name, format_labels(labels), counter->get());
+    }
+    for (const auto& [labels, value] : family.counterFunctions) {
+      out += fmt::format("{}{} {}\n", name, format_labels(labels), value());
+    }
+    for (const auto& [labels, gauge] : family.gauges) {
+      out += fmt::format(
+        "{}{} {}\n", name, format_labels(labels), gauge->get());
+    }
+    for (const auto& [labels, histogram] : family.histograms) {
+      const auto snapshot = histogram->getSnapshot();
+      for (const auto& quantile : QUANTILES) {
+        out += fmt::format(
+          "{}{} {}\n", name, format_labels(labels, "quantile", quantile.label),
+          snapshot.getPercentile(quantile.value) * family.scale);
+      }
+      out += fmt::format(
+        "{}_sum{} {}\n", name, format_labels(labels),
+        snapshot.sum * family.scale);
+      out += fmt::format(
+        "{}_count{} {}\n", name, format_labels(labels), snapshot.count);
+    }
+  }
+  return out;
+}
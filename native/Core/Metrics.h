@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+
+typedef std::map<std::string, std::string> MetricLabels;
+
+class Counter final {
+ public:
+  void increment(uint64_t by = 1) {
+    mValue.fetch_add(by, std::memory_order_relaxed);
+  }
+  uint64_t get() const {
+    return mValue.load(std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic<uint64_t> mValue = 0;
+};
+
+class Gauge final {
+ public:
+  void add(int64_t by = 1) {
+    mValue.fetch_add(by, std::memory_order_relaxed);
+  }
+  void sub(int64_t by = 1) {
+    mValue.fetch_sub(by, std::memory_order_relaxed);
+  }
+  void set(int64_t value) {
+    mValue.store(value, std::memory_order_relaxed);
+  }
+  int64_t get() const {
+    return mValue.load(std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic<int64_t> mValue = 0;
+};
+
+/** Lock-free histogram with log-linear buckets, like HdrHistogram.
+ *
+ * Each power of two is split into `SUB_BUCKETS` linear buckets, so recorded
+ * values - and percentiles - are accurate to about 3%. Values of 2^40 and
+ * above (about 18 minutes, in nanoseconds) are clamped.
+ */
+class Histogram final {
+ public:
+  static const unsigned SUB_BUCKET_BITS = 5;
+  static const size_t SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+  static const unsigned MAX_VALUE_BITS = 40;
+  static const size_t BUCKET_COUNT
+    = SUB_BUCKETS * (MAX_VALUE_BITS - SUB_BUCKET_BITS + 1);
+
+  void record(uint64_t value);
+  void record(std::chrono::steady_clock::duration duration) {
+    record(static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count()));
+  }
+
+  struct Snapshot {
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    uint64_t max = 0;
+    std::array<uint64_t, BUCKET_COUNT> buckets {};
+
+    // `quantile` is in [0, 1]
+    uint64_t getPercentile(double quantile) const;
+  };
+  Snapshot getSnapshot() const;
+
+  static size_t getBucketIndex(uint64_t value);
+  // The midpoint of the values that fall in the bucket
+  static uint64_t getBucketValue(size_t index);
+
+ private:
+  std::array<std::atomic<uint64_t>, BUCKET_COUNT> mBuckets {};
+  std::atomic<uint64_t> mSum = 0;
+  std::atomic<uint64_t> mMax = 0;
+};
+
+/** Process-wide registry of named, labelled metrics.
+ *
+ * Lookups take a lock, so hot paths should keep the returned reference;
+ * metrics are never removed, so references remain valid.
+ *
+ * Histograms are exported as summaries (quantiles, sum and count), with
+ * values multiplied by `scale` - for example, latencies are recorded in
+ * nanoseconds and exported in seconds.
+ */
+class Metrics final {
+ public:
+  static Counter& counter(
+    std::string_view name,
+    std::string_view help,
+    const MetricLabels& labels = {});
+  static Gauge& gauge(
+    std::string_view name,
+    std::string_view help,
+    const MetricLabels& labels = {});
+  static Histogram& histogram(
+    std::string_view name,
+    std::string_view help,
+    const MetricLabels& labels = {},
+    double scale = 1.0);
+  // For counters that are kept elsewhere; `value` is called while exporting,
+  // with the registry locked, so must be cheap and must not use `Metrics`.
+  // Replaces any previous function for the same labels.
+  static void counterFunction(
+    std::string_view name,
+    std::string_view help,
+    const MetricLabels& labels,
+    std::function<uint64_t()> value);
+
+  static nlohmann::json toJson();
+  // Prometheus text exposition format, version 0.0.4
+  static std::string toPrometheusText();
+};
+
+// Records the time between construction and `stop()` or destruction
+class HistogramTimer final {
+ public:
+  explicit HistogramTimer(Histogram& histogram)
+    : mHistogram(histogram), mStart(std::chrono::steady_clock::now()) {
+  }
+  HistogramTimer(const HistogramTimer&) = delete;
+
+  ~HistogramTimer() {
+    stop();
+  }
+
+  void stop() {
+    if (!mStopped) {
+      mHistogram.record(std::chrono::steady_clock::now() - mStart);
+      mStopped = true;
+    }
+  }
+
+ private:
+  Histogram& mHistogram;
+  std::chrono::steady_clock::time_point mStart;
+  bool mStopped = false;
+};
@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <optional>
+#include <utility>
+
+/** Unbounded lock-free multi-producer, single-consumer FIFO queue.
+ *
+ * `push()` is wait-free and may be called from any thread; `pop()` must only
+ * be called by one thread at a time. This is Dmitry Vyukov's intrusive MPSC
+ * queue: a producer that has been pre-empted part-way through `push()` makes
+ * later items invisible to `pop()` until it resumes, so `pop()` may return
+ * an empty optional even if other pushes have completed.
+ */
+template <typename T>
+class MpscQueue final {
+ public:
+  MpscQueue() : mHead(&mStub), mTail(&mStub) {
+  }
+  MpscQueue(const MpscQueue&) = delete;
+
+  ~MpscQueue() {
+    while (pop()) {
+    }
+  }
+
+  void push(T value) {
+    push(new Node {.value = std::move(value)});
+  }
+
+  std::optional<T> pop() {
+    Node* tail = mTail;
+    Node* next = tail->next.load(std::memory_order_acquire);
+    if (tail == &mStub) {
+      if (!next) {
+        return {};
+      }
+      mTail = next;
+      tail = next;
+      next = next->next.load(std::memory_order_acquire);
+    }
+    if (next) {
+      mTail = next;
+      return take(tail);
+    }
+    if (tail != mHead.load(std::memory_order_acquire)) {
+      // A producer is between exchanging mHead and linking its node
+      return {};
+    }
+    // `tail` is the last node; put the stub behind it so it can be removed
+    push(&mStub);
+    next = tail->next.load(std::memory_order_acquire);
+    if (next) {
+      mTail = next;
+      return take(tail);
+    }
+    return {};
+  }
+
+ private:
+  struct Node {
+    std::atomic<Node*> next = nullptr;
+    std::optional<T> value;
+  };
+
+  void push(Node* node) {
+    node->next.store(nullptr, std::memory_order_relaxed);
+    Node* prev = mHead.exchange(node, std::memory_order_acq_rel);
+    prev->next.store(node, std::memory_order_release);
+  }
+
+  static std::optional<T> take(Node* node) {
+    std::optional<T> value(std::move(node->value));
+    delete node;
+    return value;
+  }
+
+  Node mStub;
+  std::atomic<Node*> mHead;
+  // Only accessed by the consumer
+  Node* mTail;
+};
@@ -0,0 +1,283 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include "Clock.h"
+#include "SmallFunction.h"
+
+#include <asio.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+/** A value that is provided once, and can be awaited by any number of
+ * coroutines; for example, the result of a call into the streaming software.
+ *
+ * Copies share the same state. `resolve()` and `cancel()` may be called from
+ * any thread, including threads that don't run an io_context; waiters are
+ * resumed on their own executors. Only the first call to either has any
+ * effect.
+ *
+ * States are recycled through a per-thread pool, so once warmed up, creating,
+ * resolving, and awaiting a `OneShot` doesn't allocate beyond the coroutine
+ * machinery itself, except for waits with a deadline.
+ */
+template <typename T>
+class OneShot final {
+ public:
+  OneShot() : mState(acquire()) {
+  }
+
+  OneShot(const OneShot& other) : mState(other.mState) {
+    mState->refs.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  OneShot(OneShot&& other) noexcept
+    : mState(std::exchange(other.mState, nullptr)) {
+  }
+
+  OneShot& operator=(OneShot other) noexcept {
+    std::swap(mState, other.mState);
+    return *this;
+  }
+
+  ~OneShot() {
+    if (
+      mState && mState->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      release(mState);
+    }
+  }
+
+  // Returns false if already resolved or cancelled
+  bool resolve(T value) {
+    std::scoped_lock lock(mState->mutex);
+    if (mState->status != Status::PENDING) {
+      return false;
+    }
+    mState->value.emplace(std::move(value));
+    mState->status = Status::RESOLVED;
+    completeAll(asio::error_code());
+    return true;
+  }
+
+  // Waiters throw `asio::system_error` with `asio::error::operation_aborted`.
+  // Returns false if already resolved or cancelled.
+  bool cancel() {
+    std::scoped_lock lock(mState->mutex);
+    if (mState->status != Status::PENDING) {
+      return false;
+    }
+    mState->status = Status::CANCELLED;
+    completeAll(asio::error::operation_aborted);
+    return true;
+  }
+
+  bool isResolved() const {
+    std::scoped_lock lock(mState->mutex);
+    return mState->status == Status::RESOLVED;
+  }
+
+  // Returns immediately if already resolved
+  asio::awaitable<T> async_wait() {
+    auto self = *this;
+    if (!self.isPending()) {
+      co_return self.result();
+    }
+    co_await asio::async_initiate<
+      decltype(asio::use_awaitable), void(asio::error_code)>(
+      [&self](auto&& handler) {
+        self.addWaiter(std::move(handler), nullptr);
+      },
+      asio::use_awaitable);
+    co_return self.result();
+  }
+
+  // Returns nothing if the deadline passes first; the deadline uses `Clock`,
+  // so can be simulated
+  asio::awaitable<std::optional<T>> async_wait_until(
+    Clock::time_point deadline) {
+    auto self = *this;
+    if (!self.isPending()) {
+      co_return self.result();
+    }
+    auto timeout
+      = std::make_shared<Timeout>(co_await asio::this_coro::executor);
+    timeout->timer.expires_at(deadline);
+    asio::error_code ec;
+    auto token = asio::redirect_error(asio::use_awaitable, ec);
+    co_await asio::async_initiate<decltype(token), void(asio::error_code)>(
+      [&self, timeout](auto&& handler) {
+        const auto id = self.addWaiter(std::move(handler), timeout);
+        if (!id) {
+          return;
+        }
+        timeout->timer.async_wait(
+          [self, id](const asio::error_code& error) mutable {
+            if (!error) {
+              self.expire(*id);
+            }
+          });
+      },
+      token);
+    if (ec == asio::error::timed_out) {
+      co_return std::nullopt;
+    }
+    co_return self.result();
+  }
+
+  asio::awaitable<std::optional<T>> async_wait_for(Clock::duration timeout) {
+    return async_wait_until(Clock::now() + timeout);
+  }
+
+ private:
+  enum class Status {
+    PENDING,
+    RESOLVED,
+    CANCELLED,
+  };
+
+  struct Timeout {
+    explicit Timeout(const asio::any_io_executor& executor) : timer(executor) {
+    }
+    Timer timer;
+  };
+
+  struct Waiter {
+    uint64_t id = 0;
+    // Posts the handler to its executor; fits `use_awaitable`'s handlers
+    // inline
+    SmallFunction<void(asio::error_code), 128> complete;
+  };
+
+  struct State {
+    std::atomic<uint32_t> refs {1};
+    mutable std::mutex mutex;
+    Status status = Status::PENDING;
+    std::optional<T> value;
+    // Keeps its capacity when recycled
+    std::vector<Waiter> waiters;
+    uint64_t nextWaiterId = 0;
+  };
+
+  // States released by this thread, for reuse
+  struct Pool {
+    static constexpr size_t CAPACITY = 64;
+    std::vector<State*> states;
+
+    ~Pool() {
+      sPoolDestroyed = true;
+      for (auto state: states) {
+        delete state;
+      }
+    }
+  };
+
+  static inline thread_local Pool sPool;
+  // Trivially destructible, so still readable while other thread-locals are
+  // destroyed
+  static inline thread_local bool sPoolDestroyed = false;
+
+  static State* acquire() {
+    if (sPoolDestroyed || sPool.states.empty()) {
+      return new State();
+    }
+    auto state = sPool.states.back();
+    sPool.states.pop_back();
+    state->refs.store(1, std::memory_order_relaxed);
+    return state;
+  }
+
+  static void release(State* state) {
+    if (sPoolDestroyed || sPool.states.size() >= Pool::CAPACITY) {
+      delete state;
+      return;
+    }
+    state->status = Status::PENDING;
+    state->value.reset();
+    state->waiters.clear();
+    sPool.states.push_back(state);
+  }
+
+  bool isPending() const {
+    std::scoped_lock lock(mState->mutex);
+    if (mState->status == Status::CANCELLED) {
+      throw asio::system_error(asio::error::operation_aborted);
+    }
+    return mState->status == Status::PENDING;
+  }
+
+  // Only called once resolved
+  T result() const {
+    std::scoped_lock lock(mState->mutex);
+    if (mState->status != Status::RESOLVED) {
+      throw asio::system_error(asio::error::operation_aborted);
+    }
+    return *mState->value;
+  }
+
+  // Returns nothing if the handler was completed immediately
+  template <typename Handler>
+  std::optional<uint64_t> addWaiter(
+    Handler&& handler,
+    std::shared_ptr<Timeout> timeout) {
+    Waiter waiter {
+      .complete
+      = [handler = std::move(handler), timeout = std::move(timeout)](
+          asio::error_code ec) mutable {
+          const auto executor = asio::get_associated_executor(handler);
+          asio::post(
+            executor,
+            [handler = std::move(handler), timeout = std::move(timeout),
+             ec]() mutable {
+              if (timeout) {
+                timeout->timer.cancel();
+              }
+              handler(ec);
+            });
+        },
+    };
+    std::scoped_lock lock(mState->mutex);
+    if (mState->status != Status::PENDING) {
+      waiter.complete(
+        mState->status == Status::RESOLVED ? asio::error_code()
+                                           : asio::error::operation_aborted);
+      return std::nullopt;
+    }
+    waiter.id = mState->nextWaiterId++;
+    mState->waiters.push_back(std::move(waiter));
+    return mState->waiters.back().id;
+  }
+
+  void expire(uint64_t id) {
+    std::scoped_lock lock(mState->mutex);
+    auto& waiters = mState->waiters;
+    for (auto it = waiters.begin(); it != waiters.end(); ++it) {
+      if (it->id == id) {
+        it->complete(asio::error::timed_out);
+        waiters.erase(it);
+        return;
+      }
+    }
+  }
+
+  // With the lock held; handlers are posted, never invoked inline
+  void completeAll(const asio::error_code& ec) {
+    for (auto& waiter: mState->waiters) {
+      waiter.complete(ec);
+    }
+    mState->waiters.clear();
+  }
+
+  State* mState;
+};
@@ -12,9 +12,13 @@
 #include "Server.h"
 #include "StreamingSoftware.h"
 
+#include <algorithm>
+#include <future>
+
 Plugin::Plugin(
   std::shared_ptr<asio::io_context> context,
-  std::shared_ptr<StreamingSoftware> software
+  std::shared_ptr<StreamingSoftware> software,
+  unsigned int threadCount
 ):
   mContext(context),
   mWork(asio::make_work_guard(*mContext)),
@@ -22,28 +26,31 @@ Plugin::Plugin(
 {
   LOG_FUNCTION();
 
+  mServer = std::make_unique<Server>(mContext, mSoftware);
+  if (mSoftware->initialized.wasEmitted()) {
+    mServer->startListening(mSoftware->getConfiguration());
+  } else {
+    mSoftware->initialized.connect(mServer.get(), &Server::startListening);
+  }
+
+  threadCount = std::max(threadCount, 1u);
+  Logger::info("Starting ASIO context with {} threads", threadCount);
   std::promise<void> running;
   asio::post(*mContext, [&running] { running.set_value(); });
-  mThread = std::thread([this]() {
-    auto server = new Server(mContext, this->mSoftware);
-    if (mSoftware->initialized.wasEmitted()) {
-      server->startListening(mSoftware->getConfiguration());
-    } else {
-      mSoftware->initialized.connect(server, &Server::startListening);
-    }
-    Logger::debug("Starting ASIO context");
-    try {
-      mContext->run();
-      Logger::debug("ASIO context cleanly finished");
-    } catch (const std::exception& e) {
-      Logger::debug("Unclean exit from ASIO context: {}", e.what());
-      throw;
-    } catch (...) {
-      Logger::debug("Unclean exit from ASIO context");
-      throw;
-    }
-    delete server;
-  });
+  for (unsigned int i = 0; i < threadCount; ++i) {
+    mThreads.emplace_back([this]() {
+      try {
+        mContext->run();
+        Logger::debug("ASIO context cleanly finished");
+      } catch (const std::exception& e) {
+        Logger::critical("Unclean exit from ASIO context: {}", e.what());
+        throw;
+      } catch (...) {
+        Logger::critical("Unclean exit from ASIO context");
+        throw;
+      }
+    });
+  }
   auto future = running.get_future();
   future.wait();
 }
@@ -52,9 +59,10 @@ Plugin::~Plugin() {
   LOG_FUNCTION();
   mWork.reset();
   mContext->stop();
-  Logger::debug("~Plugin: waiting for thread");
+  Logger::debug("~Plugin: waiting for threads");
   wait();
-  Logger::debug("~Plugin: thread joined");
+  Logger::debug("~Plugin: threads joined");
+  mServer.reset();
 }
 
 asio::io_context& Plugin::getContext() {
@@ -62,5 +70,13 @@ asio::io_context& Plugin::getContext() {
 }
 
 void Plugin::wait() {
-  mThread.join();
+  for (auto& thread : mThreads) {
+    if (thread.joinable()) {
+      thread.join();
+    }
+  }
+}
+
+unsigned int Plugin::getDefaultThreadCount() {
+  return std::clamp(std::thread::hardware_concurrency() / 2, 1u, 4u);
 }
@@ -8,16 +8,24 @@
 
 #pragma once
 
+#include "Logger.h"
+
 #include <asio.hpp>
 #include <thread>
+#include <vector>
 
+class Server;
 class StreamingSoftware;
 
 class Plugin final {
  public:
+  // `threadCount` threads run the io_context; each connection is bound to a
+  // strand, so connections are handled concurrently, but each connection's
+  // own handlers never run concurrently with each other.
   Plugin(
     std::shared_ptr<asio::io_context> context,
-    std::shared_ptr<StreamingSoftware> software
+    std::shared_ptr<StreamingSoftware> software,
+    unsigned int threadCount = getDefaultThreadCount()
   );
   ~Plugin();
 
@@ -25,9 +33,15 @@ class Plugin final {
 
   void wait();
 
+  // Leaves most cores for the streaming software itself
+  static unsigned int getDefaultThreadCount();
+
  private:
-  std::thread mThread;
+  // First, so that it outlives everything that might log
+  Logger::BackgroundThread mLoggerThread;
+  std::vector<std::thread> mThreads;
   std::shared_ptr<asio::io_context> mContext;
   std::shared_ptr<StreamingSoftware> mSoftware;
+  std::unique_ptr<Server> mServer;
   asio::executor_work_guard<asio::io_context::executor_type> mWork;
 };
@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#include "Png.h"
+
+#include "Image.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+namespace {
+
+std::array<uint32_t, 256> make_crc_table() {
+  std::array<uint32_t, 256> table {};
+  for (uint32_t n = 0; n < 256; ++n) {
+    uint32_t c = n;
+    for (int k = 0; k < 8; ++k) {
+      c = (c & 1) ? (0xedb88320u ^ (c >> 1)) : (c >> 1);
+    }
+    table[n] = c;
+  }
+  return table;
+}
+
+uint32_t crc32(const char* data, size_t size) {
+  static const auto table = make_crc_table();
+  uint32_t c = 0xffffffffu;
+  for (size_t i = 0; i < size; ++i) {
+    c = table[(c ^ static_cast<uint8_t>(data[i])) & 0xff] ^ (c >> 8);
+  }
+  return c ^ 0xffffffffu;
+}
+
+void append_u32(std::string& out, uint32_t value) {
+  out.push_back(static_cast<char>((value >> 24) & 0xff));
+  out.push_back(static_cast<char>((value >> 16) & 0xff));
+  out.push_back(static_cast<char>((value >> 8) & 0xff));
+  out.push_back(static_cast<char>(value & 0xff));
+}
+
+void append_chunk(std::string& out, const char type[4], const std::string& data) {
+  append_u32(out, static_cast<uint32_t>(data.size()));
+  const auto crcStart = out.size();
+  out.append(type, 4);
+  out.append(data);
+  append_u32(out, crc32(out.data() + crcStart, out.size() - crcStart));
+}
+
+}// namespace
+
+std::string encode_uncompressed_png(const Image& image) {
+  if (image.empty()) {
+    return std::string();
+  }
+
+  // Scanlines, each prefixed with filter type 0 (none)
+  const size_t stride = static_cast<size_t>(image.width) * 4;
+  std::string raw;
+  raw.reserve((stride + 1) * image.height);
+  for (uint32_t y = 0; y < image.height; ++y) {
+    raw.push_back(0);
+    raw.append(
+      reinterpret_cast<const char*>(image.rgba.data() + (y * stride)), stride);
+  }
+
+  // zlib stream using 'stored' deflate blocks
+  std::string zlib;
+  zlib.reserve(raw.size() + ((raw.size() / 0xffff) + 1) * 5 + 6);
+  zlib.push_back(0x78);
+  zlib.push_back(0x01);
+  uint32_t adlerA = 1, adlerB = 0;
+  for (size_t offset = 0; offset < raw.size();) {
+    const uint16_t len
+      = static_cast<uint16_t>(std::min<size_t>(0xffff, raw.size() - offset));
+    const bool final = offset + len == raw.size();
+    zlib.push_back(final ? 1 : 0);
+    zlib.push_back(static_cast<char>(len & 0xff));
+    zlib.push_back(static_cast<char>(len >> 8));
+    zlib.push_back(static_cast<char>(~len & 0xff));
+    zlib.push_back(static_cast<char>((~len >> 8) & 0xff));
+    zlib.append(raw, offset, len);
+    for (size_t i = offset; i < offset + len; ++i) {
+      adlerA = (adlerA + static_cast<uint8_t>(raw[i])) % 65521;
+      adlerB = (adlerB + adlerA) % 65521;
+    }
+    offset += len;
+  }
+  append_u32(zlib, (adlerB << 16) | adlerA);
+
+  std::string header;
+  append_u32(header, image.width);
+  append_u32(header, image.height);
+  header.push_back(8);// bit depth
+  header.push_back(6);// color type: RGBA
+  header.push_back(0);// compression
+  header.push_back(0);// filter
+  header.push_back(0);// interlace
+
+  std::string out("\x89PNG\r\n\x1a\n", 8);
+  append_chunk(out, "IHDR", header);
+  append_chunk(out, "IDAT", zlib);
+  append_chunk(out, "IEND", std::string());
+  return out;
+}
@@ -0,0 +1,20 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <string>
+
+struct Image;
+
+/** Encode an image as a PNG, without any compression.
+ *
+ * This is only a fallback for backends without an image library (e.g. Dummy);
+ * the output is larger than the raw pixel data.
+ */
+std::string encode_uncompressed_png(const Image& image);
@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#include "PreviewDeltaTracker.h"
+
+#include "ImageTiles.h"
+#include "PreviewFrame.h"
+
+PreviewDeltaTracker::PreviewDeltaTracker() {
+}
+
+PreviewDeltaTracker::~PreviewDeltaTracker() {
+}
+
+const std::string& PreviewDeltaTracker::getNotification(
+  PreviewFrame& frame,
+  uint32_t maxDimension,
+  const std::string& contentType,
+  int quality) {
+  const auto tiles = frame.getTiles(maxDimension);
+  if (!tiles) {
+    return frame.getNotification(maxDimension, contentType, quality);
+  }
+
+  mUnacknowledged.emplace(frame.getSequence(), tiles);
+  while (mUnacknowledged.size() > MAX_UNACKNOWLEDGED) {
+    mUnacknowledged.erase(mUnacknowledged.begin());
+  }
+
+  if (mBase && tiles->isCompatibleWith(*mBase)) {
+    const auto changed = tiles->getChangedTiles(*mBase);
+    // Past this point, a single image compresses better than many tiles
+    if (changed.size() * 2 <= tiles->getTileCount()) {
+      return frame.getDeltaNotification(maxDimension, mBaseSequence, changed);
+    }
+  }
+  return frame.getNotification(maxDimension, contentType, quality);
+}
+
+void PreviewDeltaTracker::acknowledge(uint64_t sequence) {
+  auto it = mUnacknowledged.find(sequence);
+  if (it == mUnacknowledged.end()) {
+    return;
+  }
+  mBaseSequence = sequence;
+  mBase = it->second;
+  mUnacknowledged.erase(mUnacknowledged.begin(), std::next(it));
+}
@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+
+class ImageTiles;
+class PreviewFrame;
+
+/** Per-client state for tile-based delta previews.
+ *
+ * Deltas are always relative to the most recent frame the client has
+ * acknowledged, so dropped or reordered frames can not corrupt the client's
+ * image.
+ */
+class PreviewDeltaTracker final {
+ public:
+  PreviewDeltaTracker();
+  ~PreviewDeltaTracker();
+
+  // Either a keyframe, or the tiles that changed since the acknowledged frame;
+  // `contentType` and `quality` only apply to keyframes.
+  const std::string& getNotification(
+    PreviewFrame& frame,
+    uint32_t maxDimension,
+    const std::string& contentType = "image/png",
+    int quality = -1);
+  void acknowledge(uint64_t sequence);
+
+ private:
+  // Bound memory use if the client never acknowledges anything
+  static const size_t MAX_UNACKNOWLEDGED = 32;
+
+  std::map<uint64_t, std::shared_ptr<const ImageTiles>> mUnacknowledged;
+  uint64_t mBaseSequence = 0;
+  std::shared_ptr<const ImageTiles> mBase;
+};
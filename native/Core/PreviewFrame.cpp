@@ -0,0 +1,225 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#include "PreviewFrame.h"
+
+#include "Base64.h"
+#include "ImageTiles.h"
+#include "StreamingSoftware.h"
+
+using json = nlohmann::json;
+
+PreviewFrame::PreviewFrame(
+  std::shared_ptr<StreamingSoftware> software,
+  const std::string& sceneId,
+  uint64_t sequence,
+  Image image)
+  : mSoftware(software),
+    mSceneId(sceneId),
+    mSequence(sequence),
+    mImage(std::move(image)) {
+}
+
+PreviewFrame::PreviewFrame(
+  const std::string& sceneId,
+  uint64_t sequence,
+  const std::string& base64Png)
+  : mSceneId(sceneId), mSequence(sequence), mFallbackBase64Png(base64Png) {
+  if (!base64Png.empty()) {
+    mFallbackNotification = makeNotification({
+      {"keyframe", true},
+      {"content_type", "image/png"},
+      {"base64_data", base64Png},
+    });
+  }
+}
+
+const std::string& PreviewFrame::getSceneId() const {
+  return mSceneId;
+}
+
+uint64_t PreviewFrame::getSequence() const {
+  return mSequence;
+}
+
+uint32_t PreviewFrame::getWidth() const {
+  return mImage.width;
+}
+
+uint32_t PreviewFrame::getHeight() const {
+  return mImage.height;
+}
+
+PreviewFrame::Rendition& PreviewFrame::getRendition(uint32_t maxDimension) {
+  auto it = mRenditions.find(maxDimension);
+  if (it != mRenditions.end()) {
+    return it->second;
+  }
+  auto& rendition = mRenditions[maxDimension];
+  rendition.image = mImage.scaledToFit(maxDimension);
+  auto tiles = std::make_shared<ImageTiles>(rendition.image);
+  rendition.base64Tiles.resize(tiles->getTileCount());
+  rendition.tiles = std::move(tiles);
+  return rendition;
+}
+
+std::shared_ptr<const ImageTiles> PreviewFrame::getTiles(
+  uint32_t maxDimension) {
+  std::scoped_lock lock(mMutex);
+  if (mImage.empty()) {
+    return nullptr;
+  }
+  return getRendition(maxDimension).tiles;
+}
+
+const Image& PreviewFrame::getImage(uint32_t maxDimension) {
+  std::scoped_lock lock(mMutex);
+  if (mImage.empty()) {
+    return mImage;
+  }
+  return getRendition(maxDimension).image;
+}
+
+const std::string& PreviewFrame::getBase64Png(uint32_t maxDimension) {
+  std::scoped_lock lock(mMutex);
+  if (mImage.empty()) {
+    return mFallbackBase64Png;
+  }
+  auto& rendition = getRendition(maxDimension);
+  if (rendition.base64Png.empty()) {
+    rendition.base64Png
+      = base64_encode(mSoftware->encodeImage(rendition.image, "image/png", -1));
+  }
+  return rendition.base64Png;
+}
+
+json PreviewFrame::getTilesJson(
+  uint32_t maxDimension,
+  const std::vector<uint32_t>& indices) {
+  std::scoped_lock lock(mMutex);
+  auto tiles = json::array();
+  if (mImage.empty()) {
+    return tiles;
+  }
+  auto& rendition = getRendition(maxDimension);
+  for (const auto index : indices) {
+    const auto rect = rendition.tiles->getTileRect(index);
+    auto& data = rendition.base64Tiles.at(index);
+    if (data.empty()) {
+      data = base64_encode(mSoftware->encodeImage(
+        rendition.image.cropped(rect.x, rect.y, rect.width, rect.height),
+        "image/png", -1));
+    }
+    tiles.push_back({
+      {"x", rect.x},
+      {"y", rect.y},
+      {"width", rect.width},
+      {"height", rect.height},
+      {"base64_data", data},
+    });
+  }
+  return tiles;
+}
+
+const std::string& PreviewFrame::getNotification(uint32_t maxDimension) {
+  std::scoped_lock lock(mMutex);
+  if (mImage.empty()) {
+    return mFallbackNotification;
+  }
+
+  auto& rendition = getRendition(maxDimension);
+  if (rendition.notification.empty()) {
+    const auto& png = getBase64Png(maxDimension);
+    if (!png.empty()) {
+      rendition.notification = makeNotification({
+        {"keyframe", true},
+        {"width", rendition.image.width},
+        {"height", rendition.image.height},
+        {"tileSize", ImageTiles::TILE_SIZE},
+        {"content_type", "image/png"},
+        {"base64_data", png},
+      });
+    }
+  }
+  return rendition.notification;
+}
+
+const std::string& PreviewFrame::getNotification(
+  uint32_t maxDimension,
+  const std::string& contentType,
+  int quality) {
+  std::scoped_lock lock(mMutex);
+  if (mImage.empty() || contentType == "image/png") {
+    return getNotification(maxDimension);
+  }
+
+  auto& rendition = getRendition(maxDimension);
+  const auto key = std::make_pair(contentType, quality);
+  auto it = rendition.encodedNotifications.find(key);
+  if (it != rendition.encodedNotifications.end()) {
+    return it->second;
+  }
+
+  const auto encoded
+    = mSoftware->encodeImage(rendition.image, contentType, quality);
+  if (encoded.empty()) {
+    return getNotification(maxDimension);
+  }
+  return rendition.encodedNotifications
+    .emplace(
+      key,
+      makeNotification({
+        {"keyframe", true},
+        {"width", rendition.image.width},
+        {"height", rendition.image.height},
+        {"content_type", contentType},
+        {"base64_data", base64_encode(encoded)},
+      }))
+    .first->second;
+}
+
+const std::string& PreviewFrame::getDeltaNotification(
+  uint32_t maxDimension,
+  uint64_t baseSequence,
+  const std::vector<uint32_t>& changedTiles) {
+  std::scoped_lock lock(mMutex);
+  if (mImage.empty()) {
+    return mFallbackNotification;
+  }
+
+  // Every client that acknowledged the same base frame gets the same delta
+  auto& rendition = getRendition(maxDimension);
+  auto it = rendition.deltaNotifications.find(baseSequence);
+  if (it != rendition.deltaNotifications.end()) {
+    return it->second;
+  }
+  return rendition.deltaNotifications
+    .emplace(
+      baseSequence,
+      makeNotification({
+        {"keyframe", false},
+        {"baseSequence", baseSequence},
+        {"width", rendition.image.width},
+        {"height", rendition.image.height},
+        {"tileSize", ImageTiles::TILE_SIZE},
+        {"content_type", "image/png"},
+        {"tiles", getTilesJson(maxDimension, changedTiles)},
+      }))
+    .first->second;
+}
+
+std::string PreviewFrame::makeNotification(json params) const {
+  params["sceneId"] = mSceneId;
+  params["sequence"] = mSequence;
+  return json{
+    {"jsonrpc", "2.0"},
+    {"method", "previews/frame"},
+    {"params", params},
+  }
+    .dump();
+}
@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include "Image.h"
+
+#include <nlohmann/json.hpp>
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+class ImageTiles;
+class StreamingSoftware;
+
+/** A single capture of a scene, shared by every subscriber of that scene.
+ *
+ * Each requested size is scaled, tiled, encoded, and serialized at most once
+ * per frame, no matter how many clients receive it. Frames are shared between
+ * connections on different strands, so the lazily-populated caches are
+ * guarded by a mutex; returned references remain valid for the frame's
+ * lifetime.
+ */
+class PreviewFrame final {
+ public:
+  PreviewFrame(
+    std::shared_ptr<StreamingSoftware> software,
+    const std::string& sceneId,
+    uint64_t sequence,
+    Image image);
+  // For backends that can not provide raw pixels; all sizes get this image,
+  // and there are no tiles.
+  PreviewFrame(
+    const std::string& sceneId,
+    uint64_t sequence,
+    const std::string& base64Png);
+  PreviewFrame(const PreviewFrame&) = delete;
+
+  const std::string& getSceneId() const;
+  uint64_t getSequence() const;
+  // Size of the captured image; 0 if the frame does not have raw pixels
+  uint32_t getWidth() const;
+  uint32_t getHeight() const;
+
+  // Null if the frame does not have raw pixels
+  std::shared_ptr<const ImageTiles> getTiles(uint32_t maxDimension);
+
+  // Serialized `previews/frame` keyframe notification, or an empty string if
+  // the frame could not be encoded.
+  const std::string& getNotification(uint32_t maxDimension);
+  // As above, but encoded as `contentType` (see
+  // `StreamingSoftware::encodeImage()`), falling back to PNG if the software
+  // does not support it.
+  const std::string& getNotification(
+    uint32_t maxDimension,
+    const std::string& contentType,
+    int quality);
+  // Serialized `previews/frame` notification containing only `changedTiles`,
+  // relative to the earlier frame `baseSequence`.
+  const std::string& getDeltaNotification(
+    uint32_t maxDimension,
+    uint64_t baseSequence,
+    const std::vector<uint32_t>& changedTiles);
+
+  const Image& getImage(uint32_t maxDimension);
+  const std::string& getBase64Png(uint32_t maxDimension);
+  nlohmann::json getTilesJson(
+    uint32_t maxDimension,
+    const std::vector<uint32_t>& tiles);
+
+ private:
+  struct Rendition {
+    Image image;
+    std::shared_ptr<const ImageTiles> tiles;
+    std::string base64Png;
+    std::string notification;
+    std::map<std::pair<std::string, int>, std::string> encodedNotifications;
+    std::vector<std::string> base64Tiles;
+    std::map<uint64_t, std::string> deltaNotifications;
+  };
+  Rendition& getRendition(uint32_t maxDimension);
+  std::string makeNotification(nlohmann::json params) const;
+
+  std::shared_ptr<StreamingSoftware> mSoftware;
+  std::string mSceneId;
+  uint64_t mSequence;
+  Image mImage;
+  std::string mFallbackBase64Png;
+  std::string mFallbackNotification;
+  std::recursive_mutex mMutex;
+  std::map<uint32_t, Rendition> mRenditions;
+};
@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#include "PreviewManager.h"
+
+#include "AllocationTracker.h"
+#include "Logger.h"
+#include "Metrics.h"
+#include "PreviewFrame.h"
+#include "StreamingSoftware.h"
+#include "Trace.h"
+
+#include <asio.hpp>
+
+#include <algorithm>
+#include <vector>
+
+using namespace std::chrono;
+
+class PreviewManager::ConnectionImpl final : public ConnectionImplBase {
+ public:
+  ConnectionImpl(
+    std::weak_ptr<PreviewManager> manager,
+    const std::string& sceneId,
+    uint64_t key)
+    : mManager(manager), mSceneId(sceneId), mKey(key) {
+  }
+
+  void disconnect() override {
+    auto manager = mManager.lock();
+    if (manager) {
+      manager->unsubscribe(mSceneId, mKey);
+    }
+  }
+
+ private:
+  std::weak_ptr<PreviewManager> mManager;
+  std::string mSceneId;
+  uint64_t mKey;
+};
+
+PreviewManager::Stream::Stream(
+  const Strand& strand,
+  const std::string& sceneId)
+  : sceneId(sceneId), timer(strand) {
+}
+
+PreviewManager::PreviewManager(
+  std::shared_ptr<asio::io_context> context,
+  std::shared_ptr<StreamingSoftware> software)
+  : mContext(context), mStrand(asio::make_strand(*context)), mSoftware(software) {
+}
+
+PreviewManager::~PreviewManager() {
+}
+
+Connection PreviewManager::subscribe(
+  const std::string& sceneId,
+  uint16_t maxFps,
+  uint32_t maxDimension,
+  const FrameCallback& callback) {
+  maxFps = std::clamp<uint16_t>(maxFps, 1, MAX_FPS);
+
+  const auto key = mNextKey++;
+  Subscription subscription {
+    .interval = duration_cast<Clock::duration>(seconds(1)) / maxFps,
+    .maxDimension = maxDimension,
+    .callback = callback,
+    .nextFrameAt = Clock::now(),
+  };
+  asio::post(
+    mStrand, [self = shared_from_this(), sceneId, key, subscription]() {
+      auto& stream = self->mStreams[sceneId];
+      const bool isNewStream = !stream;
+      if (isNewStream) {
+        stream = std::make_shared<Stream>(self->mStrand, sceneId);
+      }
+      stream->subscriptions.emplace(key, subscription);
+
+      if (isNewStream) {
+        Logger::debug("Starting preview stream for scene '{}'", sceneId);
+        asio::co_spawn(
+          self->mStrand, self->runStream(stream), asio::detached);
+      } else {
+        // Wake up so the new subscriber gets a frame promptly
+        stream->timer.cancel();
+      }
+    });
+
+  return std::make_unique<ConnectionImpl>(weak_from_this(), sceneId, key);
+}
+
+void PreviewManager::unsubscribe(const std::string& sceneId, uint64_t key) {
+  asio::post(mStrand, [self = shared_from_this(), sceneId, key]() {
+    auto it = self->mStreams.find(sceneId);
+    if (it == self->mStreams.end()) {
+      return;
+    }
+    auto stream = it->second;
+    stream->subscriptions.erase(key);
+    if (stream->subscriptions.empty()) {
+      Logger::debug("Stopping preview stream for scene '{}'", sceneId);
+      self->mStreams.erase(it);
+      stream->timer.cancel();
+    }
+  });
+}
+
+asio::awaitable<void> PreviewManager::runStream(std::shared_ptr<Stream> stream) {
+  // Keep the manager alive while we're using it
+  auto self = shared_from_this();
+
+  while (!stream->subscriptions.empty()) {
+    auto now = Clock::now();
+
+    // 0 is full size, so is the largest
+    std::vector<uint64_t> due;
+    uint32_t maxDimension = 1;
+    for (const auto& [key, subscription] : stream->subscriptions) {
+      if (subscription.nextFrameAt > now) {
+        continue;
+      }
+      due.push_back(key);
+      if (maxDimension && subscription.maxDimension) {
+        maxDimension = std::max(maxDimension, subscription.maxDimension);
+      } else {
+        maxDimension = 0;
+      }
+    }
+
+    if (!due.empty()) {
+      std::shared_ptr<PreviewFrame> frame;
+      const auto sequence = mNextSequence++;
+      TraceSpan capture("previewCapture");
+      capture.setDetail(stream->sceneId);
+      HistogramTimer captureTimer(Metrics::histogram(
+        "streaming_remote_backend_duration_seconds",
+        "Time taken by the streaming software to handle requests",
+        {{"call", "previewCapture"}}, 1e-9));
+      auto image = co_await mSoftware->captureScene(stream->sceneId, maxDimension);
+      if (!image.empty()) {
+        frame = std::make_shared<PreviewFrame>(
+          mSoftware, stream->sceneId, sequence, std::move(image));
+      } else {
+        const auto png
+          = co_await mSoftware->getSceneThumbnailAsBase64Png(stream->sceneId);
+        if (!png.empty()) {
+          frame = std::make_shared<PreviewFrame>(stream->sceneId, sequence, png);
+        }
+      }
+      captureTimer.stop();
+      capture.end();
+
+      // Subscriptions may have changed while we were capturing; callbacks may
+      // also unsubscribe, so copy them first.
+      ALLOCATION_SCOPE(PREVIEWS);
+      now = Clock::now();
+      std::vector<FrameCallback> callbacks;
+      for (const auto key : due) {
+        auto it = stream->subscriptions.find(key);
+        if (it == stream->subscriptions.end()) {
+          continue;
+        }
+        it->second.nextFrameAt = now + it->second.interval;
+        if (frame) {
+          callbacks.push_back(it->second.callback);
+        }
+      }
+      for (const auto& callback : callbacks) {
+        callback(frame);
+      }
+    }
+
+    if (stream->subscriptions.empty()) {
+      break;
+    }
+
+    auto next = Clock::time_point::max();
+    for (const auto& [key, subscription] : stream->subscriptions) {
+      next = std::min(next, subscription.nextFrameAt);
+    }
+    stream->timer.expires_at(next);
+    asio::error_code ec;
+    co_await stream->timer.async_wait(
+      asio::redirect_error(asio::use_awaitable, ec));
+  }
+}
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include "Clock.h"
+#include "Signal.h"
+
+#include <asio/awaitable.hpp>
+#include <asio/io_context.hpp>
+#include <asio/strand.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+
+class PreviewFrame;
+class StreamingSoftware;
+
+/** Captures scenes for live previews.
+ *
+ * Each subscribed scene is captured at most once per tick, at the highest
+ * frame rate and largest size requested by any subscriber; the resulting frame
+ * is shared by all subscribers of that scene.
+ *
+ * `subscribe()` and disconnection are thread-safe; streams are run on the
+ * manager's own strand, and callbacks are invoked on that strand.
+ */
+class PreviewManager final
+  : public std::enable_shared_from_this<PreviewManager> {
+ public:
+  typedef std::function<void(const std::shared_ptr<PreviewFrame>&)>
+    FrameCallback;
+
+  static const uint16_t MAX_FPS = 30;
+
+  PreviewManager(
+    std::shared_ptr<asio::io_context> context,
+    std::shared_ptr<StreamingSoftware> software);
+  ~PreviewManager();
+
+  // `maxFps` is clamped to [1, MAX_FPS]; a `maxDimension` of 0 requests
+  // full-size frames.
+  Connection subscribe(
+    const std::string& sceneId,
+    uint16_t maxFps,
+    uint32_t maxDimension,
+    const FrameCallback& callback);
+
+ private:
+  struct Subscription {
+    Clock::duration interval;
+    uint32_t maxDimension;
+    FrameCallback callback;
+    Clock::time_point nextFrameAt;
+  };
+  struct Stream {
+    typedef asio::strand<asio::io_context::executor_type> Strand;
+    Stream(const Strand& strand, const std::string& sceneId);
+    std::string sceneId;
+    Timer timer;
+    std::map<uint64_t, Subscription> subscriptions;
+  };
+  class ConnectionImpl;
+
+  asio::awaitable<void> runStream(std::shared_ptr<Stream> stream);
+  void unsubscribe(const std::string& sceneId, uint64_t key);
+
+  std::shared_ptr<asio::io_context> mContext;
+  Stream::Strand mStrand;
+  std::shared_ptr<StreamingSoftware> mSoftware;
+  std::atomic<uint64_t> mNextKey = 0;
+  // Only accessed on mStrand
+  std::map<std::string, std::shared_ptr<Stream>> mStreams;
+  uint64_t mNextSequence = 0;
+};
@@ -8,10 +8,15 @@
 
 #include <sodium.h>
 
+#include "AllocationTracker.h"
 #include "ClientHandler.h"
 #include "Config.h"
+#include "ConnectionRegistry.h"
+#include "FaultInjectingConnection.h"
+#include "FlightRecorder.h"
 #include "Logger.h"
 #include "MessageInterface.h"
+#include "PreviewManager.h"
 #include "StreamingSoftware.h"
 #include "TCPServer.h"
 #include "WebSocketServer.h"
@@ -21,29 +26,58 @@
 Server::Server(
   std::shared_ptr<asio::io_context> context,
   std::shared_ptr<StreamingSoftware> software
-): mContext(context), mSoftware(software) {
+): mContext(context),
+   mStrand(asio::make_strand(*context)),
+   mSoftware(software),
+   mPreviews(std::make_shared<PreviewManager>(context, software)),
+   mConnections(std::make_shared<ConnectionRegistry>()) {
   const auto result = sodium_init();
   assert(result == 0 /* init */ || result == 1 /* already done */);
-  software->configurationChanged.connect(this, &Server::startListening);
+  AllocationTracker::registerMetrics();
+  software->configurationChanged.connect(
+    mStrand, this, &Server::startListeningOnStrand);
+
+  // Emitted from the software's own threads
+  software->configurationChanged.connect([](const Config&) {
+    FlightRecorder::record(FlightRecorder::EventType::CONFIGURATION_CHANGED, 0);
+  });
+  software->outputStateChanged.connect(
+    [](const std::string& id, OutputState state) {
+      FlightRecorder::record(
+        FlightRecorder::EventType::OUTPUT_STATE_CHANGED, 0,
+        static_cast<uint64_t>(state), id);
+    });
+  software->currentSceneChanged.connect([](const std::string& id) {
+    FlightRecorder::record(
+      FlightRecorder::EventType::CURRENT_SCENE_CHANGED, 0, 0, id);
+  });
 }
 
 Server::~Server() {
+  // The io_context has stopped by now, so there is nothing to race with
+  mTCPServer.reset();
+  mWebSocketServer.reset();
 }
 
 void Server::startListening(const Config& config) {
-  stopListening();
+  asio::post(mStrand, [this, config]() { startListeningOnStrand(config); });
+}
+
+void Server::startListeningOnStrand(const Config& config) {
+  mTCPServer.reset();
+  mWebSocketServer.reset();
   if (config.tcpPort) {
     try {
-      mTCPServer = std::make_unique<TCPServer>(mContext, config);
+      mTCPServer = std::make_unique<TCPServer>(mContext, mStrand, config);
       mTCPServer->newConnection.connect(this, &Server::newConnection);
     } catch (const std::system_error& e) {
       if (e.code() == std::errc::address_in_use) {
-        Logger::debug(
+        Logger::warning(
           "Failed to start TCP server: port {} is already in use.",
           config.tcpPort
         );
       } else {
-        Logger::debug("Failed to start TCP server: {}", e.what());
+        Logger::warning("Failed to start TCP server: {}", e.what());
       }
     }
   }
@@ -53,22 +87,26 @@ void Server::startListening(const Config& config) {
       mWebSocketServer->newConnection.connect(this, &Server::newConnection);
     } catch (const websocketpp::exception& e) {
       if (e.code() == asio::error::address_in_use) {
-        Logger::debug(
+        Logger::warning(
           "Failed to start WebSocket server: port {} is already in use.",
           config.webSocketPort
         );
       } else {
-        Logger::debug("Failed to start WebSocket server: {}", e.what());
+        Logger::warning("Failed to start WebSocket server: {}", e.what());
       }
     }
   }
 }
 
 void Server::stopListening() {
-  mTCPServer.reset();
-  mWebSocketServer.reset();
+  asio::post(mStrand, [this]() {
+    mTCPServer.reset();
+    mWebSocketServer.reset();
+  });
 }
 
 void Server::newConnection(MessageInterface* connection) {
-  new ClientHandler(mContext, mSoftware, std::unique_ptr<MessageInterface>(connection));
+  new ClientHandler(
+    mSoftware, mPreviews, mConnections,
+    FaultInjector::wrap(std::unique_ptr<MessageInterface>(connection)));
 }
@@ -9,15 +9,14 @@
 #pragma once
 
 struct Config;
+class ConnectionRegistry;
 class MessageInterface;
+class PreviewManager;
 class StreamingSoftware;
 class TCPServer;
 class WebSocketServer;
 
-namespace asio {
-class io_context;
-}
-
+#include <asio.hpp>
 #include <memory>
 
 class Server final {
@@ -28,6 +27,7 @@ class Server final {
   );
   ~Server();
 
+  // Thread-safe; the listeners are (re)created on the server's strand.
   void startListening(const Config& config);
   void stopListening();
 
@@ -35,8 +35,13 @@ class Server final {
   void newConnection(MessageInterface* connection);
 
  private:
+  void startListeningOnStrand(const Config& config);
+
   std::shared_ptr<asio::io_context> mContext;
+  asio::strand<asio::io_context::executor_type> mStrand;
   std::shared_ptr<StreamingSoftware> mSoftware;
+  std::shared_ptr<PreviewManager> mPreviews;
+  std::shared_ptr<ConnectionRegistry> mConnections;
 
   std::unique_ptr<TCPServer> mTCPServer;
   std::unique_ptr<WebSocketServer> mWebSocketServer;
@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#include "SessionRecorder.h"
+
+#include "Logger.h"
+
+#include <fmt/format.h>
+
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+const char MAGIC[8] = {'S', 'R', 'S', 'E', 'S', 'S', 'I', 'O'};
+
+uint64_t nanoseconds_since_epoch() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+           std::chrono::system_clock::now().time_since_epoch())
+    .count();
+}
+}// namespace
+
+std::atomic<SessionRecorder*> SessionRecorder::sActive {nullptr};
+
+SessionRecorder::SessionRecorder(const std::filesystem::path& directory)
+  : mDirectory(directory) {
+  std::filesystem::create_directories(directory);
+  sActive.store(this, std::memory_order_release);
+  Logger::info("Recording sessions to {}", directory.string());
+}
+
+SessionRecorder::~SessionRecorder() {
+  auto self = this;
+  sActive.compare_exchange_strong(self, nullptr);
+}
+
+std::unique_ptr<SessionRecorder::Session> SessionRecorder::startSession(
+  uint64_t connectionId) {
+  auto recorder = sActive.load(std::memory_order_acquire);
+  if (!recorder) {
+    return nullptr;
+  }
+  const auto path = recorder->mDirectory
+    / fmt::format("session-{}-{}.bin",
+                  nanoseconds_since_epoch() / 1000000000, connectionId);
+  auto session = std::make_unique<Session>(path, connectionId);
+  if (!session->isOpen()) {
+    Logger::warning("Failed to create session recording {}", path.string());
+    return nullptr;
+  }
+  return session;
+}
+
+SessionRecorder::Session::Session(
+  const std::filesystem::path& path,
+  uint64_t connectionId)
+  : mFile(path, std::ios::binary | std::ios::trunc),
+    mStart(std::chrono::steady_clock::now()) {
+  FileHeader header {};
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = VERSION;
+  header.connectionId = connectionId;
+  header.systemEpoch = nanoseconds_since_epoch();
+  mFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+bool SessionRecorder::Session::isOpen() const {
+  return mFile.good();
+}
+
+void SessionRecorder::Session::record(
+  RecordType type,
+  std::string_view payload) {
+  const RecordHeader header {
+    .time = static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - mStart)
+        .count()),
+    .size = static_cast<uint32_t>(payload.size()),
+    .type = type,
+  };
+  mFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  mFile.write(payload.data(), payload.size());
+}
+
+SessionRecorder::Contents SessionRecorder::read(
+  const std::filesystem::path& path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    throw std::runtime_error("Failed to open " + path.string());
+  }
+  Contents contents {};
+  auto& header = contents.header;
+  if (
+    !file.read(reinterpret_cast<char*>(&header), sizeof(header))
+    || std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+    throw std::runtime_error(path.string() + " is not a session recording");
+  }
+  if (header.version != VERSION) {
+    throw std::runtime_error(
+      path.string() + " is from an incompatible version of the plugin");
+  }
+
+  Record record;
+  while (
+    file.read(reinterpret_cast<char*>(&record.header), sizeof(record.header))) {
+    record.payload.resize(record.header.size);
+    if (!file.read(record.payload.data(), record.payload.size())) {
+      break;
+    }
+    contents.records.push_back(record);
+  }
+  return contents;
+}
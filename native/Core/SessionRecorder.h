@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/** Opt-in recording of decrypted RPC traffic, for replaying real sessions
+ * with `streaming-remote-replay`.
+ *
+ * While a recorder exists, each authenticated connection writes its own file
+ * to the recorder's directory: a `FileHeader`, then a `RecordHeader` and
+ * payload for every request it receives, and for every response it sends.
+ * Requests are kept in full; responses only keep their `id`, for matching
+ * them to requests.
+ *
+ * Recordings contain everything that clients send, so this must never be
+ * enabled by default. Like `FlightRecorder`, recorders are owned by the host,
+ * and must be destroyed after the `Plugin`.
+ */
+class SessionRecorder final {
+ public:
+  enum class RecordType : uint16_t {
+    // The payload is the plaintext JSON-RPC request or notification
+    REQUEST = 1,
+    // The payload is the JSON `id` of the request
+    RESPONSE = 2,
+  };
+
+  static const uint32_t VERSION = 1;
+
+  struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t connectionId;
+    // When the session started, as nanoseconds since the Unix epoch
+    uint64_t systemEpoch;
+  };
+  static_assert(sizeof(FileHeader) == 32);
+
+  struct RecordHeader {
+    // Nanoseconds since the session started
+    uint64_t time;
+    uint32_t size;
+    RecordType type;
+    uint16_t reserved;
+  };
+  static_assert(sizeof(RecordHeader) == 16);
+
+  // A single connection; only used from its strand
+  class Session final {
+   public:
+    Session(const std::filesystem::path& path, uint64_t connectionId);
+    Session(const Session&) = delete;
+
+    bool isOpen() const;
+    void record(RecordType type, std::string_view payload);
+
+   private:
+    std::ofstream mFile;
+    std::chrono::steady_clock::time_point mStart;
+  };
+
+  // Throws `std::system_error` if the directory can not be created
+  explicit SessionRecorder(const std::filesystem::path& directory);
+  SessionRecorder(const SessionRecorder&) = delete;
+  ~SessionRecorder();
+
+  static bool isEnabled() {
+    return sActive.load(std::memory_order_relaxed) != nullptr;
+  }
+  // Returns null if no recorder exists, or the file can not be created
+  static std::unique_ptr<Session> startSession(uint64_t connectionId);
+
+  struct Record {
+    RecordHeader header;
+    std::string payload;
+  };
+  struct Contents {
+    FileHeader header;
+    std::vector<Record> records;
+  };
+  // Throws `std::runtime_error` if the file is not a session recording; a
+  // truncated final record is ignored
+  static Contents read(const std::filesystem::path& path);
+
+ private:
+  std::filesystem::path mDirectory;
+
+  static std::atomic<SessionRecorder*> sActive;
+};
@@ -8,8 +8,17 @@
 
 #pragma once
 
-#include <functional>
-#include <map>
+#include "AllocationTracker.h"
+#include "MpscQueue.h"
+#include "SmallFunction.h"
+
+#include <asio/post.hpp>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <type_traits>
 #include <vector>
 
 namespace {
@@ -37,25 +46,61 @@ class ScopedConnection {
     Connection mConnection;
 };
 
+// Signals may be connected to, disconnected from, and emitted from any
+// thread. Emission holds the signal's (recursive) lock, so other threads
+// block in `connect()`, disconnection, or emission until it is finished;
+// callbacks may connect or disconnect on the emitting thread, including
+// disconnecting themselves - removals are deferred until the outermost
+// emission finishes, and new callbacks are not invoked by in-progress
+// emissions.
+//
+// Callbacks connected with an executor are instead invoked on that executor,
+// in emission order; the emitter only pays for copying the arguments into a
+// lock-free queue. As long as the executor is a strand (or single-threaded),
+// disconnecting on that executor guarantees that no further calls are made.
 template <typename... Targs>
 class Signal {
  public:
-  typedef std::function<void(Targs...)> Callback;
+  typedef SmallFunction<void(Targs...)> Callback;
   Signal() {
   }
   Signal(const Signal<Targs...>& other) = delete;
 
   void operator()(Targs... args) {
     mEmitted = true;
-    for (auto& [id, callback] : mCallbacks) {
-      callback(args...);
+    std::scoped_lock lock(mMutex);
+    EmissionScope emission(this);
+    // Slots are not added or moved while emitting, so references and the
+    // count remain valid even if callbacks (dis)connect
+    const auto count = mSlots.size();
+    for (size_t i = 0; i < count; ++i) {
+      const auto& slot = mSlots[i];
+      if (slot.connected) {
+        slot.callback(args...);
+      }
     }
   }
 
-  Connection connect(const Callback& callback) {
-    const auto key = mNextKey++;
-    mCallbacks.emplace(key, callback);
-    return std::make_unique<ConnectionImpl>(this, key);
+  Connection connect(Callback callback) {
+    ALLOCATION_SCOPE(SIGNALS);
+    std::scoped_lock lock(mMutex);
+    uint32_t index;
+    if (mEmissionDepth > 0) {
+      // Appending might reallocate the slot that is currently being invoked
+      index = static_cast<uint32_t>(mSlots.size() + mPendingSlots.size());
+      mPendingSlots.push_back(Slot {});
+    } else if (!mFreeSlots.empty()) {
+      index = mFreeSlots.back();
+      mFreeSlots.pop_back();
+    } else {
+      index = static_cast<uint32_t>(mSlots.size());
+      mSlots.push_back(Slot {});
+    }
+    auto& slot = getSlot(index);
+    slot.callback = std::move(callback);
+    slot.connected = true;
+    return std::make_unique<ConnectionImpl>(
+      this, makeHandle(index, slot.generation));
   }
 
   template <typename TClass, typename TRet>
@@ -63,6 +108,24 @@ class Signal {
     return connect([=](Targs... args) { (instance->*method)(args...); });
   }
 
+  template <typename TExecutor>
+  Connection connect(const TExecutor& executor, Callback callback) {
+    ALLOCATION_SCOPE(SIGNALS);
+    auto slot
+      = std::make_shared<QueuedSlot<TExecutor>>(executor, std::move(callback));
+    return std::make_unique<QueuedConnectionImpl>(
+      connect([slot](Targs... args) { slot->enqueue(args...); }), slot);
+  }
+
+  template <typename TExecutor, typename TClass, typename TRet>
+  Connection connect(
+    const TExecutor& executor,
+    TClass* instance,
+    TRet (TClass::*method)(Targs...)) {
+    return connect(
+      executor, [=](Targs... args) { (instance->*method)(args...); });
+  }
+
   template <
     typename TClass,
     typename TRet,
@@ -78,9 +141,162 @@ class Signal {
   }
 
  private:
-  uint64_t mNextKey = 0;
-  std::map<uint64_t, Callback> mCallbacks;
-  bool mEmitted = false;
+  // Connections refer to slots by index and generation; the generation is
+  // bumped whenever a slot is released, so stale connections are ignored
+  // when their slot is reused.
+  struct Slot {
+    Callback callback;
+    uint32_t generation = 0;
+    bool connected = false;
+  };
+
+  class EmissionScope final {
+   public:
+    explicit EmissionScope(Signal* signal) : mSignal(signal) {
+      ++mSignal->mEmissionDepth;
+    }
+    ~EmissionScope() {
+      if (--mSignal->mEmissionDepth == 0) {
+        mSignal->finishEmission();
+      }
+    }
+
+   private:
+    Signal* mSignal;
+  };
+
+  std::recursive_mutex mMutex;
+  std::vector<Slot> mSlots;
+  std::vector<uint32_t> mFreeSlots;
+  // Changes requested while emitting
+  std::vector<Slot> mPendingSlots;
+  std::vector<uint32_t> mPendingReleases;
+  uint32_t mEmissionDepth = 0;
+  std::atomic<bool> mEmitted = false;
+
+  static uint64_t makeHandle(uint32_t index, uint32_t generation) {
+    return (static_cast<uint64_t>(generation) << 32) | index;
+  }
+
+  Slot& getSlot(uint32_t index) {
+    if (index < mSlots.size()) {
+      return mSlots[index];
+    }
+    return mPendingSlots[index - mSlots.size()];
+  }
+
+  void disconnect(uint64_t handle) {
+    std::scoped_lock lock(mMutex);
+    const auto index = static_cast<uint32_t>(handle);
+    const auto generation = static_cast<uint32_t>(handle >> 32);
+    if (index >= mSlots.size() + mPendingSlots.size()) {
+      return;
+    }
+    auto& slot = getSlot(index);
+    if (slot.generation != generation || !slot.connected) {
+      return;
+    }
+    slot.connected = false;
+    if (mEmissionDepth > 0) {
+      // The callback may be running right now
+      mPendingReleases.push_back(index);
+      return;
+    }
+    release(index);
+  }
+
+  void release(uint32_t index) {
+    auto& slot = mSlots[index];
+    slot.callback.reset();
+    ++slot.generation;
+    mFreeSlots.push_back(index);
+  }
+
+  void finishEmission() {
+    for (auto& slot: mPendingSlots) {
+      mSlots.push_back(std::move(slot));
+    }
+    mPendingSlots.clear();
+    for (const auto index: mPendingReleases) {
+      release(index);
+    }
+    mPendingReleases.clear();
+  }
+
+  class QueuedSlotBase {
+   public:
+    virtual ~QueuedSlotBase() = default;
+    void disconnect() {
+      mConnected = false;
+    }
+
+   protected:
+    std::atomic<bool> mConnected = true;
+  };
+
+  template <typename TExecutor>
+  class QueuedSlot final
+    : public QueuedSlotBase,
+      public std::enable_shared_from_this<QueuedSlot<TExecutor>> {
+   public:
+    QueuedSlot(const TExecutor& executor, Callback callback)
+      : mExecutor(executor), mCallback(std::move(callback)) {
+    }
+
+    void enqueue(Targs... args) {
+      ALLOCATION_SCOPE(SIGNALS);
+      mQueue.push(Arguments(args...));
+      // Whoever takes this from 0 to 1 is responsible for scheduling a drain;
+      // the drain keeps going until it has brought it back to 0.
+      if (mPending.fetch_add(1, std::memory_order_acq_rel) == 0) {
+        asio::post(mExecutor, [self = this->shared_from_this()]() {
+          self->drain();
+        });
+      }
+    }
+
+   private:
+    typedef std::tuple<std::decay_t<Targs>...> Arguments;
+
+    void drain() {
+      while (auto arguments = mQueue.pop()) {
+        if (this->mConnected) {
+          std::apply(mCallback, *arguments);
+        }
+        if (mPending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+          return;
+        }
+      }
+      // An emitter is part-way through `push()`; let other work run, then
+      // try again.
+      asio::post(mExecutor, [self = this->shared_from_this()]() {
+        self->drain();
+      });
+    }
+
+    TExecutor mExecutor;
+    Callback mCallback;
+    MpscQueue<Arguments> mQueue;
+    std::atomic<size_t> mPending = 0;
+  };
+
+  class QueuedConnectionImpl final : public ConnectionImplBase {
+   public:
+    QueuedConnectionImpl(
+      Connection connection,
+      std::shared_ptr<QueuedSlotBase> slot)
+      : mConnection(std::move(connection)), mSlot(slot) {
+    }
+
+    virtual void disconnect() override {
+      mConnection->disconnect();
+      mSlot->disconnect();
+    }
+
+   private:
+    Connection mConnection;
+    std::shared_ptr<QueuedSlotBase> mSlot;
+  };
 
   class ConnectionImpl final : public ConnectionImplBase {
     public:
@@ -90,7 +306,7 @@ class Signal {
       ): mSignal(signal), mKey(key) {}
 
       virtual void disconnect() override {
-        mSignal->mCallbacks.erase(mKey);
+        mSignal->disconnect(mKey);
       }
 
       ~ConnectionImpl() {
@@ -110,13 +326,23 @@ class ConnectionOwner {
   protected:
     template<typename... Targs>
     void connect(Signal<Targs...>& signal, typename Signal<Targs...>::Callback callback) {
-      mConnections.push_back(std::move(ScopedConnection(std::move(signal.connect(callback)))));
+      mConnections.push_back(ScopedConnection(signal.connect(std::move(callback))));
     }
 
     template <typename TClass, typename TRet, typename ...Targs>
     void connect(Signal<Targs...>& signal, TClass* instance, TRet (TClass::*method)(Targs...)) {
       connect(signal, [=](Targs... args) { (instance->*method)(args...); });
     }
+
+    template<typename TExecutor, typename... Targs>
+    void connect(Signal<Targs...>& signal, const TExecutor& executor, typename Signal<Targs...>::Callback callback) {
+      mConnections.push_back(ScopedConnection(signal.connect(executor, std::move(callback))));
+    }
+
+    template <typename TExecutor, typename TClass, typename TRet, typename ...Targs>
+    void connect(Signal<Targs...>& signal, const TExecutor& executor, TClass* instance, TRet (TClass::*method)(Targs...)) {
+      connect(signal, executor, [=](Targs... args) { (instance->*method)(args...); });
+    }
   private:
     std::vector<ScopedConnection> mConnections;
 };
@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+template <typename TSignature, size_t Capacity = 40>
+class SmallFunction;
+
+/** Move-only `std::function` alternative with a larger inline buffer.
+ *
+ * Callables that fit in `Capacity` bytes - such as lambdas capturing `this`
+ * and a member function pointer, or a `shared_ptr` - are stored inline
+ * without allocating; larger ones fall back to the heap.
+ */
+template <typename TRet, typename... Targs, size_t Capacity>
+class SmallFunction<TRet(Targs...), Capacity> final {
+ public:
+  SmallFunction() = default;
+
+  template <
+    typename TCallable,
+    typename = std::enable_if_t<
+      !std::is_same_v<std::decay_t<TCallable>, SmallFunction>
+      && std::is_invocable_r_v<TRet, std::decay_t<TCallable>&, Targs...>>>
+  SmallFunction(TCallable&& callable) {
+    typedef std::decay_t<TCallable> T;
+    if constexpr (IsInline<T>) {
+      new (mStorage) T(std::forward<TCallable>(callable));
+      mOps = &InlineOps<T>::OPS;
+    } else {
+      new (mStorage) T*(new T(std::forward<TCallable>(callable)));
+      mOps = &HeapOps<T>::OPS;
+    }
+  }
+
+  SmallFunction(SmallFunction&& other) noexcept {
+    *this = std::move(other);
+  }
+
+  SmallFunction& operator=(SmallFunction&& other) noexcept {
+    if (this == &other) {
+      return *this;
+    }
+    reset();
+    if (other.mOps) {
+      other.mOps->move(mStorage, other.mStorage);
+      mOps = other.mOps;
+      other.mOps = nullptr;
+    }
+    return *this;
+  }
+
+  SmallFunction(const SmallFunction&) = delete;
+  SmallFunction& operator=(const SmallFunction&) = delete;
+
+  ~SmallFunction() {
+    reset();
+  }
+
+  void reset() {
+    if (mOps) {
+      mOps->destroy(mStorage);
+      mOps = nullptr;
+    }
+  }
+
+  explicit operator bool() const {
+    return mOps != nullptr;
+  }
+
+  TRet operator()(Targs... args) const {
+    return mOps->invoke(
+      const_cast<std::byte*>(mStorage), std::forward<Targs>(args)...);
+  }
+
+  // True if a callable of this type is stored without allocating
+  template <typename T>
+  static constexpr bool IsInline = sizeof(T) <= Capacity
+    && alignof(T) <= alignof(std::max_align_t)
+    && std::is_nothrow_move_constructible_v<T>;
+
+ private:
+  struct Ops {
+    TRet (*invoke)(void* storage, Targs&&... args);
+    void (*move)(void* to, void* from);
+    void (*destroy)(void* storage);
+  };
+
+  template <typename T>
+  struct InlineOps {
+    static TRet invoke(void* storage, Targs&&... args) {
+      return (*static_cast<T*>(storage))(std::forward<Targs>(args)...);
+    }
+    static void move(void* to, void* from) {
+      new (to) T(std::move(*static_cast<T*>(from)));
+      static_cast<T*>(from)->~T();
+    }
+    static void destroy(void* storage) {
+      static_cast<T*>(storage)->~T();
+    }
+    static constexpr Ops OPS {&invoke, &move, &destroy};
+  };
+
+  template <typename T>
+  struct HeapOps {
+    static TRet invoke(void* storage, Targs&&... args) {
+      return (**static_cast<T**>(storage))(std::forward<Targs>(args)...);
+    }
+    static void move(void* to, void* from) {
+      new (to) T*(*static_cast<T**>(from));
+    }
+    static void destroy(void* storage) {
+      delete *static_cast<T**>(storage);
+    }
+    static constexpr Ops OPS {&invoke, &move, &destroy};
+  };
+
+  alignas(std::max_align_t) std::byte mStorage[Capacity];
+  const Ops* mOps = nullptr;
+};
@@ -8,6 +8,8 @@
 
 #include "StreamingSoftware.h"
 
+#include "Png.h"
+
 StreamingSoftware::StreamingSoftware(
   std::shared_ptr<asio::io_context> context
 ): mContext(context) {
@@ -34,6 +36,31 @@ asio::awaitable<std::string> StreamingSoftware::getSceneThumbnailAsBase64Png(con
   co_return std::string();
 }
 
+asio::awaitable<Image> StreamingSoftware::captureScene(
+  const std::string& id,
+  uint32_t maxDimension) {
+  co_return Image();
+}
+
+asio::awaitable<void> StreamingSoftware::captureScenes(
+  const std::vector<std::string>& ids,
+  uint32_t maxDimension,
+  SceneCapturedCallback callback) {
+  for (const auto& id : ids) {
+    callback(id, co_await captureScene(id, maxDimension));
+  }
+}
+
+std::string StreamingSoftware::encodeImage(
+  const Image& image,
+  const std::string& contentType,
+  int quality) {
+  if (contentType == "image/png") {
+    return encode_uncompressed_png(image);
+  }
+  return std::string();
+}
+
 asio::io_context& StreamingSoftware::getIoContext() const noexcept {
   return *mContext;
 }
@@ -9,12 +9,14 @@
 #pragma once
 
 #include "Config.h"
+#include "Image.h"
 #include "Output.h"
 #include "Scene.h"
 #include "Signal.h"
 
 #include <asio/awaitable.hpp>
 
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
@@ -36,6 +38,28 @@ class StreamingSoftware {
   virtual asio::awaitable<bool> activateScene(const std::string& id);
   virtual asio::awaitable<std::string> getSceneThumbnailAsBase64Png(const std::string& id);
 
+  // Returns an empty image if unsupported. If `maxDimension` is non-zero,
+  // implementations should scale the image to fit within it.
+  virtual asio::awaitable<Image> captureScene(
+    const std::string& id,
+    uint32_t maxDimension);
+  typedef std::function<void(const std::string& id, Image image)>
+    SceneCapturedCallback;
+  // Captures several scenes at once, invoking `callback` for each scene as
+  // soon as it is available, in any order; images are empty on failure.
+  // Implementations should share setup and frame waits between scenes - the
+  // default just calls `captureScene()` for each.
+  virtual asio::awaitable<void> captureScenes(
+    const std::vector<std::string>& ids,
+    uint32_t maxDimension,
+    SceneCapturedCallback callback);
+  // Returns an empty string if the content type is unsupported. `quality` is
+  // 0-100, or -1 for the default; it is ignored for lossless formats.
+  virtual std::string encodeImage(
+    const Image& image,
+    const std::string& contentType,
+    int quality);
+
   Signal<const Config&> initialized;
   Signal<const Config&> configurationChanged;
   Signal<const std::string&, OutputState> outputStateChanged;
@@ -8,58 +8,158 @@
 
 #include "TCPConnection.h"
 
+#include "AllocationTracker.h"
+#include "Logger.h"
+
 #include <fmt/format.h>
 #include <asio.hpp>
-#include <istream>
+#include <charconv>
+#include <optional>
+#include <string_view>
+
+namespace {
+// Larger messages are treated as a protocol error rather than buffered
+const size_t MAX_MESSAGE_SIZE = 64 * 1024 * 1024;
+
+std::optional<size_t> parse_content_length(std::string_view header) {
+  const std::string_view prefix("Content-Length: ");
+  const std::string_view suffix("\r\n\r\n");
+  if (!(header.starts_with(prefix) && header.ends_with(suffix))) {
+    return {};
+  }
+  const auto digits = header.substr(
+    prefix.size(), header.size() - prefix.size() - suffix.size());
+  size_t length = 0;
+  const auto [end, ec]
+    = std::from_chars(digits.data(), digits.data() + digits.size(), length);
+  if (ec != std::errc() || end != digits.data() + digits.size()) {
+    return {};
+  }
+  return length;
+}
+}// namespace
 
-TCPConnection::TCPConnection(std::shared_ptr<asio::io_context> ctx)
-  : MessageInterface(), mSocket(*ctx) {
+TCPConnection::TCPConnection(const Strand& strand)
+  : MessageInterface(strand), mSocket(strand) {
 }
 
 void TCPConnection::startWaitingForMessage() {
-  mSocket.async_wait(
-    asio::socket_base::wait_type::wait_read,
-    std::bind(&TCPConnection::readyRead, this)
-  );
-  mSocket.async_wait(
-    asio::socket_base::wait_type::wait_error,
-    [this](asio::error_code) { emit this->disconnected(); }
-  );
+  std::weak_ptr<bool> alive(mAlive);
+  auto buffer = mReadBuffer;
+  asio::async_read_until(
+    mSocket, *buffer, "\r\n\r\n",
+    [this, alive, buffer](const asio::error_code& ec, size_t headerSize) {
+      ALLOCATION_SCOPE(TRANSPORT);
+      if (alive.expired()) {
+        return;
+      }
+      if (ec) {
+        connectionLost();
+        return;
+      }
+      const auto data = buffer->data();
+      const std::string header(
+        asio::buffers_begin(data), asio::buffers_begin(data) + headerSize);
+      buffer->consume(headerSize);
+      addBytesReceived(headerSize);
+      const auto length = parse_content_length(header);
+      if (!(length && *length <= MAX_MESSAGE_SIZE)) {
+        Logger::debug("Invalid TCP message header, disconnecting");
+        disconnect();
+        connectionLost();
+        return;
+      }
+      readBody(*length);
+    });
 }
 
-void TCPConnection::readyRead() {
-  asio::streambuf buf;
-  std::istream bufreader(&buf);
-  auto& s = this->mSocket;
+void TCPConnection::readBody(size_t length) {
+  // async_read_until() may have buffered some or all of the body already
+  const auto buffered = mReadBuffer->size();
+  std::weak_ptr<bool> alive(mAlive);
+  auto buffer = mReadBuffer;
+  asio::async_read(
+    mSocket, *buffer,
+    asio::transfer_exactly(length > buffered ? length - buffered : 0),
+    [this, alive, buffer, length](const asio::error_code& ec, size_t) {
+      ALLOCATION_SCOPE(TRANSPORT);
+      if (alive.expired()) {
+        return;
+      }
+      if (ec) {
+        connectionLost();
+        return;
+      }
+      const auto data = buffer->data();
+      const std::string message(
+        asio::buffers_begin(data), asio::buffers_begin(data) + length);
+      buffer->consume(length);
+      addBytesReceived(length);
+      emit messageReceived(message);
+      startWaitingForMessage();
+    });
+}
 
-  asio::read_until(s, buf, "\r\n");
-  std::string line;
-  bufreader >> line;
-  if (!line.starts_with("Content-Length: ")) {
-    disconnect();
+void TCPConnection::connectionLost() {
+  if (mDisconnected) {
     return;
   }
-  asio::read_until(s, buf, "\r\n");
-  std::string next;
-  bufreader >> next;
-  if (next != "\r\n") {
-    disconnect();
-    return;
+  mDisconnected = true;
+  emit disconnected();
+}
+
+void TCPConnection::sendMessage(const std::string& message) {
+  ALLOCATION_SCOPE(TRANSPORT);
+  auto buf = std::make_shared<const std::string>(
+    fmt::format("Content-Length: {}\r\n\r\n{}", message.size(), message));
+  mPendingSendBytes += buf->size();
+  mSendQueue.push_back(std::move(buf));
+  if (mSendQueue.size() == 1) {
+    writeNextMessage();
   }
+}
 
-  auto message_len
-    = std::stoi(line.substr(16 /* "Content-Length: */, line.length() - 18));
-  asio::read(s, buf, asio::transfer_exactly(message_len));
-  std::string message;
-  bufreader >> message;
-  emit messageReceived(message);
-  startWaitingForMessage();
+void TCPConnection::writeNextMessage() {
+  auto buf = mSendQueue.front();
+  std::weak_ptr<bool> alive(mAlive);
+  asio::async_write(
+    mSocket, asio::buffer(*buf),
+    [this, alive, buf](const asio::error_code& ec, size_t written) {
+      ALLOCATION_SCOPE(TRANSPORT);
+      if (alive.expired()) {
+        return;
+      }
+      addBytesSent(written);
+      mPendingSendBytes -= buf->size();
+      mSendQueue.pop_front();
+      if (ec) {
+        disconnect();
+        return;
+      }
+      if (!mSendQueue.empty()) {
+        writeNextMessage();
+      }
+    });
 }
 
-void TCPConnection::sendMessage(const std::string& message) {
-  std::string buf
-    = fmt::format("Content-Length: {}\r\n\r\n{}", message.size(), message);
-  asio::write(mSocket, asio::buffer(buf), asio::transfer_exactly(buf.size()));
+size_t TCPConnection::getPendingSendBytes() const {
+  return mPendingSendBytes;
+}
+
+const char* TCPConnection::getTransportName() const {
+  return "tcp";
+}
+
+std::string TCPConnection::getPeerAddress() const {
+  asio::error_code ec;
+  const auto endpoint = mSocket.remote_endpoint(ec);
+  if (ec) {
+    return {};
+  }
+  const auto address = endpoint.address();
+  return fmt::format(
+    address.is_v6() ? "[{}]:{}" : "{}:{}", address.to_string(),
+    endpoint.port());
 }
 
 void TCPConnection::disconnect() {
@@ -12,17 +12,36 @@
 
 #include <asio.hpp>
 
+#include <deque>
+#include <memory>
+
 class TCPConnection : public MessageInterface {
  public:
-  TCPConnection(std::shared_ptr<asio::io_context> ctx);
+  explicit TCPConnection(const Strand& strand);
 
+  // Starts the read loop; call once the signals have been connected.
   void startWaitingForMessage();
 
   void sendMessage(const std::string& message) override;
   void disconnect() override;
+  size_t getPendingSendBytes() const override;
+  const char* getTransportName() const override;
+  std::string getPeerAddress() const override;
   asio::ip::tcp::socket& socket();
 
  private:
-  void readyRead();
+  void readBody(size_t length);
+  void connectionLost();
+  void writeNextMessage();
   asio::ip::tcp::socket mSocket;
+  // Shared with the read handlers: destroying the socket only queues their
+  // completion, and the read operations write to the buffer before the
+  // handlers can check `mAlive`
+  std::shared_ptr<asio::streambuf> mReadBuffer
+    = std::make_shared<asio::streambuf>();
+  bool mDisconnected = false;
+  std::deque<std::shared_ptr<const std::string>> mSendQueue;
+  size_t mPendingSendBytes = 0;
+  // Expires when we're destroyed; checked by outstanding handlers
+  std::shared_ptr<bool> mAlive = std::make_shared<bool>(true);
 };
@@ -14,10 +14,13 @@
 #include "Logger.h"
 #include "TCPConnection.h"
 
-TCPServer::TCPServer(std::shared_ptr<asio::io_context> context, const Config& config)
+TCPServer::TCPServer(
+  std::shared_ptr<asio::io_context> context,
+  const Strand& strand,
+  const Config& config)
   : mContext(context),
     mAcceptor(asio::ip::tcp::acceptor(
-      *context,
+      strand,
       asio::ip::tcp::endpoint(asio::ip::tcp::v6(), config.tcpPort),
       true)) {
   startAccept();
@@ -27,18 +30,29 @@ TCPServer::~TCPServer() {
 }
 
 void TCPServer::startAccept() {
-  auto conn = new TCPConnection(mContext);
+  // Each connection gets its own strand, so that connections can be handled
+  // concurrently by the io_context's thread pool
+  auto conn = new TCPConnection(asio::make_strand(*mContext));
   mAcceptor.async_accept(conn->socket(), [=](const asio::error_code& error) {
     if (error == asio::error::operation_aborted) {
       // accept was cancelled, e.g. when OBS is shutting down, or the
       // configuration was changed
+      delete conn;
       return;
     }
     if (error) {
-      Logger::debug("Unexpected ASIO error in async_accept: {}", error.message());
+      Logger::warning(
+        "Unexpected ASIO error in async_accept: {}", error.message());
+      delete conn;
       return;
     }
+    // Every message is written in one go, so Nagle's algorithm only adds
+    // latency: a response sent right after a notification would otherwise
+    // wait for the client to acknowledge the notification
+    asio::error_code ec;
+    conn->socket().set_option(asio::ip::tcp::no_delay(true), ec);
     this->newConnection(conn);
+    asio::post(conn->getStrand(), [conn]() { conn->startWaitingForMessage(); });
     this->startAccept();
   });
 }
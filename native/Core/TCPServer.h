@@ -17,7 +17,14 @@ class MessageInterface;
 
 class TCPServer final {
  public:
-  TCPServer(std::shared_ptr<asio::io_context> context, const Config& config);
+  typedef asio::strand<asio::io_context::executor_type> Strand;
+
+  // `newConnection` is emitted on `strand`, which must also be used to
+  // destroy the server.
+  TCPServer(
+    std::shared_ptr<asio::io_context> context,
+    const Strand& strand,
+    const Config& config);
   ~TCPServer();
 
   Signal<MessageInterface*> newConnection;
@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#include "ThroughputEstimator.h"
+
+#include <algorithm>
+
+void ThroughputEstimator::messageQueued(
+  size_t bytes,
+  size_t pendingBytes,
+  Clock::time_point now) {
+  if (pendingBytes == 0) {
+    mBusySince = now;
+  }
+  mQueuedSinceSample += bytes;
+}
+
+void ThroughputEstimator::sample(size_t pendingBytes, Clock::time_point now) {
+  if (mLastSample == Clock::time_point {}) {
+    mLastSample = now;
+    mLastPendingBytes = pendingBytes;
+    mQueuedSinceSample = 0;
+    return;
+  }
+  const auto elapsed = now - mLastSample;
+  if (elapsed < MIN_INTERVAL) {
+    return;
+  }
+
+  const auto available = mLastPendingBytes + mQueuedSinceSample;
+  const auto drained = available > pendingBytes ? available - pendingBytes : 0;
+  // Only count time when there was something to send
+  const auto busySince = mLastPendingBytes > 0
+    ? mLastSample
+    : std::max(mLastSample, mBusySince);
+  const auto seconds = std::chrono::duration<double>(
+    std::max(now - busySince, MIN_INTERVAL)).count();
+  const auto rate = drained / seconds;
+
+  if (available == 0) {
+    // Idle: nothing to learn
+  } else if (pendingBytes > 0) {
+    // Still busy: this is the link speed
+    mBytesPerSecond = mBytesPerSecond == 0
+      ? rate
+      : (SMOOTHING * rate) + ((1 - SMOOTHING) * mBytesPerSecond);
+  } else {
+    // Kept up with everything we sent, so the link is at least this fast,
+    // and possibly faster: probe upwards
+    const auto interval = std::chrono::duration<double>(elapsed).count();
+    const auto probed
+      = mBytesPerSecond * (1 + (PROBE_RATE * std::min(interval, 1.0)));
+    // Don't wander off indefinitely on an idle connection
+    const auto limit = std::max(mBytesPerSecond, PROBE_LIMIT * rate);
+    mBytesPerSecond = std::max(rate, std::min(probed, limit));
+  }
+
+  mLastSample = now;
+  mLastPendingBytes = pendingBytes;
+  mQueuedSinceSample = 0;
+}
+
+double ThroughputEstimator::getBytesPerSecond() const {
+  return mBytesPerSecond;
+}
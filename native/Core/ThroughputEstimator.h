@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include "Clock.h"
+
+#include <chrono>
+#include <cstddef>
+
+/** Estimates how fast a connection can send, from how fast its queue drains.
+ *
+ * Time spent with a non-empty queue measures the link itself; if the queue
+ * empties, the link is at least as fast as that, and the estimate is slowly
+ * probed upwards until the queue stops emptying. Times come from `Clock`, so
+ * adaptive quality follows simulated time.
+ */
+class ThroughputEstimator final {
+ public:
+  // `pendingBytes` is the size of the queue before adding this message
+  void messageQueued(
+    size_t bytes,
+    size_t pendingBytes,
+    Clock::time_point now = Clock::now());
+  void sample(size_t pendingBytes, Clock::time_point now = Clock::now());
+
+  // 0 if nothing has been measured yet
+  double getBytesPerSecond() const;
+
+ private:
+  // Weight of each new measurement
+  static constexpr double SMOOTHING = 0.25;
+  // Proportional increase per second while the link keeps up
+  static constexpr double PROBE_RATE = 0.1;
+  // Relative to what was last seen to drain
+  static constexpr double PROBE_LIMIT = 2.0;
+  // Shorter intervals are dominated by timer and scheduling noise
+  static constexpr Clock::duration MIN_INTERVAL = std::chrono::milliseconds(20);
+
+  Clock::time_point mLastSample {};
+  // When the queue last went from empty to non-empty
+  Clock::time_point mBusySince {};
+  size_t mLastPendingBytes = 0;
+  size_t mQueuedSinceSample = 0;
+  double mBytesPerSecond = 0;
+};
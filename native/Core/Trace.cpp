@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#include "Trace.h"
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using json = nlohmann::json;
+
+namespace {
+
+// Per thread; 64k spans is a few seconds of a busy connection
+const size_t BUFFER_CAPACITY = 64 * 1024;
+
+// Chrome trace 'process' IDs, used to group tracks
+const int CONNECTIONS_PID = 1;
+const int THREADS_PID = 2;
+
+struct Event {
+  const char* name;
+  Trace::Context context;
+  uint64_t start;
+  uint64_t end;
+  std::string detail;
+};
+
+// The mutex is only contended while collecting or clearing
+struct ThreadBuffer {
+  std::mutex mutex;
+  std::vector<Event> events;
+  // Index of the next event to overwrite once `events` is full
+  size_t next = 0;
+  uint32_t threadIndex = 0;
+};
+
+std::mutex sBuffersMutex;
+// Kept after their thread exits so that its spans can still be collected
+std::vector<std::shared_ptr<ThreadBuffer>> sBuffers;
+
+ThreadBuffer& get_thread_buffer() {
+  thread_local auto buffer = [] {
+    auto buffer = std::make_shared<ThreadBuffer>();
+    std::scoped_lock lock(sBuffersMutex);
+    buffer->threadIndex = static_cast<uint32_t>(sBuffers.size() + 1);
+    sBuffers.push_back(buffer);
+    return buffer;
+  }();
+  return *buffer;
+}
+
+}// namespace
+
+std::atomic<bool> Trace::sEnabled = false;
+
+void Trace::setEnabled(bool enabled) {
+  if (enabled && !isEnabled()) {
+    clear();
+  }
+  sEnabled = enabled;
+}
+
+uint64_t Trace::now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+           std::chrono::steady_clock::now().time_since_epoch())
+    .count();
+}
+
+void Trace::record(
+  const char* name,
+  const Context& context,
+  uint64_t start,
+  uint64_t end,
+  std::string detail) {
+  auto& buffer = get_thread_buffer();
+  std::scoped_lock lock(buffer.mutex);
+  Event event {name, context, start, end, std::move(detail)};
+  if (buffer.events.size() < BUFFER_CAPACITY) {
+    buffer.events.push_back(std::move(event));
+    return;
+  }
+  buffer.events[buffer.next] = std::move(event);
+  buffer.next = (buffer.next + 1) % BUFFER_CAPACITY;
+}
+
+void Trace::clear() {
+  std::scoped_lock lock(sBuffersMutex);
+  for (const auto& buffer : sBuffers) {
+    std::scoped_lock bufferLock(buffer->mutex);
+    buffer->events.clear();
+    buffer->next = 0;
+  }
+}
+
+json Trace::toJson() {
+  json events = json::array();
+  events.push_back(
+    {{"name", "process_name"},
+     {"ph", "M"},
+     {"pid", CONNECTIONS_PID},
+     {"args", {{"name", "Connections"}}}});
+  events.push_back(
+    {{"name", "process_name"},
+     {"ph", "M"},
+     {"pid", THREADS_PID},
+     {"args", {{"name", "Threads"}}}});
+
+  std::scoped_lock lock(sBuffersMutex);
+  for (const auto& buffer : sBuffers) {
+    std::scoped_lock bufferLock(buffer->mutex);
+    for (const auto& event : buffer->events) {
+      json args {{"thread", buffer->threadIndex}};
+      if (event.context.requestId) {
+        args["requestId"] = event.context.requestId;
+      }
+      if (!event.detail.empty()) {
+        args["detail"] = event.detail;
+      }
+      const bool perConnection = event.context.connectionId != 0;
+      // Chrome wants microseconds; keep the nanoseconds as fractions
+      events.push_back({
+        {"name", event.name},
+        {"cat", perConnection ? "connection" : "thread"},
+        {"ph", "X"},
+        {"ts", event.start / 1000.0},
+        {"dur", (event.end - event.start) / 1000.0},
+        {"pid", perConnection ? CONNECTIONS_PID : THREADS_PID},
+        {"tid",
+         perConnection ? event.context.connectionId : buffer->threadIndex},
+        {"args", args},
+      });
+    }
+  }
+  return {{"traceEvents", events}, {"displayTimeUnit", "ns"}};
+}
@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+/** Timed spans, exported in Chrome's `trace_event` format.
+ *
+ * While tracing is disabled, a `TraceSpan` costs a relaxed atomic load.
+ * While enabled, completed spans are appended to a fixed-size buffer owned by
+ * the calling thread, overwriting the oldest; `toJson()` collects every
+ * thread's buffer.
+ *
+ * Spans with a connection ID are shown as a track per connection, so that
+ * spans which start on one thread and end on another - for example, across a
+ * `co_await` - still nest correctly; others are shown per thread.
+ */
+class Trace final {
+ public:
+  struct Context {
+    uint64_t connectionId = 0;
+    // Zero for work that isn't part of a request, such as notifications
+    uint64_t requestId = 0;
+  };
+
+  static bool isEnabled() {
+    return sEnabled.load(std::memory_order_relaxed);
+  }
+  // Enabling discards previously-recorded spans
+  static void setEnabled(bool enabled);
+
+  // Nanoseconds, from a monotonic clock
+  static uint64_t now();
+  static void record(
+    const char* name,
+    const Context& context,
+    uint64_t start,
+    uint64_t end,
+    std::string detail = {});
+
+  // `{ "traceEvents": [...] }`, loadable by chrome://tracing or Perfetto
+  static nlohmann::json toJson();
+  static void clear();
+
+ private:
+  static std::atomic<bool> sEnabled;
+};
+
+class TraceSpan final {
+ public:
+  TraceSpan() = delete;
+  // `name` must be a string literal, or otherwise outlive the trace
+  explicit TraceSpan(const char* name, const Trace::Context& context = {})
+    : mName(name), mContext(context) {
+    if (Trace::isEnabled()) {
+      mStart = Trace::now();
+    }
+  }
+  // For spans that started before they could be constructed
+  TraceSpan(const char* name, const Trace::Context& context, uint64_t start)
+    : mName(name), mContext(context), mStart(start) {
+  }
+  TraceSpan(const TraceSpan&) = delete;
+
+  ~TraceSpan() {
+    end();
+  }
+
+  bool isRecording() const {
+    return mStart != 0;
+  }
+
+  // Shown in the trace viewer's 'args' for this span; ignored if not
+  // recording.
+  void setDetail(std::string detail) {
+    if (isRecording()) {
+      mDetail = std::move(detail);
+    }
+  }
+
+  void end() {
+    if (mStart) {
+      Trace::record(
+        mName, mContext, mStart, Trace::now(), std::move(mDetail));
+      mStart = 0;
+    }
+  }
+
+ private:
+  const char* mName;
+  Trace::Context mContext;
+  uint64_t mStart = 0;
+  std::string mDetail;
+};
+
+#define TRACE_FUNCTION() TraceSpan _function_trace_span(__FUNCTION__)
@@ -8,6 +8,7 @@
 
 #include "WebSocketConnection.h"
 
+#include "Core/AllocationTracker.h"
 #include "Core/Logger.h"
 
 #include <fmt/format.h>
@@ -15,26 +16,38 @@
 #include <istream>
 
 WebSocketConnection::WebSocketConnection(
+  const Strand& strand,
   WebSocketServerImpl* server,
   websocketpp::connection_hdl hdl)
-  : MessageInterface(), mServer(server), mConnection(hdl) {
+  : MessageInterface(strand), mServer(server), mConnection(hdl) {
   LOG_FUNCTION();
   auto conn = server->get_con_from_hdl(hdl);
+  std::weak_ptr<bool> alive(mAlive);
   conn->set_message_handler(
-    [this](
+    [this, strand, alive](
       websocketpp::connection_hdl, WebSocketServerImpl::message_ptr message) {
+      ALLOCATION_SCOPE(TRANSPORT);
       if (!message) {
         return;
       }
       if (message->get_opcode() != websocketpp::frame::opcode::binary) {
         return;
       }
-      const auto data = message->get_payload();
-      emit messageReceived(data);
+      asio::post(strand, [this, alive, data = message->get_payload()]() {
+        ALLOCATION_SCOPE(TRANSPORT);
+        if (!alive.expired()) {
+          addBytesReceived(data.size());
+          emit messageReceived(data);
+        }
+      });
     });
-  conn->set_close_handler([this](websocketpp::connection_hdl) {
+  conn->set_close_handler([this, strand, alive](websocketpp::connection_hdl) {
     Logger::debug("Websocket connection closed.");
-    emit this->disconnected();
+    asio::post(strand, [this, alive]() {
+      if (!alive.expired()) {
+        emit this->disconnected();
+      }
+    });
   });
 }
 
@@ -43,21 +56,50 @@ WebSocketConnection::~WebSocketConnection() {
   asio::error_code ec;
   auto conn = mServer->get_con_from_hdl(mConnection, ec);
   if (!ec) {
-    Logger::debug("WebSocketConnection destroyed with live connection!");
+    Logger::warning("WebSocketConnection destroyed with live connection!");
   }
 }
 
 void WebSocketConnection::disconnect() {
   asio::error_code ec;
-  auto conn = mServer->get_con_from_hdl(mConnection);
+  auto conn = mServer->get_con_from_hdl(mConnection, ec);
+  if (ec) {
+    // Already closed, but `disconnected` hasn't been handled yet
+    return;
+  }
   conn->close(websocketpp::close::status::normal, std::string(), ec);
 }
 
 void WebSocketConnection::sendMessage(const std::string& message) {
+  ALLOCATION_SCOPE(TRANSPORT);
   websocketpp::lib::error_code error;
   mServer->send(
     mConnection, message, websocketpp::frame::opcode::binary, error);
   if (error) {
     disconnect();
+    return;
+  }
+  addBytesSent(message.size());
+}
+
+size_t WebSocketConnection::getPendingSendBytes() const {
+  asio::error_code ec;
+  auto conn = mServer->get_con_from_hdl(mConnection, ec);
+  if (ec) {
+    return 0;
+  }
+  return conn->get_buffered_amount();
+}
+
+const char* WebSocketConnection::getTransportName() const {
+  return "websocket";
+}
+
+std::string WebSocketConnection::getPeerAddress() const {
+  asio::error_code ec;
+  auto conn = mServer->get_con_from_hdl(mConnection, ec);
+  if (ec) {
+    return {};
   }
+  return conn->get_remote_endpoint();
 }
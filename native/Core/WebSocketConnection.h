@@ -14,14 +14,21 @@
 class WebSocketConnection : public MessageInterface {
  public:
   WebSocketConnection(
+    const Strand& strand,
     WebSocketServerImpl* server,
     websocketpp::connection_hdl connection);
   ~WebSocketConnection();
 
   void sendMessage(const std::string& message) override;
   void disconnect() override;
+  size_t getPendingSendBytes() const override;
+  const char* getTransportName() const override;
+  std::string getPeerAddress() const override;
 
  private:
   WebSocketServerImpl* mServer;
   websocketpp::connection_hdl mConnection;
+  // websocketpp invokes our handlers on its own strand; they are re-posted
+  // to ours, and dropped if we have been destroyed by the time they run.
+  std::shared_ptr<bool> mAlive = std::make_shared<bool>(true);
 };
@@ -11,18 +11,31 @@
 #include <memory>
 
 #include "Config.h"
+#include "Metrics.h"
 #include "WebSocketConnection.h"
 
 WebSocketServer::WebSocketServer(
   std::shared_ptr<asio::io_context> context,
   const Config& config)
-  : mServer() {
+  : mContext(context), mServer() {
   mServer.clear_access_channels(websocketpp::log::alevel::all);
   mServer.clear_error_channels(websocketpp::log::elevel::all);
   mServer.init_asio(context.get());
   mServer.set_reuse_addr(true);
   mServer.set_open_handler([this](websocketpp::connection_hdl conn) {
-    emit newConnection(new WebSocketConnection(&mServer, conn));
+    emit newConnection(
+      new WebSocketConnection(asio::make_strand(*mContext), &mServer, conn));
+  });
+  // Plain HTTP requests to the WebSocket port
+  mServer.set_http_handler([this](websocketpp::connection_hdl hdl) {
+    auto conn = mServer.get_con_from_hdl(hdl);
+    if (conn->get_resource() != "/metrics") {
+      conn->set_status(websocketpp::http::status_code::not_found);
+      return;
+    }
+    conn->set_status(websocketpp::http::status_code::ok);
+    conn->append_header("Content-Type", "text/plain; version=0.0.4");
+    conn->set_body(Metrics::toPrometheusText());
   });
   mServer.listen(config.webSocketPort);
   mServer.start_accept();
@@ -22,5 +22,6 @@ class WebSocketServer final {
   Signal<MessageInterface*> newConnection;
 
  private:
+  std::shared_ptr<asio::io_context> mContext;
   WebSocketServerImpl mServer;
 };
@@ -0,0 +1,15 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#pragma once
+
+// `SkipWithError()` doesn't change google-benchmark's exit status, so the
+// allocation budget benchmarks also report overruns here, and `main()` exits
+// with a failure status if there were any.
+void allocation_budget_exceeded();
+bool was_allocation_budget_exceeded();
@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#include "AllocationBudget.h"
+#include "Core/AllocationTracker.h"
+
+#include <atomic>
+
+namespace {
+std::atomic<bool> sBudgetExceeded = false;
+}// namespace
+
+void allocation_budget_exceeded() {
+  sBudgetExceeded = true;
+}
+
+bool was_allocation_budget_exceeded() {
+  return sBudgetExceeded;
+}
+
+// Only meaningful when allocations are counted; configure with
+// `-DALLOCATION_TRACKING=ON`
+#ifdef STREAMING_REMOTE_ALLOCATION_TRACKING
+
+#include "BenchmarkClient.h"
+#include "BenchmarkServer.h"
+#include "dummy/Dummy.h"
+
+#include <benchmark/benchmark.h>
+#include <fmt/format.h>
+
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const char* const PASSWORD = BenchmarkServer::PASSWORD;
+
+// Server-side allocations per operation; exceeding these fails the benchmark
+// and the benchmark process, so that new allocations in these paths are
+// noticed. Lower them when removing allocations.
+const double RPC_ALLOCATION_BUDGET = 160;
+const double BROADCAST_ALLOCATION_BUDGET_PER_CLIENT = 28;
+
+// Waits for work that outlives a round-trip - such as write completions - to
+// finish
+AllocationTracker::Snapshot wait_until_idle() {
+  auto before = AllocationTracker::getSnapshot();
+  while (true) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    const auto after = AllocationTracker::getSnapshot();
+    if (
+      AllocationTracker::getTotal(after).allocations
+      == AllocationTracker::getTotal(before).allocations) {
+      return after;
+    }
+    before = after;
+  }
+}
+
+void check_budget(
+  benchmark::State& state,
+  const AllocationTracker::Snapshot& before,
+  double budget) {
+  const auto after = wait_until_idle();
+  const double operations = state.iterations();
+  for (size_t i = 0; i < AllocationTracker::SCOPE_COUNT; ++i) {
+    const auto scope = static_cast<AllocationScope>(i);
+    const auto allocations = after[i].allocations - before[i].allocations;
+    if (scope == AllocationScope::EXCLUDED || allocations == 0) {
+      continue;
+    }
+    state.counters[AllocationTracker::scopeToString(scope)]
+      = allocations / operations;
+  }
+  const auto total = AllocationTracker::getTotal(after);
+  const auto totalBefore = AllocationTracker::getTotal(before);
+  const double allocations
+    = (total.allocations - totalBefore.allocations) / operations;
+  state.counters["allocations"] = allocations;
+  state.counters["bytes"] = (total.bytes - totalBefore.bytes) / operations;
+  if (allocations > budget) {
+    allocation_budget_exceeded();
+    state.SkipWithError(fmt::format(
+                          "{:.1f} allocations per operation exceeds the "
+                          "budget of {:.1f}",
+                          allocations, budget)
+                          .c_str());
+  }
+}
+
+// Server-side allocations for an `outputs/get` round-trip, by subsystem
+void BM_RpcAllocations(benchmark::State& state) {
+  ALLOCATION_SCOPE(EXCLUDED);
+  BenchmarkServer server;
+  BenchmarkClient client(server.getPort(), PASSWORD);
+  // Let caches and buffers reach their steady-state sizes
+  for (int i = 0; i < 100; ++i) {
+    client.call("outputs/get");
+  }
+
+  const auto before = wait_until_idle();
+  for (auto _: state) {
+    auto result = client.call("outputs/get");
+    benchmark::DoNotOptimize(result);
+  }
+  check_budget(state, before, RPC_ALLOCATION_BUDGET);
+}
+
+// Server-side allocations for delivering an `outputs/stateChanged`
+// notification to every client, by subsystem
+//
+// Argument: number of clients
+void BM_BroadcastAllocations(benchmark::State& state) {
+  ALLOCATION_SCOPE(EXCLUDED);
+  BenchmarkServer server;
+  std::vector<std::unique_ptr<BenchmarkClient>> clients;
+  for (int i = 0; i < state.range(0); ++i) {
+    clients.push_back(
+      std::make_unique<BenchmarkClient>(server.getPort(), PASSWORD));
+  }
+  for (int i = 0; i < 100; ++i) {
+    server.getSoftware().outputStateChanged("output_0", OutputState::ACTIVE);
+  }
+
+  const auto before = wait_until_idle();
+  bool active = false;
+  for (auto _: state) {
+    active = !active;
+    server.getSoftware().outputStateChanged(
+      "output_0", active ? OutputState::ACTIVE : OutputState::STOPPED);
+  }
+  check_budget(
+    state, before, BROADCAST_ALLOCATION_BUDGET_PER_CLIENT * state.range(0));
+}
+
+}// namespace
+
+BENCHMARK(BM_RpcAllocations)->Iterations(2000)->UseRealTime();
+BENCHMARK(BM_BroadcastAllocations)
+  ->ArgName("clients")
+  ->Arg(1)
+  ->Arg(4)
+  ->Iterations(2000)
+  ->UseRealTime();
+
+#endif
@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#include "Core/Base64.h"
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <string>
+
+namespace {
+
+// A delta tile, a small JPEG thumbnail, a Stream Deck-sized PNG, and a
+// full-size 1080p PNG
+const size_t SIZES[] = {4 << 10, 32 << 10, 256 << 10, 2 << 20};
+
+std::string random_bytes(size_t size) {
+  std::mt19937_64 rng(size);
+  std::string ret(size, '\0');
+  for (auto& c : ret) {
+    c = static_cast<char>(rng());
+  }
+  return ret;
+}
+
+// Every implementation must produce exactly the same output as the scalar
+// one, including for sizes that aren't a multiple of any block size.
+bool validate(Base64Implementation impl, std::string* error) {
+  for (size_t size = 0; size < 512; ++size) {
+    const auto data = random_bytes(size);
+    std::string expected(base64_encoded_size(size), '\0');
+    base64_encode(Base64Implementation::SCALAR, data, expected.data());
+
+    std::string encoded(base64_encoded_size(size), '\0');
+    if (
+      base64_encode(impl, data, encoded.data()) != encoded.size()
+      || encoded != expected) {
+      *error = "encoding mismatch at size " + std::to_string(size);
+      return false;
+    }
+
+    std::string decoded(base64_decoded_max_size(encoded.size()), '\0');
+    const auto decodedSize = base64_decode(
+      impl, encoded, reinterpret_cast<uint8_t*>(decoded.data()));
+    if (!decodedSize || decoded.substr(0, *decodedSize) != data) {
+      *error = "decoding mismatch at size " + std::to_string(size);
+      return false;
+    }
+
+    if (!encoded.empty()) {
+      auto invalid = encoded;
+      invalid[size % invalid.size()] = '!';
+      if (base64_decode(
+            impl, invalid, reinterpret_cast<uint8_t*>(decoded.data()))) {
+        *error = "accepted invalid input at size " + std::to_string(size);
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+void BM_Base64Encode(benchmark::State& state, Base64Implementation impl) {
+  std::string error;
+  if (!validate(impl, &error)) {
+    state.SkipWithError(error.c_str());
+    return;
+  }
+  const auto data = random_bytes(state.range(0));
+  std::string out(base64_encoded_size(data.size()), '\0');
+  for (auto _: state) {
+    benchmark::DoNotOptimize(base64_encode(impl, data, out.data()));
+    benchmark::ClobberMemory();
+  }
+  state.SetBytesProcessed(int64_t(state.iterations()) * data.size());
+}
+
+void BM_Base64Decode(benchmark::State& state, Base64Implementation impl) {
+  std::string error;
+  if (!validate(impl, &error)) {
+    state.SkipWithError(error.c_str());
+    return;
+  }
+  const auto encoded = base64_encode(random_bytes(state.range(0)));
+  std::string out(base64_decoded_max_size(encoded.size()), '\0');
+  for (auto _: state) {
+    benchmark::DoNotOptimize(
+      base64_decode(impl, encoded, reinterpret_cast<uint8_t*>(out.data())));
+    benchmark::ClobberMemory();
+  }
+  state.SetBytesProcessed(int64_t(state.iterations()) * encoded.size());
+}
+
+const auto registered = [] {
+  for (const auto impl : base64_supported_implementations()) {
+    const std::string name = base64_implementation_name(impl);
+    auto encode = benchmark::RegisterBenchmark(
+      ("BM_Base64Encode/" + name).c_str(), BM_Base64Encode, impl);
+    auto decode = benchmark::RegisterBenchmark(
+      ("BM_Base64Decode/" + name).c_str(), BM_Base64Decode, impl);
+    for (const auto size : SIZES) {
+      encode->Arg(size);
+      decode->Arg(size);
+    }
+  }
+  return true;
+}();
+
+}// namespace
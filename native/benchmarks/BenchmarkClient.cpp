@@ -0,0 +1,278 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#include "BenchmarkClient.h"
+
+#include "Core/Base64.h"
+#include "Core/HandshakeMessages.h"
+
+#include <fmt/format.h>
+
+#include <array>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+using json = nlohmann::json;
+
+namespace {
+template <typename T>
+std::string as_string(const T& value) {
+  return std::string(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void check(bool condition, const char* what) {
+  if (!condition) {
+    throw std::runtime_error(what);
+  }
+}
+
+struct Credentials {
+  uint8_t pwhashSalt[crypto_pwhash_SALTBYTES];
+  uint8_t psk[crypto_secretbox_KEYBYTES];
+};
+
+const Credentials& get_credentials(const std::string& password) {
+  static std::mutex mutex;
+  static std::map<std::string, Credentials> cache;
+  std::scoped_lock lock(mutex);
+  const auto it = cache.find(password);
+  if (it != cache.end()) {
+    return it->second;
+  }
+  Credentials credentials;
+  randombytes_buf(credentials.pwhashSalt, sizeof(credentials.pwhashSalt));
+  check(
+    crypto_pwhash(
+      credentials.psk, sizeof(credentials.psk), password.data(),
+      password.size(), credentials.pwhashSalt,
+      crypto_pwhash_OPSLIMIT_INTERACTIVE, crypto_pwhash_MEMLIMIT_INTERACTIVE,
+      crypto_pwhash_ALG_DEFAULT)
+      == 0,
+    "crypto_pwhash");
+  return cache.emplace(password, credentials).first->second;
+}
+}// namespace
+
+BenchmarkClient::BenchmarkClient(
+  uint16_t port,
+  const std::string& password,
+  Transport transport)
+  : mTransport(transport), mSocket(mContext) {
+  check(sodium_init() >= 0, "sodium_init");
+  const auto& credentials = get_credentials(password);
+  mSocket.connect(
+    asio::ip::tcp::endpoint(asio::ip::address_v6::loopback(), port));
+  mSocket.set_option(asio::ip::tcp::no_delay(true));
+  if (transport == Transport::WEBSOCKET) {
+    webSocketUpgrade(port);
+  }
+
+  ClientHelloBox helloBox;
+  ClientHelloMessage hello;
+  crypto_secretstream_xchacha20poly1305_keygen(helloBox.serverToClientKey);
+  memcpy(hello.pwhashSalt, credentials.pwhashSalt, sizeof(hello.pwhashSalt));
+  randombytes_buf(hello.secretBoxNonce, sizeof(hello.secretBoxNonce));
+  const auto psk = credentials.psk;
+  crypto_secretbox_easy(
+    hello.secretBox, reinterpret_cast<const uint8_t*>(&helloBox),
+    sizeof(helloBox), hello.secretBoxNonce, psk);
+  sendMessage(as_string(hello));
+
+  const auto blob = receiveMessage();
+  check(blob.size() == sizeof(ServerHelloMessage), "ServerHello size");
+  const auto serverHello
+    = reinterpret_cast<const ServerHelloMessage*>(blob.data());
+  ServerHelloBox serverBox;
+  check(
+    crypto_secretbox_open_easy(
+      reinterpret_cast<uint8_t*>(&serverBox), serverHello->secretBox,
+      sizeof(serverHello->secretBox), serverHello->secretBoxNonce, psk)
+      == 0,
+    "ServerHello box");
+  check(
+    crypto_secretstream_xchacha20poly1305_init_pull(
+      &mPullState, serverHello->serverToClientHeader,
+      helloBox.serverToClientKey)
+      == 0,
+    "init_pull");
+
+  ClientReadyMessage ready;
+  crypto_secretstream_xchacha20poly1305_init_push(
+    &mPushState, ready.clientToServerHeader, serverBox.clientToServerKey);
+  crypto_auth(
+    ready.authenticationMac, ready.clientToServerHeader,
+    sizeof(ready.clientToServerHeader), serverBox.authenticationKey);
+  sendMessage(as_string(ready));
+
+  const auto hi = json::parse(receiveEncrypted());
+  check(hi.value("method", "") == "hello", "hello");
+}
+
+BenchmarkClient::~BenchmarkClient() {
+  asio::error_code ec;
+  mSocket.close(ec);
+}
+
+json BenchmarkClient::call(const std::string& method, const json& params) {
+  auto response = request({{"method", method}, {"params", params}});
+  check(response.contains("result"), "RPC failed");
+  return response["result"];
+}
+
+json BenchmarkClient::request(json request) {
+  const auto id = mNextId++;
+  request["jsonrpc"] = "2.0";
+  request["id"] = id;
+  sendEncrypted(request.dump());
+  while (true) {
+    auto message = json::parse(receiveEncrypted());
+    if (message.contains("id") && message["id"] == id) {
+      return message;
+    }
+  }
+}
+
+void BenchmarkClient::webSocketUpgrade(uint16_t port) {
+  char nonce[16];
+  randombytes_buf(nonce, sizeof(nonce));
+  const auto key = base64_encode(std::string_view(nonce, sizeof(nonce)));
+  const auto request = fmt::format(
+    "GET / HTTP/1.1\r\n"
+    "Host: [::1]:{}\r\n"
+    "Upgrade: websocket\r\n"
+    "Connection: Upgrade\r\n"
+    "Sec-WebSocket-Key: {}\r\n"
+    "Sec-WebSocket-Version: 13\r\n"
+    "\r\n",
+    port, key);
+  asio::write(mSocket, asio::buffer(request));
+  const auto headerSize = asio::read_until(mSocket, mReadBuffer, "\r\n\r\n");
+  check(
+    readExactly(headerSize).starts_with("HTTP/1.1 101 "), "WebSocket upgrade");
+}
+
+void BenchmarkClient::sendMessage(const std::string& message) {
+  if (mTransport == Transport::TCP) {
+    const auto header
+      = fmt::format("Content-Length: {}\r\n\r\n", message.size());
+    const std::array<asio::const_buffer, 2> buffers {
+      asio::buffer(header), asio::buffer(message)};
+    asio::write(mSocket, buffers);
+    return;
+  }
+
+  // A single, final, binary frame; frames from clients must be masked
+  std::string frame {'\x82'};
+  const auto size = message.size();
+  if (size < 126) {
+    frame += static_cast<char>(0x80 | size);
+  } else if (size <= 0xffff) {
+    frame += static_cast<char>(0x80 | 126);
+    frame += static_cast<char>(size >> 8);
+    frame += static_cast<char>(size & 0xff);
+  } else {
+    frame += static_cast<char>(0x80 | 127);
+    for (int i = 7; i >= 0; --i) {
+      frame += static_cast<char>((size >> (8 * i)) & 0xff);
+    }
+  }
+  uint8_t mask[4];
+  randombytes_buf(mask, sizeof(mask));
+  frame.append(reinterpret_cast<const char*>(mask), sizeof(mask));
+  const auto offset = frame.size();
+  frame += message;
+  for (size_t i = 0; i < size; ++i) {
+    frame[offset + i] ^= mask[i % sizeof(mask)];
+  }
+  asio::write(mSocket, asio::buffer(frame));
+}
+
+std::string BenchmarkClient::receiveMessage() {
+  if (mTransport == Transport::WEBSOCKET) {
+    return receiveWebSocketMessage();
+  }
+  const auto headerSize = asio::read_until(mSocket, mReadBuffer, "\r\n\r\n");
+  const auto header = readExactly(headerSize);
+  const std::string prefix("Content-Length: ");
+  check(header.starts_with(prefix), "Content-Length");
+  return readExactly(std::stoull(header.substr(prefix.size())));
+}
+
+std::string BenchmarkClient::receiveWebSocketMessage() {
+  std::string message;
+  while (true) {
+    const auto header = readExactly(2);
+    const bool fin = header[0] & 0x80;
+    const auto opcode = header[0] & 0x0f;
+    check(!(header[1] & 0x80), "masked frame from server");
+    uint64_t length = header[1] & 0x7f;
+    if (length == 126 || length == 127) {
+      const auto extended = readExactly(length == 126 ? 2 : 8);
+      length = 0;
+      for (const uint8_t byte : extended) {
+        length = (length << 8) | byte;
+      }
+    }
+    const auto payload = readExactly(length);
+    check(opcode != 0x8, "WebSocket closed");
+    // Ignore pings and pongs
+    if (opcode & 0x8) {
+      continue;
+    }
+    message += payload;
+    if (fin) {
+      return message;
+    }
+  }
+}
+
+std::string BenchmarkClient::readExactly(size_t size) {
+  if (mReadBuffer.size() < size) {
+    asio::read(
+      mSocket, mReadBuffer, asio::transfer_exactly(size - mReadBuffer.size()));
+  }
+  const auto data = mReadBuffer.data();
+  std::string ret(asio::buffers_begin(data), asio::buffers_begin(data) + size);
+  mReadBuffer.consume(size);
+  return ret;
+}
+
+void BenchmarkClient::sendEncrypted(const std::string& plaintext) {
+  std::string ciphertext(
+    plaintext.size() + crypto_secretstream_xchacha20poly1305_ABYTES, '\0');
+  unsigned long long clen;
+  crypto_secretstream_xchacha20poly1305_push(
+    &mPushState, reinterpret_cast<uint8_t*>(ciphertext.data()), &clen,
+    reinterpret_cast<const uint8_t*>(plaintext.data()), plaintext.size(),
+    nullptr, 0, 0);
+  ciphertext.resize(clen);
+  sendMessage(ciphertext);
+}
+
+std::string BenchmarkClient::receiveEncrypted() {
+  const auto ciphertext = receiveMessage();
+  check(
+    ciphertext.size() >= crypto_secretstream_xchacha20poly1305_ABYTES,
+    "ciphertext size");
+  std::string plaintext(
+    ciphertext.size() - crypto_secretstream_xchacha20poly1305_ABYTES, '\0');
+  unsigned long long plen;
+  unsigned char tag;
+  check(
+    crypto_secretstream_xchacha20poly1305_pull(
+      &mPullState, reinterpret_cast<uint8_t*>(plaintext.data()), &plen, &tag,
+      reinterpret_cast<const uint8_t*>(ciphertext.data()), ciphertext.size(),
+      nullptr, 0)
+      == 0,
+    "decrypt");
+  plaintext.resize(plen);
+  return plaintext;
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <asio.hpp>
+#include <nlohmann/json.hpp>
+#include <sodium.h>
+
+#include <cstdint>
+#include <string>
+
+/** A minimal, blocking, client for driving a server from benchmarks.
+ *
+ * Performs the full handshake in the constructor; not thread-safe, so each
+ * benchmark thread should have its own client.
+ *
+ * The client's half of the password hashing is done once per password and
+ * reused, so that in-process clients don't compete with the server for CPU;
+ * the server still does the full key derivation for every handshake.
+ */
+class BenchmarkClient final {
+ public:
+  enum class Transport {
+    TCP,
+    WEBSOCKET,
+  };
+
+  BenchmarkClient(
+    uint16_t port,
+    const std::string& password,
+    Transport transport = Transport::TCP);
+  BenchmarkClient(const BenchmarkClient&) = delete;
+  ~BenchmarkClient();
+
+  // Returns the `result` of the response; notifications received while
+  // waiting for it are discarded.
+  nlohmann::json call(
+    const std::string& method,
+    const nlohmann::json& params = nlohmann::json::object());
+  // Sets `jsonrpc` and `id`, and returns the whole response, such as for
+  // `error` or `serverTiming`
+  nlohmann::json request(nlohmann::json request);
+
+ private:
+  void webSocketUpgrade(uint16_t port);
+  void sendMessage(const std::string& message);
+  std::string receiveMessage();
+  std::string receiveWebSocketMessage();
+  std::string readExactly(size_t size);
+  void sendEncrypted(const std::string& plaintext);
+  std::string receiveEncrypted();
+
+  Transport mTransport;
+  asio::io_context mContext;
+  asio::ip::tcp::socket mSocket;
+  asio::streambuf mReadBuffer;
+  uint64_t mNextId = 0;
+  crypto_secretstream_xchacha20poly1305_state mPushState;
+  crypto_secretstream_xchacha20poly1305_state mPullState;
+};
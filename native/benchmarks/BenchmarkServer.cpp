@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#include "BenchmarkServer.h"
+
+#include "Core/Config.h"
+#include "Core/Plugin.h"
+#include "dummy/Dummy.h"
+
+#include <atomic>
+#include <stdexcept>
+
+namespace {
+const uint16_t FIRST_PORT = 29001;
+}// namespace
+
+BenchmarkServer::BenchmarkServer() : BenchmarkServer(Options {}) {
+}
+
+BenchmarkServer::BenchmarkServer(Options options)
+  : mThreads(options.threads),
+    mTcpPort(allocatePort()),
+    mContext(std::make_shared<asio::io_context>()) {
+  if (options.webSocket) {
+    mWebSocketPort = allocatePort();
+  }
+  const Config config {
+    .password = PASSWORD,
+    .tcpPort = mTcpPort,
+    .webSocketPort = mWebSocketPort,
+  };
+  mSoftware
+    = std::make_shared<Dummy>(mContext, config, std::move(options.settings));
+  mPlugin = std::make_unique<Plugin>(mContext, mSoftware, mThreads);
+}
+
+BenchmarkServer::~BenchmarkServer() {
+}
+
+uint16_t BenchmarkServer::allocatePort() {
+  static std::atomic<uint16_t> next = FIRST_PORT;
+  return next++;
+}
+
+uint16_t BenchmarkServer::getPort(BenchmarkClient::Transport transport) const {
+  if (transport == BenchmarkClient::Transport::TCP) {
+    return mTcpPort;
+  }
+  if (!mWebSocketPort) {
+    throw std::logic_error("WebSocket is not enabled for this server");
+  }
+  return mWebSocketPort;
+}
+
+unsigned int BenchmarkServer::getThreads() const {
+  return mThreads;
+}
+
+Dummy& BenchmarkServer::getSoftware() const {
+  return *mSoftware;
+}
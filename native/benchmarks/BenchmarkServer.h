@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include "BenchmarkClient.h"
+#include "dummy/DummySettings.h"
+
+#include <asio.hpp>
+
+#include <cstdint>
+#include <memory>
+
+class Dummy;
+class Plugin;
+
+/** An in-process `Dummy` server for `BenchmarkClient`s to connect to.
+ *
+ * Listens on new ports, on localhost, until destroyed.
+ */
+class BenchmarkServer final {
+ public:
+  static constexpr char PASSWORD[] = "benchmark";
+
+  struct Options {
+    // io threads
+    unsigned int threads = 1;
+    bool webSocket = false;
+    // Defaults to two outputs and no scenes
+    DummySettings settings {.outputs = DummySettings::makeOutputs(2)};
+  };
+
+  BenchmarkServer();
+  explicit BenchmarkServer(Options options);
+  BenchmarkServer(const BenchmarkServer&) = delete;
+  ~BenchmarkServer();
+
+  // Every server in the process gets new ports, in case earlier ones are
+  // still in TIME_WAIT
+  static uint16_t allocatePort();
+
+  // Throws `std::logic_error` for WebSocket if it wasn't enabled
+  uint16_t getPort(
+    BenchmarkClient::Transport transport
+    = BenchmarkClient::Transport::TCP) const;
+  unsigned int getThreads() const;
+  // For emitting events from the streaming software
+  Dummy& getSoftware() const;
+
+ private:
+  unsigned int mThreads;
+  uint16_t mTcpPort;
+  uint16_t mWebSocketPort = 0;
+  std::shared_ptr<asio::io_context> mContext;
+  std::shared_ptr<Dummy> mSoftware;
+  std::unique_ptr<Plugin> mPlugin;
+};
@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#include <benchmark/benchmark.h>
+#include <sodium.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+namespace {
+
+const size_t ABYTES = crypto_secretstream_xchacha20poly1305_ABYTES;
+
+// From an RPC up to a large preview frame
+void payload_args(benchmark::internal::Benchmark* b) {
+  b->ArgName("bytes")->RangeMultiplier(16)->Range(64, 1024 * 1024);
+}
+
+struct Stream {
+  Stream() {
+    if (sodium_init() < 0) {
+      abort();
+    }
+    crypto_secretstream_xchacha20poly1305_keygen(key);
+    crypto_secretstream_xchacha20poly1305_init_push(&push, header, key);
+    crypto_secretstream_xchacha20poly1305_init_pull(&pull, header, key);
+  }
+
+  uint8_t key[crypto_secretstream_xchacha20poly1305_KEYBYTES];
+  uint8_t header[crypto_secretstream_xchacha20poly1305_HEADERBYTES];
+  crypto_secretstream_xchacha20poly1305_state push;
+  crypto_secretstream_xchacha20poly1305_state pull;
+};
+
+// What `ClientHandler` does for every message it sends
+//
+// Argument: plaintext size
+void BM_SecretstreamPush(benchmark::State& state) {
+  Stream stream;
+  const std::vector<uint8_t> plaintext(state.range(0), 'x');
+  std::vector<uint8_t> ciphertext(plaintext.size() + ABYTES);
+  for (auto _: state) {
+    unsigned long long clen;
+    crypto_secretstream_xchacha20poly1305_push(
+      &stream.push, ciphertext.data(), &clen, plaintext.data(),
+      plaintext.size(), nullptr, 0, 0);
+    benchmark::DoNotOptimize(ciphertext.data());
+  }
+  state.SetBytesProcessed(state.iterations() * plaintext.size());
+}
+
+// What `ClientHandler` does for every message it receives
+//
+// Argument: plaintext size
+void BM_SecretstreamPull(benchmark::State& state) {
+  Stream stream;
+  const std::vector<uint8_t> plaintext(state.range(0), 'x');
+  std::vector<uint8_t> ciphertext(plaintext.size() + ABYTES);
+  unsigned long long clen;
+  crypto_secretstream_xchacha20poly1305_push(
+    &stream.push, ciphertext.data(), &clen, plaintext.data(), plaintext.size(),
+    nullptr, 0, 0);
+
+  // Each message can only be pulled once, so rewind the state; it's a small
+  // POD, so copying it is negligible next to the decryption.
+  const auto initialPull = stream.pull;
+  std::vector<uint8_t> decrypted(plaintext.size());
+  for (auto _: state) {
+    stream.pull = initialPull;
+    unsigned long long plen;
+    unsigned char tag;
+    if (
+      crypto_secretstream_xchacha20poly1305_pull(
+        &stream.pull, decrypted.data(), &plen, &tag, ciphertext.data(), clen,
+        nullptr, 0)
+      != 0) {
+      state.SkipWithError("decryption failed");
+      break;
+    }
+    benchmark::DoNotOptimize(decrypted.data());
+  }
+  state.SetBytesProcessed(state.iterations() * plaintext.size());
+}
+
+}// namespace
+
+BENCHMARK(BM_SecretstreamPush)->Apply(payload_args);
+BENCHMARK(BM_SecretstreamPull)->Apply(payload_args);
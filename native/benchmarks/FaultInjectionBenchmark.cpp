@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#include "BenchmarkClient.h"
+#include "BenchmarkServer.h"
+#include "Core/FaultInjectingConnection.h"
+
+#include <benchmark/benchmark.h>
+#include <nlohmann/json.hpp>
+
+#include <chrono>
+
+using json = nlohmann::json;
+
+namespace {
+
+// Only measure the simulated network
+DummySettings get_settings() {
+  DummySettings settings {
+    .outputs = DummySettings::makeOutputs(2),
+    .scenes = DummySettings::makeScenes(2),
+    // Small enough for a thumbnail to fit through the slowest link
+    .frameWidth = 320,
+    .frameHeight = 180,
+  };
+  settings.latencies.clear();
+  return settings;
+}
+
+// Round trips through a `FaultInjectingConnection`, to check that the
+// simulated link behaves as configured: with only latency, `ping` should
+// take twice the one-way latency, and with a bandwidth cap, a thumbnail
+// should take its size divided by the bandwidth.
+//
+// Arguments: one-way latency (ms), bandwidth (bytes per second, 0 for
+// unlimited)
+void BM_RpcUnderFaults(
+  benchmark::State& state,
+  const char* method,
+  const char* params) {
+  FaultInjection faults;
+  faults.latency = std::chrono::milliseconds(state.range(0));
+  faults.sendBandwidth = state.range(1);
+  faults.receiveBandwidth = state.range(1);
+  // Must outlive the server, and exist when the client connects
+  const FaultInjector injector(faults);
+  const BenchmarkServer server({.settings = get_settings()});
+  BenchmarkClient client(server.getPort(), BenchmarkServer::PASSWORD);
+
+  const auto parsedParams = json::parse(params);
+  size_t bytes = 0;
+  for (auto _: state) {
+    const auto start = std::chrono::steady_clock::now();
+    const auto result = client.call(method, parsedParams);
+    state.SetIterationTime(
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+        .count());
+    bytes += result.dump().size();
+  }
+  state.SetBytesProcessed(bytes);
+}
+
+}// namespace
+
+#define FAULT_BENCHMARK(name, method, params) \
+  BENCHMARK_CAPTURE(BM_RpcUnderFaults, name, method, params) \
+    ->ArgNames({"latency_ms", "bandwidth"}) \
+    ->Args({0, 0}) \
+    ->Args({10, 0}) \
+    ->Args({50, 0}) \
+    ->Args({10, 1024 * 1024}) \
+    ->Args({10, 256 * 1024}) \
+    ->Iterations(20) \
+    ->UseManualTime() \
+    ->Unit(benchmark::kMillisecond)
+
+FAULT_BENCHMARK(ping, "ping", "{}");
+FAULT_BENCHMARK(
+  scenes_getThumbnail,
+  "scenes/getThumbnail",
+  R"({"id":"scene_0","content_type":"image/png"})");
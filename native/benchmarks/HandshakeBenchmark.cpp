@@ -0,0 +1,179 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#include "BenchmarkClient.h"
+#include "BenchmarkServer.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace {
+
+using Transport = BenchmarkClient::Transport;
+
+const char* const PASSWORD = BenchmarkServer::PASSWORD;
+const unsigned int IO_THREADS = 4;
+
+typedef std::chrono::duration<double, std::milli> Milliseconds;
+
+double percentile(std::vector<double> samples, double p) {
+  if (samples.empty()) {
+    return 0;
+  }
+  std::sort(samples.begin(), samples.end());
+  return samples[std::min(
+    samples.size() - 1, static_cast<size_t>(p * samples.size()))];
+}
+
+// Starts a new high-water mark where the platform allows it; otherwise the
+// peak is for the whole process, so run this benchmark on its own for
+// meaningful numbers.
+void reset_peak_rss() {
+#ifdef __linux__
+  std::ofstream("/proc/self/clear_refs") << "5";
+#endif
+}
+
+double get_peak_rss_mib() {
+#ifdef _WIN32
+  PROCESS_MEMORY_COUNTERS counters;
+  GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+  return counters.PeakWorkingSetSize / (1024.0 * 1024);
+#else
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+  // Bytes
+  return usage.ru_maxrss / (1024.0 * 1024);
+#else
+  // Kilobytes
+  return usage.ru_maxrss / 1024.0;
+#endif
+#endif
+}
+
+// Round-trips `ping` on an authenticated connection until stopped, to see how
+// much handshakes delay other clients' requests.
+class RpcProbe {
+ public:
+  explicit RpcProbe(uint16_t port) : mClient(port, PASSWORD) {
+  }
+
+  std::vector<double> measure(size_t count) {
+    std::vector<double> latencies;
+    for (size_t i = 0; i < count; ++i) {
+      latencies.push_back(ping());
+    }
+    return latencies;
+  }
+
+  void start() {
+    mStop = false;
+    mThread = std::thread([this]() {
+      while (!mStop) {
+        const auto latency = ping();
+        std::scoped_lock lock(mMutex);
+        mLatencies.push_back(latency);
+      }
+    });
+  }
+
+  std::vector<double> stop() {
+    mStop = true;
+    mThread.join();
+    std::scoped_lock lock(mMutex);
+    return std::move(mLatencies);
+  }
+
+ private:
+  double ping() {
+    const auto start = std::chrono::steady_clock::now();
+    mClient.call("ping");
+    return Milliseconds(std::chrono::steady_clock::now() - start).count();
+  }
+
+  BenchmarkClient mClient;
+  std::thread mThread;
+  std::atomic<bool> mStop = false;
+  std::mutex mMutex;
+  std::vector<double> mLatencies;
+};
+
+// Each iteration, the given number of clients connect and perform the full
+// ClientHello/ServerHello/ClientReady handshake at once; the server derives
+// a key from the password (Argon2) for each of them.
+//
+// Arguments: transport (0: TCP, 1: WebSocket), concurrent clients
+void BM_Handshake(benchmark::State& state) {
+  const auto transport = static_cast<Transport>(state.range(0));
+  const auto concurrency = state.range(1);
+  const BenchmarkServer server({.threads = IO_THREADS, .webSocket = true});
+  const auto port = server.getPort(transport);
+  // Derives the client's key, and warms up the server
+  BenchmarkClient warmup(port, PASSWORD, transport);
+
+  RpcProbe probe(server.getPort());
+  const auto idleRpcLatencies = probe.measure(200);
+
+  reset_peak_rss();
+  std::vector<double> latencies;
+  std::mutex latenciesMutex;
+  probe.start();
+  for (auto _: state) {
+    std::vector<std::thread> clients;
+    for (int i = 0; i < concurrency; ++i) {
+      clients.emplace_back([&]() {
+        const auto start = std::chrono::steady_clock::now();
+        BenchmarkClient client(port, PASSWORD, transport);
+        const auto latency
+          = Milliseconds(std::chrono::steady_clock::now() - start).count();
+        std::scoped_lock lock(latenciesMutex);
+        latencies.push_back(latency);
+      });
+    }
+    for (auto& client: clients) {
+      client.join();
+    }
+  }
+  const auto rpcLatencies = probe.stop();
+
+  state.counters["handshakes_per_second"] = benchmark::Counter(
+    state.iterations() * concurrency, benchmark::Counter::kIsRate);
+  state.counters["p50_ms"] = percentile(latencies, 0.5);
+  state.counters["p99_ms"] = percentile(latencies, 0.99);
+  state.counters["peak_rss_MiB"] = get_peak_rss_mib();
+  // Authenticated `ping` round-trips, while idle and during the handshakes
+  state.counters["idle_rpc_p50_ms"] = percentile(idleRpcLatencies, 0.5);
+  state.counters["idle_rpc_p99_ms"] = percentile(idleRpcLatencies, 0.99);
+  state.counters["rpc_p50_ms"] = percentile(rpcLatencies, 0.5);
+  state.counters["rpc_p99_ms"] = percentile(rpcLatencies, 0.99);
+}
+
+}// namespace
+
+BENCHMARK(BM_Handshake)
+  ->ArgNames({"webSocket", "clients"})
+  ->ArgsProduct({{0, 1}, {1, 4, 16}})
+  ->Iterations(20)
+  ->UseRealTime()
+  ->Unit(benchmark::kMillisecond);
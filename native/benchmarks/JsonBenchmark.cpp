@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#include "Core/Output.h"
+#include "Core/Scene.h"
+
+#include <benchmark/benchmark.h>
+#include <fmt/format.h>
+#include <nlohmann/json.hpp>
+
+#include <string>
+#include <vector>
+
+using json = nlohmann::json;
+
+namespace {
+
+std::vector<Output> make_outputs(size_t count) {
+  std::vector<Output> outputs;
+  for (size_t i = 0; i < count; ++i) {
+    outputs.push_back({
+      .id = fmt::format("output_{}", i),
+      .name = fmt::format("Output {}", i),
+      .state = OutputState::ACTIVE,
+      .type = OutputType::REMOTE_STREAM,
+      .delaySeconds = 10,
+    });
+  }
+  return outputs;
+}
+
+std::vector<Scene> make_scenes(size_t count) {
+  std::vector<Scene> scenes;
+  for (size_t i = 0; i < count; ++i) {
+    scenes.push_back({
+      .id = fmt::format("scene_{}", i),
+      .name = fmt::format("Scene {}", i),
+      .active = i == 0,
+    });
+  }
+  return scenes;
+}
+
+void count_args(benchmark::internal::Benchmark* b) {
+  b->ArgName("count")->Arg(1)->Arg(10)->Arg(100);
+}
+
+// Building the `result` of `outputs/get`, as `ClientHandler` does
+//
+// Argument: number of outputs
+void BM_OutputToJson(benchmark::State& state) {
+  const auto outputs = make_outputs(state.range(0));
+  for (auto _: state) {
+    json result;
+    for (const auto& output : outputs) {
+      result[output.id] = output.toJson();
+    }
+    benchmark::DoNotOptimize(result);
+  }
+  state.SetItemsProcessed(state.iterations() * outputs.size());
+}
+
+// Building the `result` of `scenes/get`, as `ClientHandler` does
+//
+// Argument: number of scenes
+void BM_SceneToJson(benchmark::State& state) {
+  const auto scenes = make_scenes(state.range(0));
+  for (auto _: state) {
+    json result;
+    for (const auto& scene : scenes) {
+      result[scene.id] = scene.toJson();
+    }
+    benchmark::DoNotOptimize(result);
+  }
+  state.SetItemsProcessed(state.iterations() * scenes.size());
+}
+
+// Parsing a decrypted request, and reading the fields that every request
+// needs; dispatch itself is covered by `BM_RpcDispatch`.
+void BM_JsonRpcParse(benchmark::State& state, const char* request) {
+  const std::string message(request);
+  for (auto _: state) {
+    auto jsonrpc = json::parse(message);
+    const std::string method = jsonrpc["method"];
+    benchmark::DoNotOptimize(method);
+    benchmark::DoNotOptimize(jsonrpc["id"]);
+  }
+  state.SetBytesProcessed(state.iterations() * message.size());
+}
+
+}// namespace
+
+BENCHMARK(BM_OutputToJson)->Apply(count_args);
+BENCHMARK(BM_SceneToJson)->Apply(count_args);
+
+BENCHMARK_CAPTURE(
+  BM_JsonRpcParse,
+  outputs_get,
+  R"({"jsonrpc":"2.0","id":1,"method":"outputs/get","params":{}})");
+BENCHMARK_CAPTURE(
+  BM_JsonRpcParse,
+  outputs_setDelay,
+  R"({"jsonrpc":"2.0","id":1,"method":"outputs/setDelay",)"
+  R"("params":{"id":"stream_id","seconds":30}})");
+BENCHMARK_CAPTURE(
+  BM_JsonRpcParse,
+  scenes_activate,
+  R"({"jsonrpc":"2.0","id":1,"method":"scenes/activate",)"
+  R"("params":{"id":"scene_1"}})");
+BENCHMARK_CAPTURE(
+  BM_JsonRpcParse,
+  scenes_getThumbnail,
+  R"({"jsonrpc":"2.0","id":1,"method":"scenes/getThumbnail",)"
+  R"("params":{"id":"scene_1","content_type":"image/png",)"
+  R"("ifNoneMatch":"0123456789abcdef","acceptDelta":true}})");
+BENCHMARK_CAPTURE(
+  BM_JsonRpcParse,
+  ping,
+  R"({"jsonrpc":"2.0","id":1,"method":"ping",)"
+  R"("params":{"clientTimestamp":1712345678901.25},"serverTiming":true})");
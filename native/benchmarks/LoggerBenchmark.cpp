@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#include "Core/Logger.h"
+
+#include <benchmark/benchmark.h>
+
+#include <optional>
+#include <string>
+
+namespace {
+
+// Sets the level for the duration of a benchmark; only the built-in sink is
+// registered, which does nothing outside of Windows debug builds.
+class ScopedLevel {
+ public:
+  explicit ScopedLevel(LogLevel level) : mPrevious(Logger::getLevel()) {
+    Logger::setLevel(level);
+  }
+  ~ScopedLevel() {
+    Logger::setLevel(mPrevious);
+  }
+
+ private:
+  LogLevel mPrevious;
+};
+
+// The common case: a message below the current level
+void BM_LoggerFiltered(benchmark::State& state) {
+  ScopedLevel level(LogLevel::INFO);
+  const std::string id("record_id");
+  for (auto _: state) {
+    Logger::debug("Output {} changed to state {}", id, 2);
+  }
+}
+
+// An enabled message; argument 0 formats on the calling thread, argument 1
+// defers formatting to the background thread.
+void BM_LoggerEnabled(benchmark::State& state) {
+  ScopedLevel level(LogLevel::DEBUG);
+  std::optional<Logger::BackgroundThread> background;
+  if (state.range(0)) {
+    background.emplace();
+  }
+  const std::string id("record_id");
+  for (auto _: state) {
+    Logger::debug("Output {} changed to state {}", id, 2);
+  }
+  // Untimed; don't leave queued messages for the next benchmark
+  Logger::flush();
+}
+
+}// namespace
+
+BENCHMARK(BM_LoggerFiltered);
+BENCHMARK(BM_LoggerEnabled)->ArgName("background")->Arg(0)->Arg(1);
@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#include "Core/OneShot.h"
+
+#include <asio.hpp>
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <memory>
+#include <thread>
+
+namespace {
+
+// The previous implementation, for comparison: a timer that never expires,
+// cancelled to wake the single waiter
+template <typename T>
+class TimerPromise {
+ public:
+  explicit TimerPromise(asio::io_context& context)
+    : p(std::make_shared<Impl>(context)) {
+  }
+
+  void resolve(T data) {
+    p->data = data;
+    p->timer.cancel();
+  }
+
+  asio::awaitable<T> async_wait() {
+    asio::error_code ec;
+    co_await p->timer.async_wait(
+      asio::redirect_error(asio::use_awaitable, ec));
+    co_return p->data;
+  }
+
+ private:
+  struct Impl {
+    explicit Impl(asio::io_context& context)
+      : timer(context, std::chrono::steady_clock::time_point::max()) {
+    }
+    asio::steady_timer timer;
+    T data;
+  };
+  std::shared_ptr<Impl> p;
+};
+
+template <typename TPromise>
+asio::awaitable<void> wait_for(TPromise promise) {
+  benchmark::DoNotOptimize(co_await promise.async_wait());
+}
+
+asio::awaitable<void> wait_for_with_deadline(OneShot<int> promise) {
+  benchmark::DoNotOptimize(
+    co_await promise.async_wait_for(std::chrono::seconds(10)));
+}
+
+asio::awaitable<void> wait_then_resolve(
+  OneShot<int> promise,
+  OneShot<bool> resumed) {
+  benchmark::DoNotOptimize(co_await promise.async_wait());
+  resumed.resolve(true);
+}
+
+// Each iteration is one backend call: create the promise, start waiting for
+// it, resolve it, and resume the waiter.
+void BM_TimerPromise(benchmark::State& state) {
+  asio::io_context context;
+  for (auto _: state) {
+    TimerPromise<int> promise(context);
+    asio::co_spawn(context, wait_for(promise), asio::detached);
+    context.poll();
+    promise.resolve(1);
+    context.poll();
+    context.restart();
+  }
+}
+BENCHMARK(BM_TimerPromise);
+
+// Argument: number of waiters
+void BM_OneShot(benchmark::State& state) {
+  asio::io_context context;
+  for (auto _: state) {
+    OneShot<int> promise;
+    for (int64_t i = 0; i < state.range(0); ++i) {
+      asio::co_spawn(context, wait_for(promise), asio::detached);
+    }
+    context.poll();
+    promise.resolve(1);
+    context.poll();
+    context.restart();
+  }
+}
+BENCHMARK(BM_OneShot)->ArgName("waiters")->Arg(1)->Arg(16);
+
+// Resolved before anyone waits, such as a backend call that completes
+// synchronously
+void BM_OneShotAlreadyResolved(benchmark::State& state) {
+  asio::io_context context;
+  for (auto _: state) {
+    OneShot<int> promise;
+    promise.resolve(1);
+    asio::co_spawn(context, wait_for(promise), asio::detached);
+    context.poll();
+    context.restart();
+  }
+}
+BENCHMARK(BM_OneShotAlreadyResolved);
+
+// Resolved before the deadline, which is the usual case for timeouts
+void BM_OneShotWithDeadline(benchmark::State& state) {
+  asio::io_context context;
+  for (auto _: state) {
+    OneShot<int> promise;
+    asio::co_spawn(context, wait_for_with_deadline(promise), asio::detached);
+    context.poll();
+    promise.resolve(1);
+    context.poll();
+    context.restart();
+  }
+}
+BENCHMARK(BM_OneShotWithDeadline);
+
+// Resolved by another thread, like OBS's tick callbacks and XSplit's replies;
+// the io thread runs continuously.
+void BM_OneShotCrossThread(benchmark::State& state) {
+  asio::io_context context;
+  auto work = asio::make_work_guard(context);
+  std::thread io([&context]() { context.run(); });
+  for (auto _: state) {
+    OneShot<int> promise;
+    OneShot<bool> resumed;
+    asio::co_spawn(
+      context, wait_then_resolve(promise, resumed), asio::detached);
+    promise.resolve(1);
+    while (!resumed.isResolved()) {
+      std::this_thread::yield();
+    }
+  }
+  work.reset();
+  io.join();
+}
+BENCHMARK(BM_OneShotCrossThread)->UseRealTime();
+
+}// namespace
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#include "Core/ImageTiles.h"
+#include "Core/PreviewDeltaTracker.h"
+#include "Core/PreviewFrame.h"
+#include "dummy/Dummy.h"
+#include "dummy/SyntheticFrames.h"
+
+#include <asio.hpp>
+#include <benchmark/benchmark.h>
+
+#include <memory>
+
+namespace {
+
+const uint32_t WIDTH = 1280;
+const uint32_t HEIGHT = 720;
+const uint32_t SCENE_SIZE = 0;// Already scaled
+
+std::shared_ptr<StreamingSoftware> make_software() {
+  return std::make_shared<Dummy>(
+    std::make_shared<asio::io_context>(), Config {}, std::vector<Output> {});
+}
+
+// Delta-encoded `previews/frame` notifications for a client that acknowledges
+// every frame, compared to sending a keyframe every time.
+//
+// Argument: percentage of the frame that changes each frame
+void BM_PreviewDeltaEncoding(benchmark::State& state) {
+  const float changeRatio = state.range(0) / 100.0f;
+  auto software = make_software();
+  PreviewDeltaTracker tracker;
+
+  uint64_t sequence = 0;
+  size_t frames = 0;
+  size_t deltaBytes = 0;
+  size_t keyframeBytes = 0;
+  size_t changedTiles = 0;
+  size_t totalTiles = 0;
+  std::shared_ptr<const ImageTiles> previous;
+
+  for (auto _: state) {
+    state.PauseTiming();
+    auto image = make_synthetic_frame(WIDTH, HEIGHT, sequence, changeRatio);
+    auto frame = std::make_shared<PreviewFrame>(
+      software, "scene", ++sequence, std::move(image));
+    state.ResumeTiming();
+
+    const auto& notification = tracker.getNotification(*frame, SCENE_SIZE);
+    benchmark::DoNotOptimize(notification.data());
+    tracker.acknowledge(sequence);
+
+    state.PauseTiming();
+    // Not part of the hot path, but useful for the counters
+    deltaBytes += notification.size();
+    keyframeBytes += frame->getNotification(SCENE_SIZE).size();
+    const auto tiles = frame->getTiles(SCENE_SIZE);
+    totalTiles += tiles->getTileCount();
+    changedTiles += previous ? tiles->getChangedTiles(*previous).size()
+                             : tiles->getTileCount();
+    previous = tiles;
+    ++frames;
+    state.ResumeTiming();
+  }
+
+  state.counters["bytes_per_frame"]
+    = benchmark::Counter(double(deltaBytes) / frames);
+  state.counters["keyframe_bytes_per_frame"]
+    = benchmark::Counter(double(keyframeBytes) / frames);
+  state.counters["changed_tiles_pct"]
+    = benchmark::Counter((100.0 * changedTiles) / totalTiles);
+  state.counters["bytes_saved_pct"] = benchmark::Counter(
+    100.0 * (1.0 - (double(deltaBytes) / keyframeBytes)));
+  state.SetBytesProcessed(int64_t(deltaBytes));
+}
+BENCHMARK(BM_PreviewDeltaEncoding)
+  ->Arg(0)
+  ->Arg(1)
+  ->Arg(5)
+  ->Arg(10)
+  ->Arg(25)
+  ->Arg(50)
+  ->Arg(100)
+  ->Unit(benchmark::kMillisecond);
+
+// Cost of tile hashing alone, which happens for every captured frame
+void BM_ImageTiles(benchmark::State& state) {
+  const auto image = make_synthetic_frame(WIDTH, HEIGHT, 0, 0.05f);
+  for (auto _: state) {
+    ImageTiles tiles(image);
+    benchmark::DoNotOptimize(tiles.getTileCount());
+  }
+  state.SetBytesProcessed(int64_t(state.iterations()) * image.rgba.size());
+}
+BENCHMARK(BM_ImageTiles);
+
+}// namespace
@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#include "BenchmarkClient.h"
+#include "BenchmarkServer.h"
+
+#include <benchmark/benchmark.h>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+namespace {
+
+// Shared by every method's benchmark, so the handshake is only done once
+BenchmarkClient& get_client() {
+  static const BenchmarkServer server({
+    .settings = {
+      .outputs = DummySettings::makeOutputs(2),
+      .scenes = DummySettings::makeScenes(2),
+    },
+  });
+  static BenchmarkClient client(server.getPort(), BenchmarkServer::PASSWORD);
+  return client;
+}
+
+// Server-side handling of a request, using the server's own `serverTiming`
+// breakdown so that the network and the client are not measured: the
+// reported time is `dispatch` (parsing and handling) plus `backend` (the
+// streaming software).
+void BM_RpcDispatch(
+  benchmark::State& state,
+  const char* method,
+  const char* params) {
+  auto& client = get_client();
+  const json request {
+    {"method", method},
+    {"params", json::parse(params)},
+    {"serverTiming", true},
+  };
+  double dispatch = 0;
+  double backend = 0;
+  for (auto _: state) {
+    const auto response = client.request(request);
+    if (!response.contains("serverTiming")) {
+      state.SkipWithError("no serverTiming in response");
+      break;
+    }
+    const auto& timing = response["serverTiming"];
+    const double iterationDispatch = timing["dispatch"];
+    const double iterationBackend = timing["backend"];
+    dispatch += iterationDispatch;
+    backend += iterationBackend;
+    state.SetIterationTime((iterationDispatch + iterationBackend) / 1e6);
+  }
+  // Microseconds
+  state.counters["dispatch"]
+    = benchmark::Counter(dispatch, benchmark::Counter::kAvgIterations);
+  state.counters["backend"]
+    = benchmark::Counter(backend, benchmark::Counter::kAvgIterations);
+}
+
+}// namespace
+
+#define DISPATCH_BENCHMARK(name, method, params) \
+  BENCHMARK_CAPTURE(BM_RpcDispatch, name, method, params) \
+    ->UseManualTime() \
+    ->Unit(benchmark::kMicrosecond)
+
+DISPATCH_BENCHMARK(connection_getStats, "connection/getStats", "{}");
+DISPATCH_BENCHMARK(outputs_get, "outputs/get", "{}");
+DISPATCH_BENCHMARK(ping, "ping", R"({"clientTimestamp":1712345678901.25})");
+DISPATCH_BENCHMARK(scenes_activate, "scenes/activate", R"({"id":"scene_1"})");
+DISPATCH_BENCHMARK(scenes_get, "scenes/get", "{}");
+DISPATCH_BENCHMARK(
+  scenes_getThumbnail,
+  "scenes/getThumbnail",
+  R"({"id":"scene_0","content_type":"image/png"})");
+DISPATCH_BENCHMARK(server_connections, "server/connections", "{}");
+DISPATCH_BENCHMARK(server_stats, "server/stats", "{}");
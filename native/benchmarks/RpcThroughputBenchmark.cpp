@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#include "BenchmarkClient.h"
+#include "BenchmarkServer.h"
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <mutex>
+
+namespace {
+
+// Shared by all benchmark threads of a run; replaced when the io thread count
+// changes.
+std::shared_ptr<BenchmarkServer> get_server(unsigned int threads) {
+  static std::mutex mutex;
+  static std::shared_ptr<BenchmarkServer> server;
+  std::scoped_lock lock(mutex);
+  if (!(server && server->getThreads() == threads)) {
+    server.reset();
+    server = std::make_shared<BenchmarkServer>(
+      BenchmarkServer::Options {.threads = threads});
+  }
+  return server;
+}
+
+// Round-trips of `outputs/get` over encrypted TCP connections; each benchmark
+// thread is a client with its own connection, so this measures how well the
+// server spreads independent connections over its io threads.
+//
+// Argument: server io thread count
+void BM_RpcThroughput(benchmark::State& state) {
+  const auto server = get_server(state.range(0));
+  // The handshake is deliberately expensive (pwhash), so is not measured
+  BenchmarkClient client(server->getPort(), BenchmarkServer::PASSWORD);
+
+  for (auto _: state) {
+    auto result = client.call("outputs/get");
+    benchmark::DoNotOptimize(result);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+}// namespace
+
+BENCHMARK(BM_RpcThroughput)
+  ->ArgName("ioThreads")
+  ->Arg(1)
+  ->Arg(2)
+  ->Arg(4)
+  ->Arg(8)
+  ->Threads(1)
+  ->Threads(4)
+  ->Threads(16)
+  ->Iterations(2000)
+  ->UseRealTime();
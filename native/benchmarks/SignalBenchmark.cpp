@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#include "Core/Signal.h"
+
+#include <benchmark/benchmark.h>
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Roughly what every ClientHandler connects to outputStateChanged
+struct Subscriber {
+  size_t received = 0;
+  void outputStateChanged(const std::string& id, int state) {
+    received += id.size() + state;
+  }
+};
+
+// The previous implementation, for comparison
+class MapSignal {
+ public:
+  typedef std::function<void(const std::string&, int)> Callback;
+  uint64_t connect(const Callback& callback) {
+    const auto key = mNextKey++;
+    mCallbacks.emplace(key, callback);
+    return key;
+  }
+  void disconnect(uint64_t key) {
+    mCallbacks.erase(key);
+  }
+  void operator()(const std::string& id, int state) {
+    for (auto& [key, callback] : mCallbacks) {
+      callback(id, state);
+    }
+  }
+
+ private:
+  uint64_t mNextKey = 0;
+  std::map<uint64_t, Callback> mCallbacks;
+};
+
+void subscriber_args(benchmark::internal::Benchmark* b) {
+  b->ArgName("subscribers")->Arg(10)->Arg(1000)->Arg(10000);
+}
+
+// Argument: number of connected subscribers
+void BM_SignalEmit(benchmark::State& state) {
+  Signal<const std::string&, int> signal;
+  std::vector<Subscriber> subscribers(state.range(0));
+  std::vector<ScopedConnection> connections;
+  for (auto& subscriber : subscribers) {
+    connections.push_back(
+      signal.connect(&subscriber, &Subscriber::outputStateChanged));
+  }
+  const std::string id("stream_id");
+
+  for (auto _: state) {
+    emit signal(id, 1);
+  }
+  benchmark::DoNotOptimize(subscribers.data());
+  state.SetItemsProcessed(state.iterations() * subscribers.size());
+}
+BENCHMARK(BM_SignalEmit)->Apply(subscriber_args);
+
+void BM_MapSignalEmit(benchmark::State& state) {
+  MapSignal signal;
+  std::vector<Subscriber> subscribers(state.range(0));
+  for (auto& subscriber : subscribers) {
+    signal.connect([s = &subscriber](const std::string& id, int state) {
+      s->outputStateChanged(id, state);
+    });
+  }
+  const std::string id("stream_id");
+
+  for (auto _: state) {
+    signal(id, 1);
+  }
+  benchmark::DoNotOptimize(subscribers.data());
+  state.SetItemsProcessed(state.iterations() * subscribers.size());
+}
+BENCHMARK(BM_MapSignalEmit)->Apply(subscriber_args);
+
+// A client connecting then disconnecting while others stay subscribed
+void BM_SignalConnectDisconnect(benchmark::State& state) {
+  Signal<const std::string&, int> signal;
+  std::vector<Subscriber> subscribers(state.range(0));
+  std::vector<ScopedConnection> connections;
+  for (auto& subscriber : subscribers) {
+    connections.push_back(
+      signal.connect(&subscriber, &Subscriber::outputStateChanged));
+  }
+  Subscriber transient;
+
+  for (auto _: state) {
+    auto connection
+      = signal.connect(&transient, &Subscriber::outputStateChanged);
+    connection->disconnect();
+  }
+}
+BENCHMARK(BM_SignalConnectDisconnect)->Apply(subscriber_args);
+
+void BM_MapSignalConnectDisconnect(benchmark::State& state) {
+  MapSignal signal;
+  std::vector<Subscriber> subscribers(state.range(0));
+  for (auto& subscriber : subscribers) {
+    signal.connect([s = &subscriber](const std::string& id, int state) {
+      s->outputStateChanged(id, state);
+    });
+  }
+  Subscriber transient;
+
+  for (auto _: state) {
+    const auto key
+      = signal.connect([s = &transient](const std::string& id, int state) {
+          s->outputStateChanged(id, state);
+        });
+    signal.disconnect(key);
+  }
+}
+BENCHMARK(BM_MapSignalConnectDisconnect)->Apply(subscriber_args);
+
+// Every tenth subscriber disconnects itself during the broadcast, as when a
+// send error drops a client; the next iteration reconnects them.
+void BM_SignalEmitWithDisconnects(benchmark::State& state) {
+  Signal<const std::string&, int> signal;
+  const auto count = static_cast<size_t>(state.range(0));
+  std::vector<Subscriber> subscribers(count);
+  std::vector<Connection> connections(count);
+  const std::string id("stream_id");
+
+  for (auto _: state) {
+    state.PauseTiming();
+    for (size_t i = 0; i < count; ++i) {
+      if (connections[i]) {
+        continue;
+      }
+      auto* subscriber = &subscribers[i];
+      auto* connection = &connections[i];
+      const bool dropped = (i % 10 == 0);
+      *connection = signal.connect(
+        [=](const std::string& id, int state) {
+          subscriber->outputStateChanged(id, state);
+          if (dropped) {
+            (*connection)->disconnect();
+            connection->reset();
+          }
+        });
+    }
+    state.ResumeTiming();
+    emit signal(id, 1);
+  }
+  state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_SignalEmitWithDisconnects)->Apply(subscriber_args);
+
+}// namespace
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#include "Core/Clock.h"
+#include "Core/Config.h"
+#include "Core/PreviewManager.h"
+#include "Core/Signal.h"
+#include "dummy/Dummy.h"
+#include "dummy/DummySettings.h"
+
+#include <fmt/format.h>
+#include <asio.hpp>
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+namespace {
+
+// An hour of preview streams, paced by `PreviewManager`'s timers, with the
+// dummy's simulated capture latency and a steady stream of state-change
+// events; run in virtual time, so this measures the cost of the timers and
+// the code they drive rather than waiting for them.
+//
+// Arguments: scenes, subscribers (spread across the scenes, at 30, 15, and
+// 10 FPS)
+void BM_SimulatedPreviewHour(benchmark::State& state) {
+  const auto sceneCount = state.range(0);
+  const auto subscriberCount = state.range(1);
+  uint64_t frames = 0;
+  uint64_t handlers = 0;
+  for (auto _: state) {
+    SimulatedTime time;
+    auto context = std::make_shared<asio::io_context>();
+    DummySettings settings {
+      .outputs = DummySettings::makeOutputs(2),
+      .scenes = DummySettings::makeScenes(sceneCount),
+      .frameWidth = 16,
+      .frameHeight = 9,
+      .eventsPerSecond = 100,
+    };
+    auto dummy = std::make_shared<Dummy>(
+      context, Config {.password = "benchmark"}, std::move(settings));
+    auto previews = std::make_shared<PreviewManager>(context, dummy);
+
+    std::vector<ScopedConnection> subscriptions;
+    for (int64_t i = 0; i < subscriberCount; ++i) {
+      subscriptions.emplace_back(previews->subscribe(
+        fmt::format("scene_{}", i % sceneCount), 30 / (1 + (i % 3)), 0,
+        [&frames](const auto&) { ++frames; }));
+    }
+    handlers += time.runFor(*context, std::chrono::hours(1));
+
+    // Let the streams and the event storm see that they're finished before
+    // their timers are destroyed
+    subscriptions.clear();
+    previews.reset();
+    dummy.reset();
+    handlers += time.runFor(*context, std::chrono::seconds(1));
+  }
+  state.counters["frames"]
+    = benchmark::Counter(frames, benchmark::Counter::kAvgIterations);
+  state.counters["handlers"]
+    = benchmark::Counter(handlers, benchmark::Counter::kAvgIterations);
+}
+
+}// namespace
+
+BENCHMARK(BM_SimulatedPreviewHour)
+  ->ArgNames({"scenes", "subscribers"})
+  ->Args({1, 1})
+  ->Args({10, 100})
+  ->Unit(benchmark::kMillisecond);
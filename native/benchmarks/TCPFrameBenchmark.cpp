@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#include "Core/Signal.h"
+#include "Core/TCPConnection.h"
+
+#include <asio.hpp>
+#include <benchmark/benchmark.h>
+#include <fmt/format.h>
+
+#include <string>
+
+namespace {
+
+// Written to the socket at once, so that `TCPConnection` usually finds several
+// frames already buffered, as it does for a busy client
+const size_t FRAMES_PER_BATCH = 16;
+
+// Splitting a byte stream into `Content-Length` frames and emitting
+// `messageReceived`, over a loopback socket on a single thread; the socket
+// reads are included, as the parsing is interleaved with them.
+//
+// Argument: payload size
+void BM_TCPFrameParsing(benchmark::State& state) {
+  asio::io_context context;
+  asio::ip::tcp::acceptor acceptor(
+    context, asio::ip::tcp::endpoint(asio::ip::address_v4::loopback(), 0));
+  asio::ip::tcp::socket client(context);
+  client.connect(acceptor.local_endpoint());
+  TCPConnection connection(asio::make_strand(context));
+  acceptor.accept(connection.socket());
+
+  size_t received = 0;
+  ScopedConnection receivedConnection(connection.messageReceived.connect(
+    [&received](const std::string&) { ++received; }));
+  connection.startWaitingForMessage();
+
+  const std::string payload(state.range(0), 'x');
+  std::string batch;
+  for (size_t i = 0; i < FRAMES_PER_BATCH; ++i) {
+    batch += fmt::format(
+      "Content-Length: {}\r\n\r\n{}", payload.size(), payload);
+  }
+
+  for (auto _: state) {
+    received = 0;
+    bool written = false;
+    asio::async_write(
+      client, asio::buffer(batch),
+      [&written](const asio::error_code&, size_t) { written = true; });
+    // The read loop always has an operation outstanding, so this never runs
+    // out of work
+    while (!(written && received == FRAMES_PER_BATCH)) {
+      context.run_one();
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * FRAMES_PER_BATCH);
+  state.SetBytesProcessed(state.iterations() * batch.size());
+}
+
+}// namespace
+
+BENCHMARK(BM_TCPFrameParsing)
+  ->ArgName("bytes")
+  ->RangeMultiplier(16)
+  ->Range(64, 64 * 1024);
@@ -0,0 +1,23 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#include "AllocationBudget.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdlib>
+
+// `BENCHMARK_MAIN()`, but fails if an allocation budget was exceeded
+int main(int argc, char** argv) {
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return EXIT_FAILURE;
+  }
+  benchmark::RunSpecifiedBenchmarks();
+  return was_allocation_budget_exceeded() ? EXIT_FAILURE : EXIT_SUCCESS;
+}
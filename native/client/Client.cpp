@@ -0,0 +1,434 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#include "Client.h"
+
+#include "Core/HandshakeMessages.h"
+#include "Core/Logger.h"
+#include "Core/TCPConnection.h"
+
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <system_error>
+
+using json = nlohmann::json;
+
+namespace {
+const size_t ABYTES = crypto_secretstream_xchacha20poly1305_ABYTES;
+
+void throw_if_destroyed(const std::weak_ptr<bool>& alive) {
+  if (alive.expired()) {
+    throw std::runtime_error("The client was destroyed");
+  }
+}
+
+// GCC fails to compile braced initializer lists in `co_await` expressions
+json id_params(const std::string& id) {
+  return {{"id", id}};
+}
+}// namespace
+
+RpcError::RpcError(int code, const std::string& message, json data)
+  : std::runtime_error(message), mCode(code), mData(std::move(data)) {
+}
+
+int RpcError::getCode() const {
+  return mCode;
+}
+
+const json& RpcError::getData() const {
+  return mData;
+}
+
+Client::Client(
+  const std::shared_ptr<asio::io_context>& context,
+  ClientConfig config)
+  : mContext(context),
+    mStrand(asio::make_strand(*context)),
+    mConfig(std::move(config)) {
+  if (sodium_init() < 0) {
+    throw std::runtime_error("Failed to initialize libsodium");
+  }
+}
+
+Client::~Client() {
+  mWantConnection = false;
+  mAlive.reset();
+  failPending();
+  sodium_memzero(mPsk, sizeof(mPsk));
+  sodium_memzero(&mPushState, sizeof(mPushState));
+  sodium_memzero(&mPullState, sizeof(mPullState));
+}
+
+const Client::Strand& Client::getStrand() const {
+  return mStrand;
+}
+
+bool Client::isConnected() const {
+  return mState == State::AUTHENTICATED;
+}
+
+asio::awaitable<void> Client::connect() {
+  const std::weak_ptr<bool> alive(mAlive);
+  mWantConnection = true;
+  closeConnection();
+  failPending();
+  mState = State::CONNECTING;
+
+  std::unique_ptr<TCPConnection> connection;
+  std::exception_ptr error;
+  try {
+    connection = co_await openConnection();
+  } catch (...) {
+    error = std::current_exception();
+  }
+  throw_if_destroyed(alive);
+  if (mState != State::CONNECTING) {
+    throw std::runtime_error("Disconnected while connecting");
+  }
+  if (error) {
+    mState = State::DISCONNECTED;
+    std::rethrow_exception(error);
+  }
+
+  // Handlers that were queued before a connection was replaced are ignored
+  const auto raw = connection.get();
+  connection->messageReceived.connect(
+    [this, raw, alive](const std::string& message) {
+      if (!alive.expired() && mConnection.get() == raw) {
+        messageReceived(message);
+      }
+    });
+  connection->disconnected.connect([this, raw, alive]() {
+    if (!alive.expired() && mConnection.get() == raw) {
+      connectionLost();
+    }
+  });
+  mConnection = std::move(connection);
+  mConnection->startWaitingForMessage();
+
+  ClientHelloBox box;
+  ClientHelloMessage hello;
+  crypto_secretstream_xchacha20poly1305_keygen(mServerToClientKey);
+  memcpy(box.serverToClientKey, mServerToClientKey, sizeof(mServerToClientKey));
+  randombytes_buf(hello.pwhashSalt, sizeof(hello.pwhashSalt));
+  randombytes_buf(hello.secretBoxNonce, sizeof(hello.secretBoxNonce));
+  // Blocks the strand for as long as it blocks the server's
+  if (
+    crypto_pwhash(
+      mPsk, sizeof(mPsk), mConfig.password.data(), mConfig.password.size(),
+      hello.pwhashSalt, crypto_pwhash_OPSLIMIT_INTERACTIVE,
+      crypto_pwhash_MEMLIMIT_INTERACTIVE, crypto_pwhash_ALG_DEFAULT)
+    != 0) {
+    closeConnection();
+    mState = State::DISCONNECTED;
+    throw std::runtime_error("crypto_pwhash failed; out of memory?");
+  }
+  crypto_secretbox_easy(
+    hello.secretBox, reinterpret_cast<const uint8_t*>(&box), sizeof(box),
+    hello.secretBoxNonce, mPsk);
+  sodium_memzero(&box, sizeof(box));
+
+  mState = State::WAITING_FOR_SERVER_HELLO;
+  auto handshake = mHandshake.emplace();
+  mConnection->sendMessage(
+    std::string(reinterpret_cast<const char*>(&hello), sizeof(hello)));
+  if (!co_await handshake.async_wait()) {
+    throw std::runtime_error(
+      "The handshake failed; check the password and port");
+  }
+}
+
+asio::awaitable<std::unique_ptr<TCPConnection>> Client::openConnection() {
+  auto connection = std::make_unique<TCPConnection>(mStrand);
+  asio::ip::tcp::resolver resolver(mStrand);
+  const auto endpoints = co_await resolver.async_resolve(
+    mConfig.host, std::to_string(mConfig.port), asio::use_awaitable);
+  co_await asio::async_connect(
+    connection->socket(), endpoints, asio::use_awaitable);
+  asio::error_code ec;
+  connection->socket().set_option(asio::ip::tcp::no_delay(true), ec);
+  co_return connection;
+}
+
+void Client::disconnect() {
+  mWantConnection = false;
+  if (mState != State::DISCONNECTED) {
+    connectionLost();
+  }
+}
+
+asio::awaitable<json> Client::call(const std::string& method, json params) {
+  if (mState != State::AUTHENTICATED) {
+    throw std::runtime_error("Not connected");
+  }
+  const auto id = mNextId++;
+  OneShot<json> response;
+  mPending.emplace(id, response);
+
+  json request = json::object();
+  request["jsonrpc"] = "2.0";
+  request["id"] = id;
+  request["method"] = method;
+  request["params"] = std::move(params);
+  sendEncrypted(request.dump());
+
+  // Don't touch `this` after this point; we may have been destroyed
+  const auto message = co_await response.async_wait();
+  if (message.is_null()) {
+    throw std::runtime_error("Disconnected before receiving a response");
+  }
+  if (message.contains("error")) {
+    const auto& error = message["error"];
+    throw RpcError(
+      error.value("code", 0), error.value("message", std::string()),
+      error.value("data", json()));
+  }
+  co_return message.value("result", json());
+}
+
+void Client::notify(const std::string& method, json params) {
+  if (mState != State::AUTHENTICATED) {
+    throw std::runtime_error("Not connected");
+  }
+  json notification = json::object();
+  notification["jsonrpc"] = "2.0";
+  notification["method"] = method;
+  notification["params"] = std::move(params);
+  sendEncrypted(notification.dump());
+}
+
+asio::awaitable<std::vector<Output>> Client::getOutputs() {
+  const auto result = co_await call("outputs/get");
+  std::vector<Output> outputs;
+  for (const auto& output : result) {
+    outputs.push_back(Output::fromJson(output));
+  }
+  co_return outputs;
+}
+
+asio::awaitable<void> Client::startOutput(const std::string& id) {
+  co_await call("outputs/start", id_params(id));
+}
+
+asio::awaitable<void> Client::stopOutput(const std::string& id) {
+  co_await call("outputs/stop", id_params(id));
+}
+
+asio::awaitable<std::vector<Scene>> Client::getScenes() {
+  const auto result = co_await call("scenes/get");
+  std::vector<Scene> scenes;
+  for (const auto& scene : result) {
+    scenes.push_back(Scene::fromJson(scene));
+  }
+  co_return scenes;
+}
+
+asio::awaitable<bool> Client::activateScene(const std::string& id) {
+  const auto result = co_await call("scenes/activate", id_params(id));
+  co_return result.is_boolean() && result.get<bool>();
+}
+
+void Client::messageReceived(const std::string& message) {
+  switch (mState) {
+    case State::WAITING_FOR_SERVER_HELLO:
+      serverHelloReceived(message);
+      return;
+    case State::WAITING_FOR_HELLO:
+    case State::AUTHENTICATED:
+      rpcMessageReceived(message);
+      return;
+    case State::DISCONNECTED:
+    case State::CONNECTING:
+      return;
+  }
+}
+
+void Client::serverHelloReceived(const std::string& message) {
+  if (message.size() != sizeof(ServerHelloMessage)) {
+    Logger::debug("Invalid ServerHello size: {}", message.size());
+    connectionLost();
+    return;
+  }
+  const auto hello
+    = reinterpret_cast<const ServerHelloMessage*>(message.data());
+  ServerHelloBox box;
+  if (
+    crypto_secretbox_open_easy(
+      reinterpret_cast<uint8_t*>(&box), hello->secretBox,
+      sizeof(hello->secretBox), hello->secretBoxNonce, mPsk)
+    != 0) {
+    Logger::debug("Failed to open the ServerHello box");
+    connectionLost();
+    return;
+  }
+  sodium_memzero(mPsk, sizeof(mPsk));
+  const auto pullResult = crypto_secretstream_xchacha20poly1305_init_pull(
+    &mPullState, hello->serverToClientHeader, mServerToClientKey);
+  sodium_memzero(mServerToClientKey, sizeof(mServerToClientKey));
+  if (pullResult != 0) {
+    Logger::debug("Invalid server-to-client stream header");
+    sodium_memzero(&box, sizeof(box));
+    connectionLost();
+    return;
+  }
+
+  ClientReadyMessage ready;
+  crypto_secretstream_xchacha20poly1305_init_push(
+    &mPushState, ready.clientToServerHeader, box.clientToServerKey);
+  crypto_auth(
+    ready.authenticationMac, ready.clientToServerHeader,
+    sizeof(ready.clientToServerHeader), box.authenticationKey);
+  sodium_memzero(&box, sizeof(box));
+  mState = State::WAITING_FOR_HELLO;
+  mConnection->sendMessage(
+    std::string(reinterpret_cast<const char*>(&ready), sizeof(ready)));
+}
+
+void Client::rpcMessageReceived(const std::string& message) {
+  if (message.size() < ABYTES) {
+    connectionLost();
+    return;
+  }
+  mPlaintext.resize(message.size() - ABYTES);
+  unsigned long long plen;
+  unsigned char tag;
+  if (
+    crypto_secretstream_xchacha20poly1305_pull(
+      &mPullState, reinterpret_cast<uint8_t*>(mPlaintext.data()), &plen, &tag,
+      reinterpret_cast<const uint8_t*>(message.data()), message.size(), nullptr,
+      0)
+    != 0) {
+    Logger::debug("Failed to decrypt a message from the server");
+    connectionLost();
+    return;
+  }
+  mPlaintext.resize(plen);
+  auto parsed = json::parse(mPlaintext, nullptr, /* exceptions = */ false);
+  if (!parsed.is_object()) {
+    Logger::debug("Invalid JSON from the server");
+    connectionLost();
+    return;
+  }
+
+  const auto method = parsed.value("method", std::string());
+  if (method.empty()) {
+    if (!parsed["id"].is_number_unsigned()) {
+      return;
+    }
+    const auto it = mPending.find(parsed["id"].get<uint64_t>());
+    if (it == mPending.end()) {
+      return;
+    }
+    auto response = it->second;
+    mPending.erase(it);
+    response.resolve(std::move(parsed));
+    return;
+  }
+
+  if (mState == State::WAITING_FOR_HELLO) {
+    if (method != "hello") {
+      Logger::debug("Expected hello, got {}", method);
+      connectionLost();
+      return;
+    }
+    mState = State::AUTHENTICATED;
+    mHandshake->resolve(true);
+    mHandshake.reset();
+    emit connected();
+    return;
+  }
+
+  const auto params = parsed.value("params", json::object());
+  emit notificationReceived(method, params);
+  if (method == "outputs/stateChanged") {
+    emit outputStateChanged(
+      params.value("id", std::string()),
+      Output::stateFromString(params.value("state", std::string())));
+    return;
+  }
+  if (method == "scenes/currentSceneChanged") {
+    emit currentSceneChanged(params.value("id", std::string()));
+    return;
+  }
+}
+
+void Client::sendEncrypted(const std::string& plaintext) {
+  mCiphertext.resize(plaintext.size() + ABYTES);
+  unsigned long long clen;
+  crypto_secretstream_xchacha20poly1305_push(
+    &mPushState, reinterpret_cast<uint8_t*>(mCiphertext.data()), &clen,
+    reinterpret_cast<const uint8_t*>(plaintext.data()), plaintext.size(),
+    nullptr, 0, 0);
+  mCiphertext.resize(clen);
+  mConnection->sendMessage(mCiphertext);
+}
+
+void Client::connectionLost() {
+  const bool wasAuthenticated = mState == State::AUTHENTICATED;
+  mState = State::DISCONNECTED;
+  closeConnection();
+  failPending();
+  sodium_memzero(&mPushState, sizeof(mPushState));
+  sodium_memzero(&mPullState, sizeof(mPullState));
+  if (!wasAuthenticated) {
+    return;
+  }
+  emit disconnected();
+  if (mWantConnection && mConfig.reconnect && !mReconnecting) {
+    asio::co_spawn(mStrand, reconnect(mAlive), asio::detached);
+  }
+}
+
+void Client::closeConnection() {
+  if (!mConnection) {
+    return;
+  }
+  mConnection->disconnect();
+  // We may be in one of its signal handlers
+  asio::post(mStrand, [connection = std::move(mConnection)]() {});
+}
+
+void Client::failPending() {
+  if (mHandshake) {
+    mHandshake->resolve(false);
+    mHandshake.reset();
+  }
+  auto pending = std::move(mPending);
+  mPending.clear();
+  for (auto& [id, response] : pending) {
+    response.resolve(nullptr);
+  }
+}
+
+asio::awaitable<void> Client::reconnect(std::weak_ptr<bool> alive) {
+  mReconnecting = true;
+  auto delay = mConfig.minReconnectDelay;
+  while (true) {
+    asio::steady_timer timer(mStrand, delay);
+    co_await timer.async_wait(asio::use_awaitable);
+    if (alive.expired()) {
+      co_return;
+    }
+    if (!mWantConnection || mState != State::DISCONNECTED) {
+      break;
+    }
+    try {
+      co_await connect();
+      break;
+    } catch (const std::exception& e) {
+      if (alive.expired()) {
+        co_return;
+      }
+      Logger::debug("Failed to reconnect: {}", e.what());
+    }
+    delay = std::min(delay * 2, mConfig.maxReconnectDelay);
+  }
+  mReconnecting = false;
+}
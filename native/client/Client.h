@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include "Core/OneShot.h"
+#include "Core/Output.h"
+#include "Core/Scene.h"
+#include "Core/Signal.h"
+
+#include <asio.hpp>
+#include <nlohmann/json.hpp>
+#include <sodium.h>
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class TCPConnection;
+
+struct ClientConfig {
+  std::string host = "localhost";
+  uint16_t port = 9001;
+  std::string password;
+  // Reconnect with exponential backoff if the connection is lost after
+  // `connect()` succeeded
+  bool reconnect = true;
+  std::chrono::milliseconds minReconnectDelay {250};
+  std::chrono::milliseconds maxReconnectDelay {30000};
+};
+
+// The server returned a JSON-RPC error
+class RpcError : public std::runtime_error {
+ public:
+  RpcError(int code, const std::string& message, nlohmann::json data);
+  int getCode() const;
+  const nlohmann::json& getData() const;
+
+ private:
+  int mCode;
+  nlohmann::json mData;
+};
+
+/** A native client for `handshake_protocol.md` and `rpc_protocol.md`.
+ *
+ * Connects over TCP, using the server's own `TCPConnection`. Any number of
+ * requests can be in flight at once; responses are matched to them by id.
+ *
+ * All methods must be called from, and all signals are emitted on, the
+ * client's strand - for example, from coroutines started with
+ * `asio::co_spawn(client.getStrand(), ...)`. A client has no threads of its
+ * own, so many clients can share an `io_context`.
+ *
+ * Requests that are in flight when the connection is lost throw; they are not
+ * retried after reconnecting, as not every method is idempotent.
+ */
+class Client final {
+ public:
+  typedef asio::strand<asio::io_context::executor_type> Strand;
+
+  Client(const std::shared_ptr<asio::io_context>& context, ClientConfig config);
+  Client(const Client&) = delete;
+  ~Client();
+
+  const Strand& getStrand() const;
+  bool isConnected() const;
+
+  // Connects and completes the handshake; throws on failure, including an
+  // incorrect password.
+  asio::awaitable<void> connect();
+  // Does not reconnect afterwards
+  void disconnect();
+
+  // Returns the `result`, or throws `RpcError`.
+  asio::awaitable<nlohmann::json> call(
+    const std::string& method,
+    nlohmann::json params = nlohmann::json::object());
+
+  // Sends a JSON-RPC notification, which has no response; throws if not
+  // connected.
+  void notify(
+    const std::string& method,
+    nlohmann::json params = nlohmann::json::object());
+
+  asio::awaitable<std::vector<Output>> getOutputs();
+  asio::awaitable<void> startOutput(const std::string& id);
+  asio::awaitable<void> stopOutput(const std::string& id);
+  asio::awaitable<std::vector<Scene>> getScenes();
+  asio::awaitable<bool> activateScene(const std::string& id);
+
+  // Emitted after every successful handshake, including reconnections
+  Signal<> connected;
+  Signal<> disconnected;
+  // Every notification, including those that have their own signal below
+  Signal<const std::string&, const nlohmann::json&> notificationReceived;
+  Signal<const std::string&, OutputState> outputStateChanged;
+  Signal<const std::string&> currentSceneChanged;
+
+ private:
+  enum class State {
+    DISCONNECTED,
+    CONNECTING,
+    WAITING_FOR_SERVER_HELLO,
+    WAITING_FOR_HELLO,
+    AUTHENTICATED,
+  };
+
+  void messageReceived(const std::string& message);
+  void serverHelloReceived(const std::string& message);
+  void rpcMessageReceived(const std::string& message);
+  void sendEncrypted(const std::string& plaintext);
+  void connectionLost();
+  // Destroys the connection once its handlers have finished
+  void closeConnection();
+  // Fails the pending `connect()`, and resolves pending requests with a null
+  // response
+  void failPending();
+  asio::awaitable<void> reconnect(std::weak_ptr<bool> alive);
+  // Throws on failure
+  asio::awaitable<std::unique_ptr<TCPConnection>> openConnection();
+
+  std::shared_ptr<asio::io_context> mContext;
+  Strand mStrand;
+  ClientConfig mConfig;
+  State mState = State::DISCONNECTED;
+  bool mWantConnection = false;
+  bool mReconnecting = false;
+  std::unique_ptr<TCPConnection> mConnection;
+
+  // Handshake
+  uint8_t mPsk[crypto_secretbox_KEYBYTES];
+  uint8_t mServerToClientKey[crypto_secretstream_xchacha20poly1305_KEYBYTES];
+  std::optional<OneShot<bool>> mHandshake;
+
+  crypto_secretstream_xchacha20poly1305_state mPushState;
+  crypto_secretstream_xchacha20poly1305_state mPullState;
+
+  uint64_t mNextId = 0;
+  std::unordered_map<uint64_t, OneShot<nlohmann::json>> mPending;
+  // Reused for every message, as they are usually of similar sizes
+  std::string mCiphertext;
+  std::string mPlaintext;
+
+  // Expires when we're destroyed; checked by outstanding coroutines
+  std::shared_ptr<bool> mAlive = std::make_shared<bool>(true);
+};
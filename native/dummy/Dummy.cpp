@@ -8,8 +8,15 @@
 
 #include "Dummy.h"
 
+#include "Core/Base64.h"
+#include "Core/Clock.h"
 #include "Core/Config.h"
+#include "SyntheticFrames.h"
 
+#include <asio.hpp>
+
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 
 using namespace std;
@@ -17,10 +24,34 @@ using namespace std;
 Dummy::Dummy(
   std::shared_ptr<asio::io_context> ctx,
   const Config& config,
-  const std::vector<Output>& outputs
-): StreamingSoftware(ctx), mConfig(config) {
-  for (const auto& output : outputs) {
+  const std::vector<Output>& outputs,
+  const std::vector<Scene>& scenes
+): Dummy(ctx, config, DummySettings {.outputs = outputs, .scenes = scenes}) {
+}
+
+Dummy::Dummy(
+  std::shared_ptr<asio::io_context> ctx,
+  const Config& config,
+  DummySettings settings
+): StreamingSoftware(ctx),
+   mConfig(config),
+   mSettings(std::move(settings)),
+   mScenes(mSettings.scenes),
+   mRandom(mSettings.seed) {
+  for (const auto& output : mSettings.outputs) {
     mOutputs[output.id] = output;
+    mOutputIds.push_back(output.id);
+  }
+  for (size_t i = 0; i < mScenes.size(); ++i) {
+    mSceneIndices[mScenes[i].id] = i;
+    if (mScenes[i].active && !mActiveScene) {
+      mActiveScene = i;
+    } else {
+      mScenes[i].active = false;
+    }
+  }
+  if (mSettings.eventsPerSecond > 0) {
+    asio::co_spawn(*ctx, runEventStorm(mAlive), asio::detached);
   }
   emit initialized(config);
 }
@@ -33,7 +64,9 @@ Config Dummy::getConfiguration() const {
 }
 
 asio::awaitable<std::vector<Output>> Dummy::getOutputs() {
+  co_await simulateLatency(DummyCall::GET_OUTPUTS);
   std::vector<Output> ret;
+  std::scoped_lock lock(mMutex);
   ret.reserve(mOutputs.size());
   for (const auto& [id, output] : mOutputs) {
     ret.push_back(output);
@@ -44,18 +77,167 @@ asio::awaitable<std::vector<Output>> Dummy::getOutputs() {
 asio::awaitable<void> Dummy::startOutput(const std::string& id) {
   cout << "Starting output " << id << endl;
   setOutputState(id, OutputState::STARTING);
+  co_await simulateLatency(DummyCall::START_OUTPUT);
   setOutputState(id, OutputState::ACTIVE);
-  co_return;
 }
 
 asio::awaitable<void> Dummy::stopOutput(const std::string& id) {
   cout << "stopping output: " + id << endl;
   setOutputState(id, OutputState::STOPPING);
+  co_await simulateLatency(DummyCall::STOP_OUTPUT);
   setOutputState(id, OutputState::STOPPED);
-  co_return;
+}
+
+asio::awaitable<bool> Dummy::setOutputDelay(
+  const std::string& id,
+  int64_t seconds) {
+  co_await simulateLatency(DummyCall::SET_OUTPUT_DELAY);
+  std::scoped_lock lock(mMutex);
+  const auto it = mOutputs.find(id);
+  if (it == mOutputs.end() || seconds < 0) {
+    co_return false;
+  }
+  it->second.delaySeconds = seconds;
+  co_return true;
+}
+
+asio::awaitable<std::vector<Scene>> Dummy::getScenes() {
+  co_await simulateLatency(DummyCall::GET_SCENES);
+  std::vector<Scene> ret;
+  {
+    std::scoped_lock lock(mMutex);
+    ret = mScenes;
+  }
+  co_return ret;
+}
+
+asio::awaitable<bool> Dummy::activateScene(const std::string& id) {
+  co_await simulateLatency(DummyCall::ACTIVATE_SCENE);
+  co_return setActiveScene(id);
+}
+
+asio::awaitable<std::string> Dummy::getSceneThumbnailAsBase64Png(
+  const std::string& id) {
+  const auto image = co_await captureScene(id, 0);
+  co_return base64_encode(encodeImage(image, "image/png", -1));
+}
+
+asio::awaitable<void> Dummy::simulateLatency(DummyCall call) {
+  std::chrono::microseconds latency {0};
+  {
+    std::scoped_lock lock(mMutex);
+    const auto it = mSettings.latencies.find(call);
+    if (it != mSettings.latencies.end()) {
+      latency = it->second.sample(mRandom);
+    }
+  }
+  if (latency.count() == 0) {
+    co_return;
+  }
+  Timer timer(getIoContext(), latency);
+  co_await timer.async_wait(asio::use_awaitable);
+}
+
+Image Dummy::makeFrame(uint32_t maxDimension) {
+  // By default, 1080p with a small 'webcam' that changes every frame
+  uint32_t width = mSettings.frameWidth, height = mSettings.frameHeight;
+  if (maxDimension > 0 && maxDimension < std::max(width, height)) {
+    if (width >= height) {
+      height = std::max<uint32_t>(1, (height * maxDimension) / width);
+      width = maxDimension;
+    } else {
+      width = std::max<uint32_t>(1, (width * maxDimension) / height);
+      height = maxDimension;
+    }
+  }
+  return make_synthetic_frame(
+    width, height, mFrameNumber++, mSettings.frameChangeRatio);
+}
+
+asio::awaitable<Image> Dummy::captureScene(
+  const std::string& id,
+  uint32_t maxDimension) {
+  co_await simulateLatency(DummyCall::CAPTURE_SCENE);
+  co_return makeFrame(maxDimension);
+}
+
+asio::awaitable<void> Dummy::captureScenes(
+  const std::vector<std::string>& ids,
+  uint32_t maxDimension,
+  SceneCapturedCallback callback) {
+  co_await simulateLatency(DummyCall::CAPTURE_SCENE);
+  for (const auto& id : ids) {
+    callback(id, makeFrame(maxDimension));
+  }
 }
 
 void Dummy::setOutputState(const std::string& id, OutputState state) {
-  mOutputs[id].state = state;
+  {
+    std::scoped_lock lock(mMutex);
+    mOutputs[id].state = state;
+  }
   emit outputStateChanged(id, state);
 }
+
+bool Dummy::setActiveScene(const std::string& id) {
+  {
+    std::scoped_lock lock(mMutex);
+    const auto it = mSceneIndices.find(id);
+    if (it == mSceneIndices.end()) {
+      return false;
+    }
+    if (mActiveScene) {
+      mScenes[*mActiveScene].active = false;
+    }
+    mActiveScene = it->second;
+    mScenes[it->second].active = true;
+  }
+  emit currentSceneChanged(id);
+  return true;
+}
+
+asio::awaitable<void> Dummy::runEventStorm(std::weak_ptr<bool> alive) {
+  // Scheduled from the start rather than the previous event, so that the
+  // rate holds even if the io threads fall behind
+  const auto start = Clock::now();
+  const std::chrono::duration<double> period(1 / mSettings.eventsPerSecond);
+  Timer timer(getIoContext());
+  for (uint64_t i = 0;; ++i) {
+    timer.expires_at(
+      start
+      + std::chrono::duration_cast<Clock::duration>(
+        period * i));
+    co_await timer.async_wait(asio::use_awaitable);
+    if (alive.expired()) {
+      co_return;
+    }
+    emitRandomEvent(i);
+  }
+}
+
+void Dummy::emitRandomEvent(uint64_t eventNumber) {
+  const bool sceneEvent
+    = mOutputIds.empty() || (!mScenes.empty() && eventNumber % 2 == 0);
+  if (sceneEvent) {
+    if (mScenes.empty()) {
+      return;
+    }
+    std::string id;
+    {
+      std::scoped_lock lock(mMutex);
+      id = mScenes[mRandom() % mScenes.size()].id;
+    }
+    setActiveScene(id);
+    return;
+  }
+
+  std::string id;
+  OutputState state;
+  {
+    std::scoped_lock lock(mMutex);
+    id = mOutputIds[mRandom() % mOutputIds.size()];
+    state = mOutputs[id].state == OutputState::ACTIVE ? OutputState::STOPPED
+                                                       : OutputState::ACTIVE;
+  }
+  setOutputState(id, state);
+}
@@ -10,13 +10,31 @@
 
 #include "Core/Config.h"
 #include "Core/StreamingSoftware.h"
+#include "DummySettings.h"
 
+#include <atomic>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <unordered_map>
+
+/** A simulated OBS or XSplit, for development and load testing.
+ *
+ * See `DummySettings` for the number of outputs and scenes, call latencies,
+ * frames, and the event storm.
+ */
 class Dummy : public StreamingSoftware {
  public:
   Dummy(
     std::shared_ptr<asio::io_context> ctx,
     const Config& config,
-    const std::vector<Output>& outputs
+    const std::vector<Output>& outputs,
+    const std::vector<Scene>& scenes = {}
+  );
+  Dummy(
+    std::shared_ptr<asio::io_context> ctx,
+    const Config& config,
+    DummySettings settings
   );
   ~Dummy();
 
@@ -25,9 +43,42 @@ class Dummy : public StreamingSoftware {
   asio::awaitable<std::vector<Output>> getOutputs() override;
   asio::awaitable<void> startOutput(const std::string& id) override;
   asio::awaitable<void> stopOutput(const std::string& id) override;
+  asio::awaitable<bool> setOutputDelay(
+    const std::string& id,
+    int64_t seconds) override;
+
+  asio::awaitable<std::vector<Scene>> getScenes() override;
+  asio::awaitable<bool> activateScene(const std::string& id) override;
+  asio::awaitable<std::string> getSceneThumbnailAsBase64Png(
+    const std::string& id) override;
+  asio::awaitable<Image> captureScene(
+    const std::string& id,
+    uint32_t maxDimension) override;
+  asio::awaitable<void> captureScenes(
+    const std::vector<std::string>& ids,
+    uint32_t maxDimension,
+    SceneCapturedCallback callback) override;
 
  private:
   Config mConfig;
+  DummySettings mSettings;
+  // Called from every io thread
+  std::mutex mMutex;
   std::map<std::string, Output> mOutputs;
+  // For picking random outputs
+  std::vector<std::string> mOutputIds;
+  std::vector<Scene> mScenes;
+  std::unordered_map<std::string, size_t> mSceneIndices;
+  std::optional<size_t> mActiveScene;
+  std::mt19937_64 mRandom;
+  std::atomic<uint64_t> mFrameNumber = 0;
+  // Expires when we're destroyed; checked by the event storm
+  std::shared_ptr<bool> mAlive = std::make_shared<bool>(true);
+
+  asio::awaitable<void> simulateLatency(DummyCall call);
+  Image makeFrame(uint32_t maxDimension);
   void setOutputState(const std::string& id, OutputState state);
+  bool setActiveScene(const std::string& id);
+  asio::awaitable<void> runEventStorm(std::weak_ptr<bool> alive);
+  void emitRandomEvent(uint64_t eventNumber);
 };
@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#include "DummySettings.h"
+
+#include <fmt/format.h>
+
+#include <stdexcept>
+
+using json = nlohmann::json;
+
+namespace {
+const DummyCall ALL_CALLS[] = {
+  DummyCall::GET_OUTPUTS,    DummyCall::START_OUTPUT,
+  DummyCall::STOP_OUTPUT,    DummyCall::SET_OUTPUT_DELAY,
+  DummyCall::GET_SCENES,     DummyCall::ACTIVATE_SCENE,
+  DummyCall::CAPTURE_SCENE,
+};
+
+LatencyDistribution parse_latency(
+  const std::string& call,
+  const std::string& spec) {
+  const auto latency = LatencyDistribution::fromString(spec);
+  if (!latency) {
+    throw std::invalid_argument(
+      fmt::format("Invalid latency distribution for {}: '{}'", call, spec));
+  }
+  return *latency;
+}
+}// namespace
+
+std::vector<Output> DummySettings::makeOutputs(size_t count) {
+  std::vector<Output> ret;
+  ret.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    const bool isRecording = (i % 2) == 0;
+    ret.push_back({
+      .id = fmt::format("output_{}", i),
+      .name = fmt::format("{} {}", isRecording ? "Record" : "Stream", i),
+      .state = OutputState::STOPPED,
+      .type
+      = isRecording ? OutputType::LOCAL_RECORDING : OutputType::REMOTE_STREAM,
+    });
+  }
+  return ret;
+}
+
+std::vector<Scene> DummySettings::makeScenes(size_t count) {
+  std::vector<Scene> ret;
+  ret.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    ret.push_back({
+      .id = fmt::format("scene_{}", i),
+      .name = fmt::format("Scene {}", i),
+      .active = i == 0,
+    });
+  }
+  return ret;
+}
+
+void DummySettings::applyJson(const json& settings) {
+  if (!settings.is_object()) {
+    throw std::invalid_argument("Dummy settings must be a JSON object");
+  }
+  if (settings.contains("outputs")) {
+    const auto& value = settings["outputs"];
+    if (value.is_number_unsigned()) {
+      outputs = makeOutputs(value.get<size_t>());
+    } else {
+      outputs.clear();
+      for (const auto& output : value) {
+        outputs.push_back(Output::fromJson(output));
+      }
+    }
+  }
+  if (settings.contains("scenes")) {
+    const auto& value = settings["scenes"];
+    if (value.is_number_unsigned()) {
+      scenes = makeScenes(value.get<size_t>());
+    } else {
+      scenes.clear();
+      for (const auto& scene : value) {
+        scenes.push_back(Scene::fromJson(scene));
+      }
+    }
+  }
+  if (settings.contains("latency")) {
+    for (const auto& [name, spec] : settings["latency"].items()) {
+      const auto call = callFromString(name);
+      if (!call) {
+        throw std::invalid_argument(fmt::format("Unknown call '{}'", name));
+      }
+      latencies[*call] = parse_latency(name, spec.get<std::string>());
+    }
+  }
+  if (settings.contains("frame")) {
+    const auto& frame = settings["frame"];
+    frameWidth = frame.value("width", frameWidth);
+    frameHeight = frame.value("height", frameHeight);
+    frameChangeRatio = frame.value("changeRatio", frameChangeRatio);
+  }
+  eventsPerSecond = settings.value("eventsPerSecond", eventsPerSecond);
+  seed = settings.value("seed", seed);
+
+  if (frameWidth == 0 || frameHeight == 0) {
+    throw std::invalid_argument("Frames must be at least 1x1");
+  }
+  if (eventsPerSecond < 0) {
+    throw std::invalid_argument("eventsPerSecond must not be negative");
+  }
+}
+
+void DummySettings::applyLatency(const std::string& spec) {
+  const auto equals = spec.find('=');
+  const auto name = spec.substr(0, equals);
+  const auto call = callFromString(name);
+  if (equals == std::string::npos || !call) {
+    throw std::invalid_argument(
+      fmt::format("Expected CALL=DISTRIBUTION, got '{}'", spec));
+  }
+  latencies[*call] = parse_latency(name, spec.substr(equals + 1));
+}
+
+std::string DummySettings::callToString(DummyCall call) {
+  switch (call) {
+    case DummyCall::GET_OUTPUTS:
+      return "getOutputs";
+    case DummyCall::START_OUTPUT:
+      return "startOutput";
+    case DummyCall::STOP_OUTPUT:
+      return "stopOutput";
+    case DummyCall::SET_OUTPUT_DELAY:
+      return "setOutputDelay";
+    case DummyCall::GET_SCENES:
+      return "getScenes";
+    case DummyCall::ACTIVATE_SCENE:
+      return "activateScene";
+    case DummyCall::CAPTURE_SCENE:
+      return "captureScene";
+  }
+  return "unknown";
+}
+
+std::optional<DummyCall> DummySettings::callFromString(
+  const std::string& name) {
+  for (const auto call : ALL_CALLS) {
+    if (name == callToString(call)) {
+      return call;
+    }
+  }
+  return {};
+}
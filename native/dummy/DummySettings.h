@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include "Core/Output.h"
+#include "Core/Scene.h"
+#include "LatencyDistribution.h"
+
+#include <nlohmann/json.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+// The `StreamingSoftware` calls that `Dummy` can delay
+enum class DummyCall {
+  GET_OUTPUTS,
+  START_OUTPUT,
+  STOP_OUTPUT,
+  SET_OUTPUT_DELAY,
+  GET_SCENES,
+  ACTIVATE_SCENE,
+  // Thumbnails and previews, including `captureScenes()`
+  CAPTURE_SCENE,
+};
+
+/** How `Dummy` simulates OBS or XSplit.
+ *
+ * The defaults complete every call instantly, apart from captures, which wait
+ * three frames like OBS.
+ */
+struct DummySettings {
+  std::vector<Output> outputs;
+  std::vector<Scene> scenes;
+  std::map<DummyCall, LatencyDistribution> latencies {
+    {DummyCall::CAPTURE_SCENE,
+     LatencyDistribution::fixed(std::chrono::milliseconds(50))},
+  };
+
+  // Synthetic frames for thumbnails and previews; see `make_synthetic_frame()`
+  uint32_t frameWidth = 1920;
+  uint32_t frameHeight = 1080;
+  float frameChangeRatio = 0.05f;
+
+  // Emit this many `outputStateChanged` and `currentSceneChanged` events per
+  // second, alternately, for random outputs and scenes; 0 to disable.
+  double eventsPerSecond = 0;
+  // For latencies and events
+  uint64_t seed = 0;
+
+  // "output_0", "output_1", ...; alternately recordings and streams
+  static std::vector<Output> makeOutputs(size_t count);
+  // "scene_0", "scene_1", ...; the first is active
+  static std::vector<Scene> makeScenes(size_t count);
+
+  /* Overrides the settings that are present, for example:
+   *
+   * {
+   *   "outputs": 1000,
+   *   "scenes": [{"id": "a", "name": "A", "active": true}],
+   *   "latency": {"getOutputs": "uniform:1,5", "captureScene": "normal:50,10"},
+   *   "frame": {"width": 1280, "height": 720, "changeRatio": 0.1},
+   *   "eventsPerSecond": 100,
+   *   "seed": 42
+   * }
+   *
+   * Throws `std::invalid_argument` or `nlohmann::json::exception`.
+   */
+  void applyJson(const nlohmann::json&);
+  // Parses `CALL=DISTRIBUTION`, e.g. `activateScene=fixed:20`; throws
+  // `std::invalid_argument`.
+  void applyLatency(const std::string& spec);
+
+  static std::string callToString(DummyCall);
+  static std::optional<DummyCall> callFromString(const std::string&);
+};
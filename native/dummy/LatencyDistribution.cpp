@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#include "LatencyDistribution.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+LatencyDistribution::LatencyDistribution()
+  : LatencyDistribution(Kind::FIXED, 0, 0) {
+}
+
+LatencyDistribution::LatencyDistribution(Kind kind, double a, double b)
+  : mKind(kind), mA(a), mB(b) {
+}
+
+LatencyDistribution LatencyDistribution::fixed(
+  std::chrono::milliseconds latency) {
+  return LatencyDistribution(Kind::FIXED, latency.count(), 0);
+}
+
+std::optional<LatencyDistribution> LatencyDistribution::fromString(
+  const std::string& spec) {
+  const auto colon = spec.find(':');
+  const auto kind
+    = colon == std::string::npos ? std::string("fixed") : spec.substr(0, colon);
+  const auto params
+    = colon == std::string::npos ? spec : spec.substr(colon + 1);
+  const auto comma = params.find(',');
+
+  double a, b = 0;
+  try {
+    size_t used = 0;
+    a = std::stod(params.substr(0, comma), &used);
+    if (used != params.substr(0, comma).size()) {
+      return {};
+    }
+    if (comma != std::string::npos) {
+      b = std::stod(params.substr(comma + 1), &used);
+      if (used != params.size() - (comma + 1)) {
+        return {};
+      }
+    }
+  } catch (const std::logic_error&) {
+    return {};
+  }
+  if (!(std::isfinite(a) && std::isfinite(b) && a >= 0 && b >= 0)) {
+    return {};
+  }
+
+  const bool hasB = comma != std::string::npos;
+  if (kind == "fixed" && !hasB) {
+    return LatencyDistribution(Kind::FIXED, a, 0);
+  }
+  if (kind == "uniform" && hasB && a <= b) {
+    return LatencyDistribution(Kind::UNIFORM, a, b);
+  }
+  if (kind == "normal" && hasB) {
+    return LatencyDistribution(Kind::NORMAL, a, b);
+  }
+  if (kind == "exponential" && !hasB) {
+    return LatencyDistribution(Kind::EXPONENTIAL, a, 0);
+  }
+  return {};
+}
+
+std::string LatencyDistribution::toString() const {
+  switch (mKind) {
+    case Kind::FIXED:
+      return fmt::format("fixed:{}", mA);
+    case Kind::UNIFORM:
+      return fmt::format("uniform:{},{}", mA, mB);
+    case Kind::NORMAL:
+      return fmt::format("normal:{},{}", mA, mB);
+    case Kind::EXPONENTIAL:
+      return fmt::format("exponential:{}", mA);
+  }
+  return {};
+}
+
+std::chrono::microseconds LatencyDistribution::sample(
+  std::mt19937_64& random) const {
+  double ms = 0;
+  switch (mKind) {
+    case Kind::FIXED:
+      ms = mA;
+      break;
+    case Kind::UNIFORM:
+      ms = std::uniform_real_distribution<double>(mA, mB)(random);
+      break;
+    case Kind::NORMAL:
+      ms = mB > 0 ? std::normal_distribution<double>(mA, mB)(random) : mA;
+      break;
+    case Kind::EXPONENTIAL:
+      ms = mA > 0 ? std::exponential_distribution<double>(1 / mA)(random) : 0;
+      break;
+  }
+  return std::chrono::microseconds(
+    static_cast<int64_t>(std::max(0.0, ms) * 1000));
+}
@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <optional>
+#include <random>
+#include <string>
+
+/** Simulated latencies for a `Dummy` call.
+ *
+ * Written as `fixed:MS`, `uniform:MIN_MS,MAX_MS`, `normal:MEAN_MS,STDDEV_MS`,
+ * or `exponential:MEAN_MS`; a bare number is the same as `fixed:`. Samples
+ * are never negative.
+ */
+class LatencyDistribution {
+ public:
+  // Always zero
+  LatencyDistribution();
+  static LatencyDistribution fixed(std::chrono::milliseconds latency);
+  static std::optional<LatencyDistribution> fromString(const std::string&);
+  std::string toString() const;
+
+  std::chrono::microseconds sample(std::mt19937_64& random) const;
+
+ private:
+  enum class Kind {
+    FIXED,
+    UNIFORM,
+    NORMAL,
+    EXPONENTIAL,
+  };
+  LatencyDistribution(Kind kind, double a, double b);
+
+  Kind mKind;
+  // In milliseconds; the meaning depends on `mKind`
+  double mA;
+  double mB;
+};
@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#include "SyntheticFrames.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+// xorshift64*: fast, and good enough to defeat compression and tile hashing
+uint64_t next_random(uint64_t& state) {
+  state ^= state >> 12;
+  state ^= state << 25;
+  state ^= state >> 27;
+  return state * 0x2545f4914f6cdd1dULL;
+}
+}// namespace
+
+Image make_synthetic_frame(
+  uint32_t width,
+  uint32_t height,
+  uint64_t frameNumber,
+  float changeRatio) {
+  Image image;
+  image.width = width;
+  image.height = height;
+  image.rgba.resize(size_t(width) * height * 4);
+
+  for (uint32_t y = 0; y < height; ++y) {
+    auto row = &image.rgba[size_t(y) * width * 4];
+    for (uint32_t x = 0; x < width; ++x) {
+      row[x * 4] = uint8_t((x * 255) / std::max<uint32_t>(width - 1, 1));
+      row[x * 4 + 1] = uint8_t((y * 255) / std::max<uint32_t>(height - 1, 1));
+      row[x * 4 + 2] = 0x80;
+      row[x * 4 + 3] = 0xff;
+    }
+  }
+
+  // Same aspect ratio as the frame, anchored in the bottom-right corner
+  const auto scale = std::sqrt(std::clamp(changeRatio, 0.0f, 1.0f));
+  const auto noiseWidth = uint32_t(std::lround(width * scale));
+  const auto noiseHeight = uint32_t(std::lround(height * scale));
+  uint64_t state = (frameNumber + 1) * 0x9e3779b97f4a7c15ULL;
+  for (uint32_t y = height - noiseHeight; y < height; ++y) {
+    auto row = &image.rgba[size_t(y) * width * 4];
+    for (uint32_t x = width - noiseWidth; x < width; x += 2) {
+      const auto bits = next_random(state);
+      for (uint32_t i = 0; i < 2 && x + i < width; ++i) {
+        auto pixel = &row[(x + i) * 4];
+        pixel[0] = uint8_t(bits >> (i * 24));
+        pixel[1] = uint8_t(bits >> (i * 24 + 8));
+        pixel[2] = uint8_t(bits >> (i * 24 + 16));
+      }
+    }
+  }
+
+  return image;
+}
@@ -0,0 +1,25 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include "Core/Image.h"
+
+#include <cstdint>
+
+/** A deterministic stand-in for a real scene.
+ *
+ * Frames are a static gradient 'background', with a rectangle of noise - for
+ * example, a webcam - that changes every frame; `changeRatio` is the fraction
+ * of the frame covered by the noise, from 0.0 to 1.0.
+ */
+Image make_synthetic_frame(
+  uint32_t width,
+  uint32_t height,
+  uint64_t frameNumber,
+  float changeRatio);
@@ -7,11 +7,24 @@
  */
 
 #include "Core/Config.h"
+#include "Core/FaultInjectingConnection.h"
+#include "Core/FlightRecorder.h"
+#include "Core/Logger.h"
 #include "Core/Output.h"
 #include "Core/Plugin.h"
+#include "Core/Scene.h"
+#include "Core/SessionRecorder.h"
 #include "Dummy.h"
+#include "DummySettings.h"
 
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <fstream>
 #include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
 
 using namespace std;
 
@@ -22,23 +35,125 @@ int main(int argc, char** argv) {
     .tcpPort = 9001,
     .webSocketPort = 9002
   };
-  const std::vector<Output> outputs {
-    {
-      .id = "record_id",
-      .name = "Record",
-      .state = OutputState::STOPPED,
-      .type = OutputType::LOCAL_RECORDING,
+  DummySettings settings {
+    .outputs = {
+      {
+        .id = "record_id",
+        .name = "Record",
+        .state = OutputState::STOPPED,
+        .type = OutputType::LOCAL_RECORDING,
+      },
+      {
+        .id = "stream_id",
+        .name = "Stream",
+        .state = OutputState::STOPPED,
+        .type = OutputType::REMOTE_STREAM,
+      }
+    },
+    .scenes = {
+      { .id = "scene_1", .name = "Scene 1", .active = true },
+      { .id = "scene_2", .name = "Scene 2", .active = false },
+      { .id = "scene_3", .name = "Scene 3", .active = false },
     },
-    {
-      .id = "stream_id",
-      .name = "Stream",
-      .state = OutputState::STOPPED,
-      .type = OutputType::REMOTE_STREAM,
-    }
   };
   // clang-format on
+  unsigned int threads = Plugin::getDefaultThreadCount();
+  std::string flightRecorderPath;
+  std::string sessionsPath;
+  std::optional<FaultInjection> faults;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg(argv[i]);
+    if (arg == "--threads" && i + 1 < argc) {
+      threads = std::stoul(argv[++i]);
+      continue;
+    }
+    if (arg == "--flight-recorder" && i + 1 < argc) {
+      flightRecorderPath = argv[++i];
+      continue;
+    }
+    if (arg == "--record-sessions" && i + 1 < argc) {
+      sessionsPath = argv[++i];
+      continue;
+    }
+    if (arg == "--faults" && i + 1 < argc) {
+      faults = FaultInjection::fromString(argv[++i]);
+      if (faults) {
+        continue;
+      }
+      cerr << "Invalid fault specification: '" << argv[i] << "'" << endl;
+      return 1;
+    }
+    if (arg == "--log-level" && i + 1 < argc) {
+      const auto level = Logger::levelFromString(argv[++i]);
+      if (level) {
+        Logger::setLevel(*level);
+        continue;
+      }
+    }
+    // Settings are applied in order, so later ones override earlier ones
+    try {
+      if (arg == "--settings" && i + 1 < argc) {
+        ifstream file(argv[++i]);
+        if (!file) {
+          throw std::invalid_argument(
+            std::string("Failed to open ") + argv[i]);
+        }
+        settings.applyJson(nlohmann::json::parse(file));
+        continue;
+      }
+      if (arg == "--outputs" && i + 1 < argc) {
+        settings.outputs = DummySettings::makeOutputs(std::stoul(argv[++i]));
+        continue;
+      }
+      if (arg == "--scenes" && i + 1 < argc) {
+        settings.scenes = DummySettings::makeScenes(std::stoul(argv[++i]));
+        continue;
+      }
+      if (arg == "--latency" && i + 1 < argc) {
+        settings.applyLatency(argv[++i]);
+        continue;
+      }
+      if (arg == "--event-rate" && i + 1 < argc) {
+        settings.eventsPerSecond = std::max(0.0, std::stod(argv[++i]));
+        continue;
+      }
+      if (arg == "--seed" && i + 1 < argc) {
+        settings.seed = std::stoull(argv[++i]);
+        continue;
+      }
+    } catch (const std::exception& e) {
+      cerr << e.what() << endl;
+      return 1;
+    }
+    cerr << "Usage: " << argv[0]
+         << " [--threads N] [--log-level trace|debug|info|warning|critical|none]"
+         << " [--flight-recorder FILE] [--record-sessions DIRECTORY]"
+         << " [--settings FILE.json] [--outputs N]"
+         << " [--scenes N] [--latency CALL=DISTRIBUTION]... [--event-rate N]"
+         << " [--seed N] [--faults latency=MS,jitter=MS,bandwidth=BYTES,"
+         << "stall=INTERVAL_MS/DURATION_MS,disconnect=MS,seed=N]" << endl;
+    return 1;
+  }
+  Logger::ImplRegistration logger(
+    [](LogLevel level, const std::string& message) {
+      cerr << "[" << Logger::levelToString(level) << "] " << message << endl;
+    });
+  // Declared before the plugin, so that it is destroyed after it
+  std::optional<FlightRecorder> flightRecorder;
+  if (!flightRecorderPath.empty()) {
+    flightRecorder.emplace(flightRecorderPath);
+  }
+  std::optional<SessionRecorder> sessionRecorder;
+  if (!sessionsPath.empty()) {
+    sessionRecorder.emplace(sessionsPath);
+  }
+  std::optional<FaultInjector> faultInjector;
+  if (faults) {
+    faultInjector.emplace(*faults);
+  }
   auto ctx = std::make_shared<asio::io_context>();
-  Plugin plugin(ctx, std::make_shared<Dummy>(ctx, config, outputs));
+  Plugin plugin(
+    ctx, std::make_shared<Dummy>(ctx, config, std::move(settings)), threads);
   cout << "Started server with password '" << config.password << "'..." << endl;
   plugin.wait();
   return 0;
@@ -12,6 +12,8 @@
 #include <util/config-file.h>
 
 #include <QAction>
+#include <QBuffer>
+#include <QImage>
 #include <QMainWindow>
 #include <QObject>
 
@@ -46,13 +48,30 @@ class OBSFrontendSourceList {
     obs_frontend_source_list p;
 };
 
+int to_obs_log_level(LogLevel level) {
+  switch (level) {
+    case LogLevel::TRACE:
+    case LogLevel::DEBUG:
+      return LOG_DEBUG;
+    case LogLevel::INFO:
+      return LOG_INFO;
+    case LogLevel::WARNING:
+      return LOG_WARNING;
+    case LogLevel::CRITICAL:
+    case LogLevel::NONE:
+      return LOG_ERROR;
+  }
+  return LOG_INFO;
+}
+
 }// namespace
 
 OBS::OBS(
   std::shared_ptr<asio::io_context> ctx
 ) : QObject(), StreamingSoftware(ctx), mLoggerImpl(
-  [=](const std::string& message) {
-    blog(LOG_INFO, "[obs-streaming-remote] %s", message.c_str());
+  [=](LogLevel level, const std::string& message) {
+    blog(
+      to_obs_log_level(level), "[obs-streaming-remote] %s", message.c_str());
   }
 ) {
   LOG_FUNCTION();
@@ -196,6 +215,32 @@ asio::awaitable<bool> OBS::setOutputDelay(const std::string& id, int64_t seconds
   co_return true;
 }
 
+std::string OBS::encodeImage(
+  const Image& image,
+  const std::string& contentType,
+  int quality) {
+  if (image.empty()) {
+    return std::string();
+  }
+  const char* format = nullptr;
+  if (contentType == "image/png") {
+    format = "PNG";
+  } else if (contentType == "image/jpeg") {
+    format = "JPG";
+  } else {
+    return std::string();
+  }
+
+  // OBS scenes are composited onto black; ignore the alpha channel
+  const QImage qimage(
+    image.rgba.data(), image.width, image.height, image.width * 4,
+    QImage::Format::Format_RGBX8888);
+  QByteArray buf;
+  QBuffer buf_device(&buf);
+  qimage.save(&buf_device, format, quality);
+  return buf.toStdString();
+}
+
 void OBS::setConfiguration(const Config& config) {
   LOG_FUNCTION();
   auto obs_config = obs_frontend_get_global_config();
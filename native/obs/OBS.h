@@ -31,6 +31,17 @@ class OBS : public QObject, public StreamingSoftware {
   asio::awaitable<std::vector<Scene>> getScenes() override;
   asio::awaitable<bool> activateScene(const std::string& id) override;
   asio::awaitable<std::string> getSceneThumbnailAsBase64Png(const std::string& id) override;
+  asio::awaitable<Image> captureScene(
+    const std::string& id,
+    uint32_t maxDimension) override;
+  asio::awaitable<void> captureScenes(
+    const std::vector<std::string>& ids,
+    uint32_t maxDimension,
+    SceneCapturedCallback callback) override;
+  std::string encodeImage(
+    const Image& image,
+    const std::string& contentType,
+    int quality) override;
 
  private:
   Config getInitialConfiguration();
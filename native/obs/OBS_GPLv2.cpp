@@ -23,13 +23,12 @@ is licensed only under version 2 of the GNU General Public License,
 
 #include "OBS.h"
 
-#include "Core/AwaitablePromise.h"
+#include "Core/Base64.h"
+#include "Core/OneShot.h"
 
 #include <obs.h>
 #include <obs.hpp>
 
-#include <QBuffer>
-#include <QImage>
 #include <QScopeGuard>
 
 #define SCOPE_EXIT_IMPL(id, x) const auto SCOPE_GUARD_ ## id = \
@@ -38,107 +37,202 @@ is licensed only under version 2 of the GNU General Public License,
 #define SCOPE_EXIT(x) SCOPE_EXIT_IMPL_WRAP(__COUNTER__, x)
 
 namespace {
-  typedef AwaitablePromise<float> TickPromise;
+  typedef OneShot<float> TickPromise;
 
   void resolve_promise_on_tick(void* untyped_promise, float seconds) {
     reinterpret_cast<TickPromise*>(untyped_promise)->resolve(seconds);
   }
 
-  asio::awaitable<void> next_tick(asio::io_context& ctx) {
-    TickPromise p(ctx);
+  // OBS calls tick callbacks on its own thread
+  asio::awaitable<void> next_tick() {
+    TickPromise p;
 
     obs_add_tick_callback(&resolve_promise_on_tick, &p);
     SCOPE_EXIT([&]() { obs_remove_tick_callback(&resolve_promise_on_tick, &p); });
     co_await p.async_wait();
   }
 
-  // Based on obs-studio/UI/window-basic-main-screenshot.cpp
-  asio::awaitable<std::string> make_source_thumbnail(asio::io_context& ctx, OBSSource source) {
-    LOG_FUNCTION();
+  struct CaptureTarget {
+    std::string id;
+    OBSSource source;
+    uint32_t baseWidth = 0;
+    uint32_t baseHeight = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
     gs_texrender_t* texrender = nullptr;
-    SCOPE_EXIT([&]() { gs_texrender_destroy(texrender); });
     gs_stagesurf_t* stagesurface = nullptr;
-    SCOPE_EXIT([&]() { gs_stagesurface_destroy(stagesurface); });
+    bool rendered = false;
+  };
 
-    const auto width = obs_source_get_base_width(source);
-    const auto height = obs_source_get_base_height(source);
+  // Based on obs-studio/UI/window-basic-main-screenshot.cpp
+  //
+  // Every source goes through each stage on the same tick, so capturing any
+  // number of sources takes three ticks, not three per source.
+  asio::awaitable<void> capture_sources(
+    std::vector<CaptureTarget> targets,
+    uint32_t maxDimension,
+    const StreamingSoftware::SceneCapturedCallback& callback
+  ) {
+    LOG_FUNCTION();
+    SCOPE_EXIT([&]() {
+      for (auto& target: targets) {
+        gs_texrender_destroy(target.texrender);
+        gs_stagesurface_destroy(target.stagesurface);
+      }
+    });
 
-    co_await next_tick(ctx);
+    for (auto& target: targets) {
+      if (!target.source) {
+        continue;
+      }
+      target.baseWidth = obs_source_get_base_width(target.source);
+      target.baseHeight = obs_source_get_base_height(target.source);
+      // Let the GPU do the scaling: render at the target size, with an
+      // orthographic projection covering the full base size
+      auto width = target.baseWidth;
+      auto height = target.baseHeight;
+      if (maxDimension && (width > maxDimension || height > maxDimension)) {
+        if (width >= height) {
+          height = std::max<uint32_t>(1, (uint64_t) height * maxDimension / width);
+          width = maxDimension;
+        } else {
+          width = std::max<uint32_t>(1, (uint64_t) width * maxDimension / height);
+          height = maxDimension;
+        }
+      }
+      target.width = width;
+      target.height = height;
+    }
+
+    co_await next_tick();
     {
       obs_enter_graphics();
       SCOPE_EXIT([]() { obs_leave_graphics(); });
 
-
-      texrender = gs_texrender_create(GS_RGBA, GS_ZS_NONE);
-      stagesurface = gs_stagesurface_create(width, height, GS_RGBA);
-      gs_texrender_reset(texrender);
-
-      if (!gs_texrender_begin(texrender, width, height)) {
-        Logger::debug("Failed to begin texrender");
-        co_return std::string();
+      for (auto& target: targets) {
+        if (target.width == 0 || target.height == 0) {
+          continue;
+        }
+        target.texrender = gs_texrender_create(GS_RGBA, GS_ZS_NONE);
+        target.stagesurface
+          = gs_stagesurface_create(target.width, target.height, GS_RGBA);
+        gs_texrender_reset(target.texrender);
+
+        if (!gs_texrender_begin(target.texrender, target.width, target.height)) {
+          Logger::warning("Failed to begin texrender");
+          continue;
+        }
+        SCOPE_EXIT([&]() { gs_texrender_end(target.texrender); });
+        vec4 zero;
+        vec4_zero(&zero);
+        gs_clear(GS_CLEAR_COLOR, &zero, 0.0f, 0);
+        gs_ortho(
+          0.0f, (float) target.baseWidth, 0.0f, (float) target.baseHeight,
+          -100.0f, 100.0f);
+        gs_blend_state_push();
+        SCOPE_EXIT([]() { gs_blend_state_pop(); });
+        gs_blend_function(GS_BLEND_ONE, GS_BLEND_ZERO);
+
+        OBSSource source = target.source;
+        obs_source_inc_showing(source);
+        SCOPE_EXIT([=]() { obs_source_dec_showing(source); });
+        obs_source_video_render(source);
+        target.rendered = true;
       }
-      SCOPE_EXIT([&]() { gs_texrender_end(texrender); });
-      vec4 zero;
-      vec4_zero(&zero);
-      gs_clear(GS_CLEAR_COLOR, &zero, 0.0f, 0);
-      gs_ortho(0.0f, (float) width, 0.0f, (float)height, -100.0f, 100.0f);
-      gs_blend_state_push();
-      SCOPE_EXIT([]() { gs_blend_state_pop(); });
-      gs_blend_function(GS_BLEND_ONE, GS_BLEND_ZERO);
-
-      obs_source_inc_showing(source);
-      SCOPE_EXIT([=]() { obs_source_dec_showing(source); });
-      obs_source_video_render(source);
     }
-    co_await next_tick(ctx);
+    co_await next_tick();
     {
       obs_enter_graphics();
       SCOPE_EXIT([]() { obs_leave_graphics(); });
-      gs_stage_texture(stagesurface, gs_texrender_get_texture(texrender));
+      for (auto& target: targets) {
+        if (target.rendered) {
+          gs_stage_texture(
+            target.stagesurface, gs_texrender_get_texture(target.texrender));
+        }
+      }
     }
-    co_await next_tick(ctx);
+    co_await next_tick();
+
+    // Copy everything out while holding the graphics lock, but invoke
+    // callbacks - which may do slow things like encoding - after releasing it
+    std::vector<Image> images(targets.size());
     {
       obs_enter_graphics();
       SCOPE_EXIT([]() { obs_leave_graphics(); });
-      uint8_t* video_data = nullptr;
-      uint32_t video_linesize = 0;
-      if (!gs_stagesurface_map(stagesurface, &video_data, &video_linesize)) {
-        Logger::debug("Failed to map stagesurface");
-        co_return std::string();
-      }
-      SCOPE_EXIT([&]() { gs_stagesurface_unmap(stagesurface); });
-      QImage image(width, height, QImage::Format::Format_RGBX8888);
-      image.fill(0);
-      int linesize = image.bytesPerLine();
-      for (int y = 0; y < (int)height; y++) {
-        memcpy(
-          image.scanLine(y),
-          video_data + (y * video_linesize),
-          linesize
-        );
+      for (size_t i = 0; i < targets.size(); ++i) {
+        const auto& target = targets[i];
+        if (!target.rendered) {
+          continue;
+        }
+        uint8_t* video_data = nullptr;
+        uint32_t video_linesize = 0;
+        if (!gs_stagesurface_map(target.stagesurface, &video_data, &video_linesize)) {
+          Logger::warning("Failed to map stagesurface");
+          continue;
+        }
+        SCOPE_EXIT([&]() { gs_stagesurface_unmap(target.stagesurface); });
+        Image& image = images[i];
+        image.width = target.width;
+        image.height = target.height;
+        const auto linesize = target.width * 4;
+        image.rgba.resize(linesize * target.height);
+        for (uint32_t y = 0; y < target.height; y++) {
+          memcpy(
+            image.rgba.data() + (y * linesize),
+            video_data + (y * video_linesize),
+            linesize
+          );
+        }
       }
+    }
+    for (size_t i = 0; i < targets.size(); ++i) {
+      callback(targets[i].id, std::move(images[i]));
+    }
+  }
 
-      QByteArray buf;
-      QBuffer buf_device(&buf);
-      image.save(&buf_device, "PNG");
-      co_return buf.toBase64().toStdString();
+  OBSSource find_scene(const std::string& id) {
+    obs_frontend_source_list sources {};
+    SCOPE_EXIT([&]() { obs_frontend_source_list_free(&sources); });
+    obs_frontend_get_scenes(&sources);
+    for (size_t i = 0; i < sources.sources.num; i++) {
+      const auto source = sources.sources.array[i];
+      if (id == obs_source_get_name(source)) {
+        return source;
+      }
     }
-    co_return std::string();
+    return nullptr;
   }
 }
 
 asio::awaitable<std::string> OBS::getSceneThumbnailAsBase64Png(const std::string& id) {
   LOG_FUNCTION();
-  obs_frontend_source_list sources {};
-  SCOPE_EXIT([&]() { obs_frontend_source_list_free(&sources); });
-  obs_frontend_get_scenes(&sources);
-  for (size_t i = 0; i < sources.sources.num; i++) {
-    const auto source = sources.sources.array[i];
-    if (id != obs_source_get_name(source)) {
-      continue;
-    }
-    co_return co_await make_source_thumbnail(getIoContext(), source);
-  }
+  const auto image = co_await captureScene(id, 0);
+  co_return base64_encode(encodeImage(image, "image/png", -1));
+}
+
+asio::awaitable<Image> OBS::captureScene(
+  const std::string& id,
+  uint32_t maxDimension) {
+  LOG_FUNCTION();
+  Image image;
+  co_await captureScenes(
+    {id}, maxDimension,
+    [&image](const std::string&, Image captured) {
+      image = std::move(captured);
+    });
+  co_return image;
+}
 
-  co_return std::string();
+asio::awaitable<void> OBS::captureScenes(
+  const std::vector<std::string>& ids,
+  uint32_t maxDimension,
+  SceneCapturedCallback callback) {
+  LOG_FUNCTION();
+  std::vector<CaptureTarget> targets;
+  targets.reserve(ids.size());
+  for (const auto& id: ids) {
+    // Missing scenes are reported as empty images in the same pass
+    targets.push_back({ .id = id, .source = find_scene(id) });
+  }
+  co_await capture_sources(std::move(targets), maxDimension, callback);
 }
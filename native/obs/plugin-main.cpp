@@ -8,13 +8,48 @@
 
 #include <obs-module.h>
 
+#include "Core/FlightRecorder.h"
 #include "Core/Logger.h"
 #include "Core/Plugin.h"
+#include "Core/SessionRecorder.h"
 #include "OBS.h"
 
+#include <cstdlib>
+#include <filesystem>
+
 namespace {
 Plugin* sPlugin = nullptr;
+FlightRecorder* sFlightRecorder = nullptr;
+SessionRecorder* sSessionRecorder = nullptr;
+
+void start_flight_recorder() {
+  char* config = obs_module_config_path("flight-recorder.bin");
+  if (!config) {
+    return;
+  }
+  const auto path = std::filesystem::u8path(config);
+  bfree(config);
+  try {
+    std::filesystem::create_directories(path.parent_path());
+    sFlightRecorder = new FlightRecorder(path);
+  } catch (const std::exception& e) {
+    Logger::warning("Failed to start the flight recorder: {}", e.what());
+  }
+}
+
+// Opt-in, as recordings contain everything that clients send
+void start_session_recorder() {
+  const char* directory = std::getenv("STREAMING_REMOTE_RECORD_SESSIONS");
+  if (!(directory && directory[0])) {
+    return;
+  }
+  try {
+    sSessionRecorder = new SessionRecorder(std::filesystem::u8path(directory));
+  } catch (const std::exception& e) {
+    Logger::warning("Failed to start the session recorder: {}", e.what());
+  }
 }
+}// namespace
 
 extern "C" {
 OBS_DECLARE_MODULE();
@@ -25,6 +60,8 @@ bool obs_module_load() {
   LOG_FUNCTION();
   auto ctx = std::make_shared<asio::io_context>();
   sPlugin = new Plugin(ctx, std::make_shared<OBS>(ctx));
+  start_flight_recorder();
+  start_session_recorder();
   return true;
 }
 
@@ -32,6 +69,10 @@ void obs_module_unload() {
   LOG_FUNCTION();
   delete sPlugin;
   sPlugin = nullptr;
+  delete sFlightRecorder;
+  sFlightRecorder = nullptr;
+  delete sSessionRecorder;
+  sSessionRecorder = nullptr;
 }
 
 const char* obs_module_name() {
@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#include "Core/FlightRecorder.h"
+#include "Core/Output.h"
+
+#include <fmt/format.h>
+#include <nlohmann/json.hpp>
+
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <optional>
+#include <string>
+
+using namespace std;
+using json = nlohmann::json;
+using EventType = FlightRecorder::EventType;
+
+namespace {
+
+// ISO 8601, UTC, with microseconds
+string format_time(uint64_t nanosecondsSinceEpoch) {
+  const time_t seconds = nanosecondsSinceEpoch / 1000000000;
+  const auto micros = (nanosecondsSinceEpoch / 1000) % 1000000;
+  const auto tm = *gmtime(&seconds);
+  return fmt::format(
+    "{:04}-{:02}-{:02}T{:02}:{:02}:{:02}.{:06}Z", tm.tm_year + 1900,
+    tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec, micros);
+}
+
+string format_value(const FlightRecorder::Record& record) {
+  switch (record.type) {
+    case EventType::CONNECTION_CLOSED:
+    case EventType::HANDSHAKE_SUCCEEDED:
+    case EventType::HANDSHAKE_FAILED:
+    case EventType::RPC:
+      return fmt::format("{:.3f}ms", record.value / 1e6);
+    case EventType::OUTPUT_STATE_CHANGED:
+      return Output::stateToString(static_cast<OutputState>(record.value));
+    case EventType::PREVIEWS_SKIPPING_STARTED:
+      return fmt::format("{} bytes pending", record.value);
+    case EventType::PREVIEWS_SKIPPING_ENDED:
+      return fmt::format("{} frames skipped", record.value);
+    case EventType::PREVIEW_QUALITY_CHANGED:
+      return fmt::format("maxDimension {}", record.value);
+    default:
+      return {};
+  }
+}
+
+}// namespace
+
+int main(int argc, char** argv) {
+  bool asJson = false;
+  optional<uint32_t> connectionId;
+  string path;
+  for (int i = 1; i < argc; ++i) {
+    const string arg(argv[i]);
+    if (arg == "--json") {
+      asJson = true;
+      continue;
+    }
+    if (arg == "--connection" && i + 1 < argc) {
+      connectionId = stoul(argv[++i]);
+      continue;
+    }
+    if (path.empty() && !arg.starts_with("--")) {
+      path = arg;
+      continue;
+    }
+    path.clear();
+    break;
+  }
+  if (path.empty()) {
+    cerr << "Usage: " << argv[0] << " [--json] [--connection ID] FILE" << endl;
+    return 1;
+  }
+
+  FlightRecorder::Contents contents;
+  try {
+    contents = FlightRecorder::read(path);
+  } catch (const exception& e) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+  const auto& header = contents.header;
+  const auto& records = contents.records;
+  const auto toWallClock = [&header](uint64_t time) {
+    return header.systemEpoch + (time - header.steadyEpoch);
+  };
+
+  if (!asJson) {
+    cout << fmt::format(
+      "# Process {}, started {}\n# {} events", header.processId,
+      format_time(header.systemEpoch), records.size());
+    if (header.lastSequence > records.size()) {
+      cout << fmt::format(
+        "; {} older or incomplete events were lost",
+        header.lastSequence - records.size());
+    }
+    cout << endl;
+  }
+
+  for (const auto& record : records) {
+    if (connectionId && record.connectionId != *connectionId) {
+      continue;
+    }
+    const string detail(
+      record.detail, strnlen(record.detail, FlightRecorder::DETAIL_SIZE));
+    const auto elapsed = (record.time - header.steadyEpoch) / 1e9;
+    if (asJson) {
+      cout << json {
+        {"sequence", record.sequence},
+        {"time", format_time(toWallClock(record.time))},
+        {"elapsedSeconds", elapsed},
+        {"connectionId", record.connectionId},
+        {"type", FlightRecorder::typeToString(record.type)},
+        {"detail", detail},
+        {"value", record.value},
+      } << "\n";
+      continue;
+    }
+    auto line = fmt::format(
+      "{} +{:.6f}s {:>5} {}", format_time(toWallClock(record.time)), elapsed,
+      record.connectionId ? fmt::format("#{}", record.connectionId) : "-",
+      FlightRecorder::typeToString(record.type));
+    for (const auto& field : {detail, format_value(record)}) {
+      if (!field.empty()) {
+        line += " " + field;
+      }
+    }
+    cout << line << "\n";
+  }
+  return 0;
+}
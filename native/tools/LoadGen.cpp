@@ -0,0 +1,577 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#include "Core/Clock.h"
+#include "Core/Logger.h"
+#include "client/Client.h"
+
+#include <fmt/format.h>
+#include <asio.hpp>
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+using namespace std;
+using json = nlohmann::json;
+
+namespace {
+
+enum class Workload {
+  // Every client disconnects and reconnects at the same time, once per
+  // interval
+  RECONNECT_STORM,
+  // `outputs/get` and `scenes/get` once per interval
+  DASHBOARD,
+  // A full thumbnail of every scene once per interval
+  THUMBNAILS,
+  // `scenes/activate` on the next scene once per interval
+  SCENE_SWITCH,
+};
+
+struct WorkloadClients {
+  Workload workload;
+  unsigned int clients;
+};
+
+struct Options {
+  ClientConfig client {.reconnect = true};
+  vector<WorkloadClients> workloads;
+  chrono::seconds duration {30};
+  chrono::seconds rampUp {10};
+  chrono::milliseconds interval {1000};
+  unsigned int threads = max(1u, thread::hardware_concurrency());
+  bool asJson = false;
+};
+
+const char* workload_to_string(Workload workload) {
+  switch (workload) {
+    case Workload::RECONNECT_STORM:
+      return "reconnect-storm";
+    case Workload::DASHBOARD:
+      return "dashboard";
+    case Workload::THUMBNAILS:
+      return "thumbnails";
+    case Workload::SCENE_SWITCH:
+      return "scene-switch";
+  }
+  return "unknown";
+}
+
+optional<Workload> workload_from_string(const string& name) {
+  for (const auto workload :
+       {Workload::RECONNECT_STORM, Workload::DASHBOARD, Workload::THUMBNAILS,
+        Workload::SCENE_SWITCH}) {
+    if (name == workload_to_string(workload)) {
+      return workload;
+    }
+  }
+  return {};
+}
+
+// `dashboard:1000,thumbnails:20,scene-switch`
+optional<vector<WorkloadClients>> parse_workloads(const string& spec) {
+  vector<WorkloadClients> ret;
+  size_t begin = 0;
+  while (begin <= spec.size()) {
+    auto end = spec.find(',', begin);
+    if (end == string::npos) {
+      end = spec.size();
+    }
+    const auto item = spec.substr(begin, end - begin);
+    begin = end + 1;
+
+    const auto colon = item.find(':');
+    const auto workload = workload_from_string(item.substr(0, colon));
+    if (!workload) {
+      return {};
+    }
+    unsigned int clients = 1;
+    if (colon != string::npos) {
+      try {
+        clients = stoul(item.substr(colon + 1));
+      } catch (const std::exception&) {
+        return {};
+      }
+    }
+    ret.push_back({*workload, clients});
+  }
+  return ret;
+}
+
+double milliseconds_since(Clock::time_point start) {
+  return chrono::duration<double, milli>(Clock::now() - start).count();
+}
+
+// Latency distributions in milliseconds, by metric; shared by all clients
+class Recorder {
+ public:
+  void record(const string& metric, double milliseconds) {
+    unique_lock lock(mMutex);
+    mSeries[metric].samples.push_back(milliseconds);
+  }
+
+  void recordError(const string& metric, const string& what) {
+    unique_lock lock(mMutex);
+    mSeries[metric].errors[what]++;
+  }
+
+  json toJson() const {
+    unique_lock lock(mMutex);
+    json ret = json::object();
+    for (const auto& [metric, series] : mSeries) {
+      const auto summary = summarize(series);
+      ret[metric] = {
+        {"count", summary.count},
+        {"errors", series.errors},
+        {"mean_ms", summary.mean},
+        {"p50_ms", summary.p50},
+        {"p90_ms", summary.p90},
+        {"p99_ms", summary.p99},
+        {"max_ms", summary.max},
+      };
+    }
+    return ret;
+  }
+
+  void print(ostream& out) const {
+    unique_lock lock(mMutex);
+    out << fmt::format(
+      "{:<48} {:>8} {:>7} {:>9} {:>9} {:>9} {:>9}\n", "metric", "count",
+      "errors", "p50 ms", "p90 ms", "p99 ms", "max ms");
+    for (const auto& [metric, series] : mSeries) {
+      const auto summary = summarize(series);
+      size_t errors = 0;
+      for (const auto& [what, count] : series.errors) {
+        errors += count;
+      }
+      out << fmt::format(
+        "{:<48} {:>8} {:>7} {:>9.2f} {:>9.2f} {:>9.2f} {:>9.2f}\n", metric,
+        summary.count, errors, summary.p50, summary.p90, summary.p99,
+        summary.max);
+    }
+    for (const auto& [metric, series] : mSeries) {
+      for (const auto& [what, count] : series.errors) {
+        out << fmt::format("{}: {}x '{}'\n", metric, count, what);
+      }
+    }
+  }
+
+ private:
+  struct Series {
+    vector<double> samples;
+    map<string, size_t> errors;
+  };
+  struct Summary {
+    size_t count = 0;
+    double mean = 0, p50 = 0, p90 = 0, p99 = 0, max = 0;
+  };
+
+  static Summary summarize(const Series& series) {
+    auto samples = series.samples;
+    if (samples.empty()) {
+      return {};
+    }
+    sort(samples.begin(), samples.end());
+    const auto percentile = [&samples](double p) {
+      return samples[min(samples.size() - 1, size_t(samples.size() * p))];
+    };
+    double sum = 0;
+    for (const auto sample : samples) {
+      sum += sample;
+    }
+    return {
+      .count = samples.size(),
+      .mean = sum / samples.size(),
+      .p50 = percentile(0.5),
+      .p90 = percentile(0.9),
+      .p99 = percentile(0.99),
+      .max = samples.back(),
+    };
+  }
+
+  mutable mutex mMutex;
+  map<string, Series> mSeries;
+};
+
+const char FAN_OUT_EACH[] = "fan-out: scenes/currentSceneChanged (each)";
+const char FAN_OUT_LAST[] = "fan-out: scenes/currentSceneChanged (last)";
+
+/** Measures notification fan-out for scene switches.
+ *
+ * Clients only see the server's side of a scene switch through the
+ * notification, so latencies are measured from when the `scenes/activate`
+ * request is sent, which adds one network hop and the request dispatch to the
+ * backend event. `(last)` is the time until the final client received it.
+ */
+class SceneSwitches {
+ public:
+  explicit SceneSwitches(Recorder& recorder) : mRecorder(recorder) {
+  }
+
+  void triggered(const string& sceneId) {
+    unique_lock lock(mMutex);
+    finish(sceneId);
+    mSwitches[sceneId] = {.triggeredAt = Clock::now()};
+  }
+
+  void notificationReceived(const string& sceneId) {
+    unique_lock lock(mMutex);
+    const auto it = mSwitches.find(sceneId);
+    if (it == mSwitches.end()) {
+      return;
+    }
+    auto& sceneSwitch = it->second;
+    const auto latency = milliseconds_since(sceneSwitch.triggeredAt);
+    sceneSwitch.receipts++;
+    sceneSwitch.last = max(sceneSwitch.last, latency);
+    mRecorder.record(FAN_OUT_EACH, latency);
+  }
+
+  void finishAll() {
+    unique_lock lock(mMutex);
+    while (!mSwitches.empty()) {
+      finish(mSwitches.begin()->first);
+    }
+  }
+
+ private:
+  struct Switch {
+    Clock::time_point triggeredAt;
+    size_t receipts = 0;
+    double last = 0;
+  };
+
+  void finish(const string& sceneId) {
+    const auto it = mSwitches.find(sceneId);
+    if (it == mSwitches.end()) {
+      return;
+    }
+    if (it->second.receipts > 0) {
+      mRecorder.record(FAN_OUT_LAST, it->second.last);
+    }
+    mSwitches.erase(it);
+  }
+
+  Recorder& mRecorder;
+  mutex mMutex;
+  unordered_map<string, Switch> mSwitches;
+};
+
+struct Session {
+  shared_ptr<Client> client;
+  Workload workload;
+  const Options& options;
+  Recorder& recorder;
+  SceneSwitches& sceneSwitches;
+  Clock::time_point start;
+  Clock::time_point deadline;
+
+  string metric(const string& name) const {
+    return fmt::format("{}: {}", workload_to_string(workload), name);
+  }
+};
+
+asio::awaitable<void> sleep_until(Clock::time_point when) {
+  asio::steady_timer timer(co_await asio::this_coro::executor, when);
+  co_await timer.async_wait(asio::use_awaitable);
+}
+
+asio::awaitable<bool> timed_connect(const Session& session) {
+  const auto start = Clock::now();
+  try {
+    co_await session.client->connect();
+    session.recorder.record(
+      session.metric("handshake"), milliseconds_since(start));
+    co_return true;
+  } catch (const std::exception& e) {
+    session.recorder.recordError(session.metric("handshake"), e.what());
+  }
+  co_return false;
+}
+
+asio::awaitable<optional<json>> timed_call(
+  const Session& session,
+  const string& method,
+  json params = json::object()) {
+  const auto start = Clock::now();
+  try {
+    auto result = co_await session.client->call(method, std::move(params));
+    session.recorder.record(session.metric(method), milliseconds_since(start));
+    co_return result;
+  } catch (const std::exception& e) {
+    session.recorder.recordError(session.metric(method), e.what());
+  }
+  co_return nullopt;
+}
+
+asio::awaitable<vector<string>> get_scene_ids(const Session& session) {
+  vector<string> ids;
+  const auto scenes = co_await timed_call(session, "scenes/get");
+  if (scenes && scenes->is_structured()) {
+    for (const auto& scene : *scenes) {
+      ids.push_back(scene.value("id", string()));
+    }
+  }
+  co_return ids;
+}
+
+asio::awaitable<void> run_reconnect_storm(const Session& session) {
+  auto next = session.start;
+  while (next < session.deadline) {
+    co_await sleep_until(next);
+    next += session.options.interval;
+    if (co_await timed_connect(session)) {
+      co_await timed_call(session, "outputs/get");
+    }
+    session.client->disconnect();
+  }
+}
+
+asio::awaitable<void> run_dashboard(const Session& session) {
+  while (Clock::now() < session.deadline) {
+    const auto next = Clock::now() + session.options.interval;
+    co_await timed_call(session, "outputs/get");
+    co_await timed_call(session, "scenes/get");
+    co_await sleep_until(next);
+  }
+}
+
+asio::awaitable<void> run_thumbnails(const Session& session) {
+  const auto ids = co_await get_scene_ids(session);
+  while (Clock::now() < session.deadline) {
+    const auto next = Clock::now() + session.options.interval;
+    for (const auto& id : ids) {
+      json params {{"id", id}, {"content_type", "image/png"}};
+      co_await timed_call(session, "scenes/getThumbnail", std::move(params));
+    }
+    co_await sleep_until(next);
+  }
+}
+
+asio::awaitable<void> run_scene_switch(const Session& session) {
+  const auto ids = co_await get_scene_ids(session);
+  if (ids.empty()) {
+    co_return;
+  }
+  size_t i = 0;
+  while (Clock::now() < session.deadline) {
+    const auto next = Clock::now() + session.options.interval;
+    const auto& id = ids[i++ % ids.size()];
+    session.sceneSwitches.triggered(id);
+    json params {{"id", id}};
+    co_await timed_call(session, "scenes/activate", std::move(params));
+    co_await sleep_until(next);
+  }
+}
+
+asio::awaitable<void> run_session(Session session, Clock::time_point rampAt) {
+  // Every client reports scene switches, whatever its own workload
+  session.client->currentSceneChanged.connect(
+    [&switches = session.sceneSwitches](const string& id) {
+      switches.notificationReceived(id);
+    });
+
+  if (session.workload == Workload::RECONNECT_STORM) {
+    co_await run_reconnect_storm(session);
+    co_return;
+  }
+
+  co_await sleep_until(rampAt);
+  if (!co_await timed_connect(session)) {
+    co_return;
+  }
+  switch (session.workload) {
+    case Workload::DASHBOARD:
+      co_await run_dashboard(session);
+      break;
+    case Workload::THUMBNAILS:
+      co_await run_thumbnails(session);
+      break;
+    case Workload::SCENE_SWITCH:
+      co_await run_scene_switch(session);
+      break;
+    case Workload::RECONNECT_STORM:
+      break;
+  }
+  session.client->disconnect();
+}
+
+// Each session needs a socket
+void raise_file_descriptor_limit() {
+#ifndef _WIN32
+  rlimit limit;
+  if (
+    getrlimit(RLIMIT_NOFILE, &limit) == 0
+    && limit.rlim_cur < limit.rlim_max) {
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+  }
+#endif
+}
+
+}// namespace
+
+int main(int argc, char** argv) {
+  Options options;
+  string workloads = "dashboard:100,scene-switch";
+  bool valid = true;
+  for (int i = 1; valid && i < argc; ++i) {
+    const string arg(argv[i]);
+    if (arg == "--json") {
+      options.asJson = true;
+      continue;
+    }
+    if (i + 1 >= argc) {
+      valid = false;
+      break;
+    }
+    const string value(argv[++i]);
+    try {
+      if (arg == "--host") {
+        options.client.host = value;
+      } else if (arg == "--port") {
+        options.client.port = stoul(value);
+      } else if (arg == "--password") {
+        options.client.password = value;
+      } else if (arg == "--workload") {
+        workloads = value;
+      } else if (arg == "--duration") {
+        options.duration = chrono::seconds(stoul(value));
+      } else if (arg == "--ramp-up") {
+        options.rampUp = chrono::seconds(stoul(value));
+      } else if (arg == "--interval") {
+        options.interval = chrono::milliseconds(stoul(value));
+      } else if (arg == "--threads") {
+        options.threads = max(1ul, stoul(value));
+      } else if (arg == "--log-level") {
+        const auto level = Logger::levelFromString(value);
+        valid = level.has_value();
+        if (valid) {
+          Logger::setLevel(*level);
+        }
+      } else {
+        valid = false;
+      }
+    } catch (const std::exception&) {
+      valid = false;
+    }
+  }
+  const auto parsedWorkloads = parse_workloads(workloads);
+  if (!valid || !parsedWorkloads || options.interval.count() == 0) {
+    cerr << "Usage: " << argv[0]
+         << " --password PASSWORD [--host HOST] [--port PORT]"
+         << " [--workload NAME[:CLIENTS][,...]] [--duration SECONDS]"
+         << " [--ramp-up SECONDS] [--interval MILLISECONDS] [--threads N]"
+         << " [--log-level trace|debug|info|warning|critical|none] [--json]"
+         << endl
+         << "Workloads: reconnect-storm, dashboard, thumbnails, scene-switch"
+         << endl;
+    return 1;
+  }
+  options.workloads = *parsedWorkloads;
+  Logger::ImplRegistration logger(
+    [](LogLevel level, const string& message) {
+      cerr << "[" << Logger::levelToString(level) << "] " << message << endl;
+    });
+  raise_file_descriptor_limit();
+
+  Recorder recorder;
+  SceneSwitches sceneSwitches(recorder);
+  auto context = make_shared<asio::io_context>();
+
+  size_t total = 0;
+  for (const auto& [workload, clients] : options.workloads) {
+    total += clients;
+  }
+  if (total == 0) {
+    cerr << "No clients in the workload" << endl;
+    return 1;
+  }
+  const auto start = Clock::now();
+  const auto deadline = start + options.rampUp + options.duration;
+  // Stop once every session has finished, without waiting for connections
+  // to close gracefully
+  auto remaining = make_shared<atomic<size_t>>(total);
+  const auto sessionFinished = [context, remaining](exception_ptr) {
+    if (--*remaining == 0) {
+      context->stop();
+    }
+  };
+  size_t index = 0;
+  for (const auto& [workload, clients] : options.workloads) {
+    auto config = options.client;
+    config.reconnect = workload != Workload::RECONNECT_STORM;
+    for (unsigned int i = 0; i < clients; ++i, ++index) {
+      auto client = make_shared<Client>(context, config);
+      const auto rampAt = start + options.rampUp * index / total;
+      asio::co_spawn(
+        client->getStrand(),
+        run_session(
+          Session {
+            client, workload, options, recorder, sceneSwitches, start,
+            deadline},
+          rampAt),
+        sessionFinished);
+    }
+  }
+  if (!options.asJson) {
+    cerr << fmt::format(
+      "Running {} clients against {}:{} for {}s after a {}s ramp-up...",
+      total, options.client.host, options.client.port,
+      options.duration.count(), options.rampUp.count())
+         << endl;
+  }
+
+  // Don't wait forever for requests that the server never responds to
+  asio::steady_timer timeout(*context, deadline + chrono::seconds(10));
+  timeout.async_wait([context](const asio::error_code& ec) {
+    if (!ec) {
+      context->stop();
+    }
+  });
+  vector<thread> threads;
+  for (unsigned int i = 0; i < options.threads; ++i) {
+    threads.emplace_back([context]() { context->run(); });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  sceneSwitches.finishAll();
+
+  if (options.asJson) {
+    json out {
+      {"host", options.client.host},
+      {"port", options.client.port},
+      {"clients", total},
+      {"duration_s", options.duration.count()},
+      {"ramp_up_s", options.rampUp.count()},
+      {"interval_ms", options.interval.count()},
+      {"metrics", recorder.toJson()},
+    };
+    cout << out.dump(2) << endl;
+  } else {
+    recorder.print(cout);
+  }
+  return 0;
+}
@@ -0,0 +1,361 @@
+/*
+ * Copyright (c) 2018-present, Frederick Emmott.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the LICENSE file
+ * in the root directory of this source tree.
+ */
+
+#include "Core/Clock.h"
+#include "Core/Logger.h"
+#include "Core/OneShot.h"
+#include "Core/SessionRecorder.h"
+#include "client/Client.h"
+
+#include <fmt/format.h>
+#include <asio.hpp>
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+using json = nlohmann::json;
+using RecordType = SessionRecorder::RecordType;
+
+namespace {
+
+struct Options {
+  ClientConfig client {.reconnect = false};
+  // 0 for as fast as possible
+  double speed = 1;
+  set<string> excluded;
+  bool asJson = false;
+};
+
+struct RecordedRequest {
+  // Nanoseconds since the start of the session
+  uint64_t time;
+  string method;
+  json params;
+  // Null for notifications
+  json id;
+  // Nanoseconds, from the server receiving the request to sending the
+  // response; only for requests with a recorded response
+  optional<uint64_t> latency;
+};
+
+struct RecordedSession {
+  string path;
+  uint64_t systemEpoch;
+  vector<RecordedRequest> requests;
+};
+
+RecordedSession load_session(const string& path, const set<string>& excluded) {
+  const auto contents = SessionRecorder::read(path);
+  RecordedSession session {
+    .path = path, .systemEpoch = contents.header.systemEpoch};
+  // Requests that are waiting for a response, by JSON-RPC ID
+  unordered_map<string, size_t> pending;
+  for (const auto& record : contents.records) {
+    if (record.header.type == RecordType::RESPONSE) {
+      const auto it = pending.find(record.payload);
+      if (it != pending.end()) {
+        auto& request = session.requests[it->second];
+        request.latency = record.header.time - request.time;
+        pending.erase(it);
+      }
+      continue;
+    }
+    if (record.header.type != RecordType::REQUEST) {
+      continue;
+    }
+    auto message = json::parse(record.payload, nullptr, false);
+    if (!message.is_object() || !message["method"].is_string()) {
+      continue;
+    }
+    const string method = message["method"];
+    if (excluded.contains(method)) {
+      continue;
+    }
+    if (message.contains("id")) {
+      pending[message["id"].dump()] = session.requests.size();
+    }
+    session.requests.push_back({
+      .time = record.header.time,
+      .method = method,
+      .params = message.value("params", json::object()),
+      .id = message.value("id", json()),
+    });
+  }
+  return session;
+}
+
+// Recorded and replayed latencies in milliseconds, by method
+class Comparison {
+ public:
+  void record(const string& method, double recorded, double replayed) {
+    unique_lock lock(mMutex);
+    auto& series = mMethods[method];
+    series.recorded.push_back(recorded);
+    series.replayed.push_back(replayed);
+  }
+
+  void recordError(const string& method) {
+    unique_lock lock(mMutex);
+    mMethods[method].errors++;
+  }
+
+  json toJson() const {
+    unique_lock lock(mMutex);
+    json ret = json::object();
+    for (const auto& [method, series] : mMethods) {
+      const auto recorded = summarize(series.recorded);
+      const auto replayed = summarize(series.replayed);
+      ret[method] = {
+        {"count", series.recorded.size()},
+        {"errors", series.errors},
+        {"recorded_p50_ms", recorded.p50},
+        {"recorded_p99_ms", recorded.p99},
+        {"replayed_p50_ms", replayed.p50},
+        {"replayed_p99_ms", replayed.p99},
+      };
+    }
+    return ret;
+  }
+
+  void print(ostream& out) const {
+    unique_lock lock(mMutex);
+    out << fmt::format(
+      "{:<28} {:>7} {:>6} {:>17} {:>17} {:>17}\n", "method", "count",
+      "errors", "recorded p50/p99", "replayed p50/p99", "p50 change");
+    for (const auto& [method, series] : mMethods) {
+      const auto recorded = summarize(series.recorded);
+      const auto replayed = summarize(series.replayed);
+      out << fmt::format(
+        "{:<28} {:>7} {:>6} {:>8.2f}/{:<8.2f} {:>8.2f}/{:<8.2f} {:>+16.2f}\n",
+        method, series.recorded.size(), series.errors, recorded.p50,
+        recorded.p99, replayed.p50, replayed.p99, replayed.p50 - recorded.p50);
+    }
+  }
+
+ private:
+  struct Series {
+    vector<double> recorded;
+    vector<double> replayed;
+    size_t errors = 0;
+  };
+  struct Summary {
+    double p50 = 0;
+    double p99 = 0;
+  };
+
+  static Summary summarize(vector<double> samples) {
+    if (samples.empty()) {
+      return {};
+    }
+    sort(samples.begin(), samples.end());
+    const auto percentile = [&samples](double p) {
+      return samples[min(samples.size() - 1, size_t(samples.size() * p))];
+    };
+    return {.p50 = percentile(0.5), .p99 = percentile(0.99)};
+  }
+
+  mutable mutex mMutex;
+  map<string, Series> mMethods;
+};
+
+double to_milliseconds(uint64_t nanoseconds) {
+  return nanoseconds / 1e6;
+}
+
+asio::awaitable<void> replay_request(
+  shared_ptr<Client> client,
+  const RecordedRequest& request,
+  Comparison& comparison) {
+  if (request.id.is_null()) {
+    try {
+      client->notify(request.method, request.params);
+    } catch (const std::exception&) {
+      comparison.recordError(request.method);
+    }
+    co_return;
+  }
+  const auto start = Clock::now();
+  try {
+    co_await client->call(request.method, request.params);
+  } catch (const RpcError&) {
+    // The server responded, which is all that we're timing
+  } catch (const std::exception&) {
+    comparison.recordError(request.method);
+    co_return;
+  }
+  const auto replayed
+    = chrono::duration<double, milli>(Clock::now() - start).count();
+  if (request.latency) {
+    comparison.record(
+      request.method, to_milliseconds(*request.latency), replayed);
+  }
+}
+
+/** Replays a session.
+ *
+ * At a finite speed, requests are sent at their recorded times, scaled, even
+ * if earlier requests haven't completed yet; at maximum speed, each request is
+ * sent as soon as the previous one completes.
+ */
+asio::awaitable<void> replay_session(
+  shared_ptr<asio::io_context> context,
+  shared_ptr<Client> client,
+  const RecordedSession& session,
+  Clock::time_point start,
+  const Options& options,
+  Comparison& comparison) {
+  asio::steady_timer timer(client->getStrand());
+  timer.expires_at(start);
+  co_await timer.async_wait(asio::use_awaitable);
+  try {
+    co_await client->connect();
+  } catch (const std::exception& e) {
+    Logger::warning("{}: failed to connect: {}", session.path, e.what());
+    co_return;
+  }
+
+  if (options.speed == 0) {
+    for (const auto& request : session.requests) {
+      co_await replay_request(client, request, comparison);
+    }
+    client->disconnect();
+    co_return;
+  }
+
+  // Only touched on the client's strand
+  auto remaining = make_shared<size_t>(session.requests.size());
+  OneShot<bool> finished;
+  const auto replayStart = Clock::now();
+  for (const auto& request : session.requests) {
+    timer.expires_at(
+      replayStart
+      + chrono::duration_cast<Clock::duration>(
+        chrono::nanoseconds(request.time) / options.speed));
+    co_await timer.async_wait(asio::use_awaitable);
+    asio::co_spawn(
+      client->getStrand(), replay_request(client, request, comparison),
+      [remaining, finished](exception_ptr) mutable {
+        if (--*remaining == 0) {
+          finished.resolve(true);
+        }
+      });
+  }
+  if (!session.requests.empty()) {
+    co_await finished.async_wait();
+  }
+  client->disconnect();
+}
+
+}// namespace
+
+int main(int argc, char** argv) {
+  Options options;
+  vector<string> paths;
+  bool valid = true;
+  for (int i = 1; valid && i < argc; ++i) {
+    const string arg(argv[i]);
+    if (arg == "--json") {
+      options.asJson = true;
+      continue;
+    }
+    if (!arg.starts_with("--")) {
+      paths.push_back(arg);
+      continue;
+    }
+    if (i + 1 >= argc) {
+      valid = false;
+      break;
+    }
+    const string value(argv[++i]);
+    try {
+      if (arg == "--host") {
+        options.client.host = value;
+      } else if (arg == "--port") {
+        options.client.port = stoul(value);
+      } else if (arg == "--password") {
+        options.client.password = value;
+      } else if (arg == "--speed") {
+        options.speed = value == "max" ? 0 : stod(value);
+        valid = options.speed >= 0;
+      } else if (arg == "--exclude") {
+        options.excluded.insert(value);
+      } else {
+        valid = false;
+      }
+    } catch (const std::exception&) {
+      valid = false;
+    }
+  }
+  if (!valid || paths.empty()) {
+    cerr << "Usage: " << argv[0]
+         << " --password PASSWORD [--host HOST] [--port PORT]"
+         << " [--speed N|max] [--exclude METHOD]... [--json] SESSION..."
+         << endl;
+    return 1;
+  }
+  Logger::ImplRegistration logger(
+    [](LogLevel level, const string& message) {
+      cerr << "[" << Logger::levelToString(level) << "] " << message << endl;
+    });
+
+  vector<RecordedSession> sessions;
+  for (const auto& path : paths) {
+    try {
+      sessions.push_back(load_session(path, options.excluded));
+    } catch (const std::exception& e) {
+      cerr << e.what() << endl;
+      return 1;
+    }
+  }
+  // Sessions start at the same offsets from each other as when recorded
+  uint64_t firstEpoch = sessions.front().systemEpoch;
+  for (const auto& session : sessions) {
+    firstEpoch = min(firstEpoch, session.systemEpoch);
+  }
+
+  auto context = make_shared<asio::io_context>();
+  Comparison comparison;
+  const auto start = Clock::now();
+  for (const auto& session : sessions) {
+    auto client = make_shared<Client>(context, options.client);
+    const auto offset = options.speed == 0
+      ? Clock::duration::zero()
+      : chrono::duration_cast<Clock::duration>(
+        chrono::nanoseconds(session.systemEpoch - firstEpoch) / options.speed);
+    asio::co_spawn(
+      client->getStrand(),
+      replay_session(
+        context, client, session, start + offset, options, comparison),
+      asio::detached);
+  }
+  vector<thread> threads;
+  for (unsigned int i = 0; i < max(1u, thread::hardware_concurrency()); ++i) {
+    threads.emplace_back([context]() { context->run(); });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  if (options.asJson) {
+    cout << json {{"methods", comparison.toJson()}}.dump(2) << endl;
+  } else {
+    comparison.print(cout);
+  }
+  return 0;
+}
@@ -15,18 +15,16 @@
 #include <set>
 #include <thread>
 
-#include "Core/AwaitablePromise.h"
 #include "Core/Config.h"
 #include "Core/Logger.h"
+#include "Core/OneShot.h"
 #include "version.h"
 
 #define DebugPrint(...) Logger::debug(__VA_ARGS__)
 
 using json = nlohmann::json;
 
-struct XSplit::Promise : public AwaitablePromise<nlohmann::json> {
-  Promise(asio::io_context& ctx): AwaitablePromise(ctx) {}
-};
+struct XSplit::Promise : public OneShot<nlohmann::json> {};
 
 #define XSPLIT_CHECK(x) \
   if (!(x)) { \
@@ -37,7 +35,7 @@ struct XSplit::Promise : public AwaitablePromise<nlohmann::json> {
 XSplit::XSplit(std::shared_ptr<asio::io_context> io_context, IXSplitScriptDllContext* context)
   : StreamingSoftware(io_context),
     mCallbackImpl(context),
-    mLoggerImpl([this](const std::string& message) {
+    mLoggerImpl([this](LogLevel, const std::string& message) {
       this->sendToXSplitDebugLog(message);
     }) {
   LOG_FUNCTION();
@@ -191,8 +189,15 @@ void XSplit::pluginfunc_setConfiguration(const nlohmann::json& config) {
 void XSplit::pluginfunc_returnValue(const nlohmann::json& data) {
   LOG_FUNCTION();
   auto key = std::stoull(data["call_id"].get<std::string>());
-  mPromises.at(key).resolve(data["value"]);
-  mPromises.erase(key);
+  std::unique_lock lock(mPromisesMutex);
+  auto it = mPromises.find(key);
+  if (it == mPromises.end()) {
+    return;
+  }
+  auto promise = it->second;
+  mPromises.erase(it);
+  lock.unlock();
+  promise.resolve(data["value"]);
 }
 
 template<class... Targs>
@@ -200,9 +205,13 @@ asio::awaitable<nlohmann::json> XSplit::coCallJSPlugin(
   const char* func,
   Targs... args
 ) {
-  Promise promise(getIoContext());
-  auto id = mNextPromiseId++;
-  mPromises.emplace(id, promise);
+  Promise promise;
+  uint64_t id;
+  {
+    std::scoped_lock lock(mPromisesMutex);
+    id = mNextPromiseId++;
+    mPromises.emplace(id, promise);
+  }
 
   callJSPlugin(func, std::to_string(id), args...);
   co_return co_await promise.async_wait();
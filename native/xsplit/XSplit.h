@@ -12,6 +12,7 @@
 #include <functional>
 #include <future>
 #include <map>
+#include <mutex>
 
 #include "Core/Config.h"
 #include "Core/Logger.h"
@@ -47,6 +48,8 @@ class XSplit final : public StreamingSoftware {
   struct Promise;
   Config mConfig;
   CComPtr<IXSplitScriptDllContext> mCallbackImpl;
+  // Promises are created on io threads, and resolved on XSplit's thread
+  std::mutex mPromisesMutex;
   uint64_t mNextPromiseId = 0;
   std::map<uint64_t, Promise> mPromises;
 
@@ -151,7 +154,7 @@ class XSplit final : public StreamingSoftware {
     mPluginFuncs[fmt::format("com.fredemmott.streaming-remote/cpp/{}", name)] =
       [=](BSTR* ret, UINT argc, BSTR* bargv) {
         if (argc != sizeof...(Targs)) {
-          Logger::debug(
+          Logger::warning(
             "{}() expected {} args, got {}", name, sizeof...(Targs), argc);
           return;
         }
@@ -6,12 +6,17 @@
  * in the root directory of this source tree.
  */
 
+#include "Core/FlightRecorder.h"
 #include "Core/Logger.h"
 #include "Core/Plugin.h"
+#include "Core/SessionRecorder.h"
 #include "IXSplitScriptDllContext.h"
 #include "XSplit.h"
 #include "portability.h"
 
+#include <cstdlib>
+#include <filesystem>
+
 #ifdef WIN32
 BOOL APIENTRY
 DllMain(HMODULE hModule, DWORD ul_reason_for_call, LPVOID lpReserved) {
@@ -28,7 +33,32 @@ DllMain(HMODULE hModule, DWORD ul_reason_for_call, LPVOID lpReserved) {
 
 namespace {
 Plugin* sPlugin = nullptr;
+FlightRecorder* sFlightRecorder = nullptr;
+SessionRecorder* sSessionRecorder = nullptr;
 std::weak_ptr<XSplit> sImpl;
+
+void start_flight_recorder() {
+  try {
+    sFlightRecorder = new FlightRecorder(
+      std::filesystem::temp_directory_path()
+      / "streaming-remote-flight-recorder.bin");
+  } catch (const std::exception& e) {
+    Logger::warning("Failed to start the flight recorder: {}", e.what());
+  }
+}
+
+// Opt-in, as recordings contain everything that clients send
+void start_session_recorder() {
+  const char* directory = std::getenv("STREAMING_REMOTE_RECORD_SESSIONS");
+  if (!(directory && directory[0])) {
+    return;
+  }
+  try {
+    sSessionRecorder = new SessionRecorder(std::filesystem::u8path(directory));
+  } catch (const std::exception& e) {
+    Logger::warning("Failed to start the session recorder: {}", e.what());
+  }
+}
 }// namespace
 
 extern "C" {
@@ -57,6 +87,8 @@ BOOL WINAPI XSplitScriptPluginCall(
     auto impl = std::make_shared<XSplit>(io_context, pContext);
     sPlugin = new Plugin(io_context, impl);
     sImpl = impl;
+    start_flight_recorder();
+    start_session_recorder();
   }
   std::promise<bool> success;
   // Execute in the worker thread, but block on it succeeding
@@ -82,5 +114,9 @@ void WINAPI XSplitScriptPluginDestroy() {
   ScopeLogger _log(__FUNCTION__);
   delete sPlugin;
   sPlugin = nullptr;
+  delete sFlightRecorder;
+  sFlightRecorder = nullptr;
+  delete sSessionRecorder;
+  sSessionRecorder = nullptr;
 }
 }